@@ -0,0 +1,149 @@
+// amf_bench.cpp : times the stream AMF readers against the span decoder.
+//
+// usage: amf_bench [ keyframes ] [ rounds ]
+//
+// Builds an onMetaData body with a keyframes object of the given size (times
+// and filepositions strict arrays, as written by most muxers), then decodes
+// it rounds times both ways into an arena that is reset between rounds. The
+// stream path reads a temporary copy of the body through a buffered reader.
+// The lazy path indexes the body and answers the queries a probe would ask.
+
+#include "stdafx.h"
+#include "flvparser.h"
+
+static void put_u8(std::vector<uint8_t> &out, uint8_t v) { out.push_back(v); }
+static void put_be16(std::vector<uint8_t> &out, uint32_t v) { put_u8(out, (uint8_t)(v >> 8)); put_u8(out, (uint8_t)v); }
+static void put_be32(std::vector<uint8_t> &out, uint32_t v) { put_be16(out, v >> 16); put_be16(out, v & 0xFFFF); }
+
+static void put_name(std::vector<uint8_t> &out, const char *name)
+{
+    put_be16(out, (uint32_t)strlen(name));
+    out.insert(out.end(), name, name + strlen(name));
+}
+
+static void put_number(std::vector<uint8_t> &out, double dn)
+{
+    uint64_t bits;
+    memcpy(&bits, &dn, sizeof(bits));
+    put_u8(out, AMF_TYPE_NUMBER);
+    put_be32(out, (uint32_t)(bits >> 32));
+    put_be32(out, (uint32_t)bits);
+}
+
+static void put_number_array(std::vector<uint8_t> &out, const char *name, uint32_t count, double step)
+{
+    put_name(out, name);
+    put_u8(out, AMF_TYPE_STRICT_ARRAY);
+    put_be32(out, count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        put_number(out, i * step);
+    }
+}
+
+//build_meta - "onMetaData" followed by an ECMA array holding duration and keyframes
+static void build_meta(std::vector<uint8_t> &out, uint32_t keyframes)
+{
+    put_u8(out, AMF_TYPE_STRING);
+    put_name(out, "onMetaData");
+    put_u8(out, AMF_TYPE_ECMA_ARRAY);
+    put_be32(out, 2);
+    put_name(out, "duration");
+    put_number(out, keyframes * 2.0);
+    put_name(out, "keyframes");
+    put_u8(out, AMF_TYPE_OBJECT);
+    put_number_array(out, "times", keyframes, 2.0);
+    put_number_array(out, "filepositions", keyframes, 65536.0);
+    put_be16(out, 0);
+    put_u8(out, AMF_TYPE_OBJECT_END);
+    put_be16(out, 0);
+    put_u8(out, AMF_TYPE_OBJECT_END);
+}
+
+static double now_secs()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t keyframes = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 100000;
+    uint32_t rounds = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 20;
+    std::vector<uint8_t> body;
+    build_meta(body, keyframes);
+
+    const char *tmp_name = "amf_bench.tmp";
+    FILE *fh = fopen(tmp_name, "wb");
+    if (NULL == fh || fwrite(&body[0], 1, body.size(), fh) != body.size())
+    {
+        fprintf(stderr, "Failed to write %s\n", tmp_name);
+        return EXIT_FAILURE;
+    }
+    fclose(fh);
+    flv_reader_t *reader = flv_reader_open(tmp_name, FLV_IO_MODE_BUFFERED);
+    if (NULL == reader)
+    {
+        fprintf(stderr, "Failed to open %s\n", tmp_name);
+        return EXIT_FAILURE;
+    }
+
+    flv_arena_t arena;
+    flv_arena_init(&arena);
+    uint32_t stream_values = 0, span_values = 0;
+
+    //stream readers: name, then the value, straight off the reader
+    double start = now_secs();
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        flv_reader_seek(reader, 0);
+        amf_data_value_t *p_name = flv_arena_new<amf_data_value_t>(&arena);
+        read_byte(reader, &p_name->type);
+        read_string(reader, &arena, &p_name->data_value.string_value);
+        amf_data_value_t *p_value = NULL;
+        read_amf_data(reader, NULL, &arena, &p_value);
+        stream_values = p_value->data_value.p_emca_array->object_property_lst.count;
+        flv_arena_reset(&arena);
+    }
+    double stream_secs = now_secs() - start;
+
+    //span decoder over the body in memory
+    start = now_secs();
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        amf_script_data_list_t lst = { NULL, NULL, 0 };
+        amf_decode_script(&body[0], body.size(), &arena, &lst);
+        span_values = (lst.count == 2) ? lst.last->data_value.p_emca_array->object_property_lst.count : 0;
+        flv_arena_reset(&arena);
+    }
+    double span_secs = now_secs() - start;
+
+    //lazy: index, read duration, decode only keyframes.filepositions
+    amf_lazy_t lazy;
+    amf_number_t duration = 0;
+    uint32_t positions = 0;
+    start = now_secs();
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        amf_lazy_open(&lazy, &body[0], body.size());
+        amf_lazy_number(&lazy, "duration", &duration);
+        amf_span_t span;
+        positions = (amf_lazy_locate(&lazy, "keyframes.filepositions", &span) == AMF_TYPE_STRICT_ARRAY)
+            ? flv_get_be32(span.p + 1) : 0;
+    }
+    double lazy_secs = now_secs() - start;
+
+    flv_arena_free(&arena);
+    flv_reader_close(reader);
+    remove(tmp_name);
+
+    double mb = body.size() * (double)rounds / (1024 * 1024);
+    printf("onMetaData with %u keyframes, %.2f MB body, %u rounds\n", keyframes, body.size() / (1024.0 * 1024.0), rounds);
+    printf("stream read_amf_data: %8.3f ms/round %8.1f MB/s (%u properties)\n", stream_secs * 1000 / rounds,
+        (stream_secs > 0) ? mb / stream_secs : 0.0, stream_values);
+    printf("span amf_decode:      %8.3f ms/round %8.1f MB/s (%u properties)\n", span_secs * 1000 / rounds,
+        (span_secs > 0) ? mb / span_secs : 0.0, span_values);
+    printf("speedup: %.1fx\n", (span_secs > 0) ? stream_secs / span_secs : 0.0);
+    printf("lazy duration + keyframes.filepositions: %8.3f us/round (duration %.0f, %u positions)\n",
+        lazy_secs * 1e6 / rounds, duration, positions);
+    return 0;
+}
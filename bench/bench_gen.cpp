@@ -0,0 +1,389 @@
+// bench_gen.cpp : synthetic FLV generator implementation.
+
+#include "stdafx.h"
+#include "flvparser.h"
+#include "bench_gen.h"
+
+#define GEN_POOL_SIZE       (4 * 1024 * 1024)   //payload bytes the frames are cut from
+#define GEN_AUDIO_RATE      44100
+#define GEN_AUDIO_SAMPLES   1024
+#define GEN_AUDIO_AS_VIDEO  UINT32_MAX          //audio frames not set: as long as the video
+
+//Baseline 640x360 SPS and its PPS
+static const uint8_t gen_sps[] = { 0x67, 0x42, 0xC0, 0x1E, 0xDA, 0x02, 0x80, 0xBF, 0xE5, 0x84, 0x00 };
+static const uint8_t gen_pps[] = { 0x68, 0xCE, 0x3C, 0x80 };
+//AAC LC, 44.1 kHz, stereo
+static const uint8_t gen_asc[] = { 0x12, 0x10 };
+
+typedef struct __gen_tag {
+    uint32_t timestamp;
+    uint32_t data_size;
+    uint8_t tag_type;
+    uint8_t key;
+} gen_tag_t;
+
+void bench_gen_defaults(bench_gen_opts_t *opts)
+{
+    opts->video = 25 * 600;
+    opts->audio = GEN_AUDIO_AS_VIDEO;
+    opts->fps = 25;
+    opts->gop = 50;
+    opts->vsize = 4000;
+    opts->asize = 300;
+    opts->meta = 0;
+    opts->seed = 1;
+}
+
+//bench_gen_option - take one --name=value, 0 when it is a generator option
+int bench_gen_option(bench_gen_opts_t *opts, const char *arg)
+{
+    static const char *names[] = { "video", "audio", "fps", "gop", "vsize", "asize", "meta", "seed" };
+    uint32_t *values[] = { &opts->video, &opts->audio, &opts->fps, &opts->gop, &opts->vsize, &opts->asize, &opts->meta, &opts->seed };
+    if (strncmp(arg, "--", 2) != 0)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    {
+        size_t len = strlen(names[i]);
+        if (strncmp(arg + 2, names[i], len) == 0 && arg[2 + len] == '=')
+        {
+            *values[i] = (uint32_t)strtoul(arg + 3 + len, NULL, 10);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+double bench_now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t xorshift(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+//********** AMF0 building
+static void put_u8(std::vector<uint8_t> &out, uint8_t v) { out.push_back(v); }
+static void put_be16(std::vector<uint8_t> &out, uint32_t v) { put_u8(out, (uint8_t)(v >> 8)); put_u8(out, (uint8_t)v); }
+static void put_be32(std::vector<uint8_t> &out, uint32_t v) { put_be16(out, v >> 16); put_be16(out, v & 0xFFFF); }
+
+static void put_name(std::vector<uint8_t> &out, const char *name)
+{
+    put_be16(out, (uint32_t)strlen(name));
+    out.insert(out.end(), name, name + strlen(name));
+}
+
+static void put_number(std::vector<uint8_t> &out, double dn)
+{
+    uint64_t bits;
+    memcpy(&bits, &dn, sizeof(bits));
+    put_u8(out, AMF_TYPE_NUMBER);
+    put_be32(out, (uint32_t)(bits >> 32));
+    put_be32(out, (uint32_t)bits);
+}
+
+static void put_number_prop(std::vector<uint8_t> &out, const char *name, double dn)
+{
+    put_name(out, name);
+    put_number(out, dn);
+}
+
+static void put_array_prop(std::vector<uint8_t> &out, const char *name, const std::vector<double> &values)
+{
+    put_name(out, name);
+    put_u8(out, AMF_TYPE_STRICT_ARRAY);
+    put_be32(out, (uint32_t)values.size());
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        put_number(out, values[i]);
+    }
+}
+
+static void put_end(std::vector<uint8_t> &out)
+{
+    put_be16(out, 0);
+    put_u8(out, AMF_TYPE_OBJECT_END);
+}
+
+//build_meta - onMetaData, its size only depends on the number of key frames
+static void build_meta(std::vector<uint8_t> &out, const bench_gen_opts_t *opts, bool has_audio, double duration,
+    uint64_t file_size, const std::vector<double> &times, const std::vector<double> &positions)
+{
+    out.clear();
+    put_u8(out, AMF_TYPE_STRING);
+    put_name(out, "onMetaData");
+    put_u8(out, AMF_TYPE_ECMA_ARRAY);
+    size_t count_at = out.size();
+    put_be32(out, 0);
+    uint32_t count = 0;
+    put_number_prop(out, "duration", duration), ++count;
+    put_number_prop(out, "filesize", (double)file_size), ++count;
+    if (opts->video != 0)
+    {
+        put_number_prop(out, "width", 640), ++count;
+        put_number_prop(out, "height", 360), ++count;
+        put_number_prop(out, "framerate", opts->fps), ++count;
+        put_number_prop(out, "videocodecid", FLV_VIDEO_TAG_CODEC_AVC), ++count;
+    }
+    if (has_audio)
+    {
+        put_number_prop(out, "audiocodecid", FLV_AUDIO_TAG_SOUND_FORMAT_AAC), ++count;
+        put_number_prop(out, "audiosamplerate", GEN_AUDIO_RATE), ++count;
+        put_name(out, "stereo"), ++count;
+        put_u8(out, AMF_TYPE_BOOLEAN);
+        put_u8(out, 1);
+    }
+    put_name(out, "encoder"), ++count;
+    put_u8(out, AMF_TYPE_STRING);
+    put_name(out, "bench_gen");
+    if (!times.empty())
+    {
+        put_name(out, "keyframes"), ++count;
+        put_u8(out, AMF_TYPE_OBJECT);
+        put_array_prop(out, "times", times);
+        put_array_prop(out, "filepositions", positions);
+        put_end(out);
+    }
+    if (opts->meta != 0)
+    {
+        std::vector<double> padding(opts->meta);
+        for (uint32_t i = 0; i < opts->meta; ++i)
+        {
+            padding[i] = i * 0.5;
+        }
+        put_array_prop(out, "padding", padding), ++count;
+    }
+    put_end(out);
+    flv_put_be32(&out[count_at], count);
+}
+
+//check_meta - read the written onMetaData back the way flvparser does, its keyframes table has to be usable
+static int check_meta(const char *file_name, size_t key_frames)
+{
+    flv_reader_t *reader = flv_reader_open(file_name, FLV_IO_MODE_BUFFERED);
+    if (NULL == reader)
+    {
+        return -1;
+    }
+    flv_slice_meta_t meta;
+    int ret = flv_slice_meta_load(reader, &meta);
+    flv_slice_meta_free(&meta);
+    if (0 == ret && key_frames != 0)
+    {
+        flv_sidecar_t *sidecar = flv_sidecar_from_meta(reader);
+        ret = (NULL != sidecar && sidecar->hdr->entry_count == key_frames) ? 0 : -1;
+        flv_sidecar_close(sidecar);
+    }
+    flv_reader_close(reader);
+    return ret;
+}
+
+static void write_tag(flv_writer_t *writer, uint8_t tag_type, uint32_t timestamp, uint32_t data_size)
+{
+    flv_tag_t tag;
+    memset(&tag, 0, sizeof(tag));
+    tag.tag_type = tag_type;
+    flv_put_be24(tag.data_size, data_size);
+    flv_put_be24(tag.timestamp, timestamp & 0x00FFFFFF);
+    tag.timestampex = (uint8_t)(timestamp >> 24);
+    flv_writer_write(writer, &tag, sizeof(tag));
+}
+
+static void write_pre_tag_size(flv_writer_t *writer, uint32_t data_size)
+{
+    uint8_t be_size[4];
+    flv_put_be32(be_size, data_size + sizeof(flv_tag_t));
+    flv_writer_write(writer, be_size, sizeof(be_size));
+}
+
+//write_payload - n bytes cut from a random place of the pool
+static void write_payload(flv_writer_t *writer, const std::vector<uint8_t> &pool, uint32_t *state, uint32_t n)
+{
+    while (n > 0)
+    {
+        uint32_t len = std::min(n, (uint32_t)GEN_POOL_SIZE / 2);
+        flv_writer_write(writer, &pool[xorshift(state) % (GEN_POOL_SIZE / 2)], len);
+        n -= len;
+    }
+}
+
+//video_ms - length of the video, and the number of audio frames in *audio
+static uint64_t video_ms(const bench_gen_opts_t *opts, uint32_t *audio)
+{
+    uint64_t ms = (uint64_t)opts->video * 1000 / std::max(opts->fps, 1u);
+    *audio = (opts->audio == GEN_AUDIO_AS_VIDEO) ? (uint32_t)(ms * GEN_AUDIO_RATE / 1000 / GEN_AUDIO_SAMPLES) : opts->audio;
+    return ms;
+}
+
+//bench_gen_duration - seconds the file opts describe lasts, the longer of its video and audio
+double bench_gen_duration(const bench_gen_opts_t *opts)
+{
+    uint32_t audio = 0;
+    uint64_t ms = video_ms(opts, &audio);
+    return std::max(ms, (uint64_t)audio * GEN_AUDIO_SAMPLES * 1000 / GEN_AUDIO_RATE) / 1000.0;
+}
+
+//bench_gen_write - the file opts describe, its size in *bytes and number of tags in *tags
+int bench_gen_write(const bench_gen_opts_t *opts, const char *file_name, uint64_t *bytes, uint32_t *tags)
+{
+    uint32_t fps = std::max(opts->fps, 1u), gop = std::max(opts->gop, 1u);
+    uint32_t audio = 0;
+    video_ms(opts, &audio);
+
+    //interleave by timestamp, audio first on a tie
+    std::vector<gen_tag_t> plan;
+    plan.reserve((size_t)opts->video + audio);
+    uint32_t v = 0, a = 0;
+    while (v < opts->video || a < audio)
+    {
+        uint32_t v_ts = (uint32_t)((uint64_t)v * 1000 / fps);
+        uint32_t a_ts = (uint32_t)((uint64_t)a * GEN_AUDIO_SAMPLES * 1000 / GEN_AUDIO_RATE);
+        gen_tag_t tag;
+        if (a < audio && (v >= opts->video || a_ts <= v_ts))
+        {
+            tag.timestamp = a_ts;
+            tag.data_size = 2 + opts->asize;
+            tag.tag_type = TAG_TYPE_AUDIO;
+            tag.key = 0;
+            ++a;
+        }
+        else
+        {
+            tag.key = (v % gop) == 0;
+            tag.timestamp = v_ts;
+            tag.data_size = 5 + 4 + 1 + (tag.key ? opts->vsize * 8 : opts->vsize);
+            tag.tag_type = TAG_TYPE_VIDEO;
+            ++v;
+        }
+        plan.push_back(tag);
+    }
+    double duration = bench_gen_duration(opts);
+
+    //sequence headers
+    std::vector<uint8_t> avc_seq, aac_seq;
+    if (opts->video != 0)
+    {
+        uint8_t hdr[] = { 0x17, 0, 0, 0, 0, 1, gen_sps[1], gen_sps[2], gen_sps[3], 0xFF, 0xE1 };
+        avc_seq.assign(hdr, hdr + sizeof(hdr));
+        put_be16(avc_seq, sizeof(gen_sps));
+        avc_seq.insert(avc_seq.end(), gen_sps, gen_sps + sizeof(gen_sps));
+        put_u8(avc_seq, 1);
+        put_be16(avc_seq, sizeof(gen_pps));
+        avc_seq.insert(avc_seq.end(), gen_pps, gen_pps + sizeof(gen_pps));
+    }
+    if (audio != 0)
+    {
+        aac_seq.push_back(0xAF);
+        aac_seq.push_back(0);
+        aac_seq.insert(aac_seq.end(), gen_asc, gen_asc + sizeof(gen_asc));
+    }
+
+    //lay the file out with a placeholder table, the numbers don't change its size
+    std::vector<double> times, positions;
+    for (size_t i = 0; i < plan.size(); ++i)
+    {
+        if (plan[i].key)
+        {
+            times.push_back(plan[i].timestamp / 1000.0);
+        }
+    }
+    positions.resize(times.size());
+    std::vector<uint8_t> meta;
+    build_meta(meta, opts, audio != 0, duration, 0, times, positions);
+    uint64_t offset = sizeof(flv_hdr_t) + 4 + sizeof(flv_tag_t) + meta.size() + 4;
+    offset += avc_seq.empty() ? 0 : sizeof(flv_tag_t) + avc_seq.size() + 4;
+    offset += aac_seq.empty() ? 0 : sizeof(flv_tag_t) + aac_seq.size() + 4;
+    for (size_t i = 0, k = 0; i < plan.size(); ++i)
+    {
+        if (plan[i].key)
+        {
+            positions[k++] = (double)offset;
+        }
+        offset += sizeof(flv_tag_t) + plan[i].data_size + 4;
+    }
+    build_meta(meta, opts, audio != 0, duration, offset, times, positions);
+
+    flv_writer_t *writer = flv_writer_open(file_name);
+    if (NULL == writer)
+    {
+        return -1;
+    }
+    flv_hdr_t flv_hdr;
+    memcpy(flv_hdr.signature, "FLV", 3);
+    flv_hdr.version = 1;
+    flv_hdr.flags = (audio != 0 ? 0x04 : 0) | (opts->video != 0 ? 0x01 : 0);
+    flv_put_be32((uint8_t *)&flv_hdr.data_offset, sizeof(flv_hdr_t));
+    flv_writer_write(writer, &flv_hdr, sizeof(flv_hdr));
+    static const uint8_t zero_size[4] = { 0 };
+    flv_writer_write(writer, zero_size, sizeof(zero_size));
+
+    write_tag(writer, TAG_TYPE_META, 0, (uint32_t)meta.size());
+    flv_writer_write(writer, &meta[0], (uint32_t)meta.size());
+    write_pre_tag_size(writer, (uint32_t)meta.size());
+    uint32_t count = 1;
+    const std::vector<uint8_t> *seqs[] = { &avc_seq, &aac_seq };
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!seqs[i]->empty())
+        {
+            write_tag(writer, (i == 0) ? TAG_TYPE_VIDEO : TAG_TYPE_AUDIO, 0, (uint32_t)seqs[i]->size());
+            flv_writer_write(writer, &(*seqs[i])[0], (uint32_t)seqs[i]->size());
+            write_pre_tag_size(writer, (uint32_t)seqs[i]->size());
+            ++count;
+        }
+    }
+
+    //frame payloads come out of a pool of seeded noise
+    uint32_t state = std::max(opts->seed, 1u);
+    std::vector<uint8_t> pool(GEN_POOL_SIZE);
+    for (size_t i = 0; i < pool.size(); i += 4)
+    {
+        uint32_t r = xorshift(&state);
+        memcpy(&pool[i], &r, 4);
+    }
+    for (size_t i = 0; i < plan.size(); ++i)
+    {
+        const gen_tag_t &tag = plan[i];
+        write_tag(writer, tag.tag_type, tag.timestamp, tag.data_size);
+        if (tag.tag_type == TAG_TYPE_VIDEO)
+        {
+            uint32_t nal_size = tag.data_size - 5 - 4;
+            uint8_t hdr[10] = { (uint8_t)(tag.key ? 0x17 : 0x27), 1, 0, 0, 0 };
+            flv_put_be32(hdr + 5, nal_size);
+            hdr[9] = tag.key ? 0x65 : 0x41;
+            flv_writer_write(writer, hdr, sizeof(hdr));
+            write_payload(writer, pool, &state, nal_size - 1);
+        }
+        else
+        {
+            uint8_t hdr[2] = { 0xAF, 1 };
+            flv_writer_write(writer, hdr, sizeof(hdr));
+            write_payload(writer, pool, &state, tag.data_size - 2);
+        }
+        write_pre_tag_size(writer, tag.data_size);
+    }
+    count += (uint32_t)plan.size();
+
+    if (flv_writer_close(writer) != 0 || check_meta(file_name, times.size()) != 0)
+    {
+        remove(file_name);
+        return -1;
+    }
+    if (NULL != bytes)
+    {
+        *bytes = offset;
+    }
+    if (NULL != tags)
+    {
+        *tags = count;
+    }
+    return 0;
+}
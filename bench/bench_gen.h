@@ -0,0 +1,40 @@
+// bench_gen.h : deterministic synthetic FLV files for the benchmarks.
+//
+// The file looks like a muxer's output: onMetaData first, with a keyframes
+// table (times, filepositions) that points at the real key frames, then the
+// AVC and AAC sequence headers, then video and audio interleaved by
+// timestamp. Frame payloads are length-prefixed NAL units and raw AAC frames
+// filled from a seeded xorshift generator, so the same options always give
+// the same bytes.
+//
+// Options are given as --name=value:
+//   video=N     video frames (0: audio only)            default 25 fps x 10 min
+//   audio=N     AAC frames, 1024 samples at 44.1 kHz    default as long as the video
+//   fps=N       video frame rate                        25
+//   gop=N       frames from key frame to key frame      50
+//   vsize=B     inter frame payload, key frames 8x      4000
+//   asize=B     AAC frame payload                       300
+//   meta=N      extra numbers in an onMetaData array    0
+//   seed=N      payload generator seed                  1
+
+#pragma once
+
+#include "stdafx.h"
+
+typedef struct __bench_gen_opts {
+    uint32_t video;
+    uint32_t audio;
+    uint32_t fps;
+    uint32_t gop;
+    uint32_t vsize;
+    uint32_t asize;
+    uint32_t meta;
+    uint32_t seed;
+} bench_gen_opts_t;
+
+//********** generator functions
+void bench_gen_defaults(bench_gen_opts_t *opts);
+int bench_gen_option(bench_gen_opts_t *opts, const char *arg);
+int bench_gen_write(const bench_gen_opts_t *opts, const char *file_name, uint64_t *bytes, uint32_t *tags);
+double bench_gen_duration(const bench_gen_opts_t *opts);
+double bench_now();
@@ -0,0 +1,47 @@
+// flv_gen.cpp : writes a synthetic FLV file for benchmarking by hand.
+//
+// usage: flv_gen out.flv [ --video=N --audio=N --fps=N --gop=N --vsize=B --asize=B --meta=N --seed=N ]
+//
+// See bench_gen.h for what the options mean. The same options always give
+// the same file, so a run can be repeated on another machine.
+
+#include "stdafx.h"
+#include "flvparser.h"
+#include "bench_gen.h"
+
+int main(int argc, char *argv[])
+{
+    bench_gen_opts_t opts;
+    bench_gen_defaults(&opts);
+    const char *out_name = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (bench_gen_option(&opts, argv[i]) == 0)
+        {
+            continue;
+        }
+        if (argv[i][0] == '-' || out_name != NULL)
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        out_name = argv[i];
+    }
+    if (NULL == out_name)
+    {
+        fprintf(stderr, "usage: flv_gen out.flv [ --video=N --audio=N --fps=N --gop=N --vsize=B --asize=B --meta=N --seed=N ]\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t bytes = 0;
+    uint32_t tags = 0;
+    double start = bench_now();
+    if (bench_gen_write(&opts, out_name, &bytes, &tags) != 0)
+    {
+        fprintf(stderr, "Failed to write %s\n", out_name);
+        return EXIT_FAILURE;
+    }
+    double secs = bench_now() - start;
+    printf("%s: %llu bytes, %u tags in %.3f s\n", out_name, (unsigned long long)bytes, tags, secs);
+    return 0;
+}
@@ -0,0 +1,176 @@
+// io_bench.cpp : times tag header decoding and body transfer on a synthetic file.
+//
+// usage: io_bench [ rounds ] [ --video=N ... generator options, see bench_gen.h ]
+//
+// Generates a temporary file and walks it rounds times each way, best round
+// reported:
+//   raw headers    the packed flv_tag_t headers decoded straight off a mapping,
+//                  the floor the iterator is measured against
+//   iter           flv_iter_next() over a buffered and a mapped reader
+//   iter body      the same with FLV_ITER_BODY, the whole body in view
+//   copy           every tag's header and body moved with flv_copy() into a
+//                  writer on /dev/null, the transfer a split does per tag
+
+#include "stdafx.h"
+#include "flvparser.h"
+#include "bench_gen.h"
+
+typedef struct __io_result {
+    double secs;
+    uint32_t tags;
+    uint64_t check;     //folded from what was decoded so nothing is optimised away
+} io_result_t;
+
+//raw_walk - header after header off the mapping, no checks but the bounds
+static io_result_t raw_walk(const uint8_t *base, size_t size)
+{
+    io_result_t res = { 0, 0, 0 };
+    double start = bench_now();
+    size_t pos = flv_get_be32(base + 5) + 4;
+    while (pos + sizeof(flv_tag_t) <= size)
+    {
+        const flv_tag_t *tag = (const flv_tag_t *)(base + pos);
+        uint32_t data_size = flv_get_be24(tag->data_size);
+        uint32_t timestamp = flv_get_be24(tag->timestamp) | ((uint32_t)tag->timestampex << 24);
+        res.check += tag->tag_type + timestamp;
+        pos += sizeof(flv_tag_t) + data_size + 4;
+        ++res.tags;
+    }
+    res.secs = bench_now() - start;
+    return res;
+}
+
+//iter_walk - views only, the bodies are skipped by the next call
+static io_result_t iter_walk(const char *file_name, int mode, uint32_t flags)
+{
+    io_result_t res = { 0, 0, 0 };
+    double start = bench_now();
+    flv_reader_t *reader = flv_reader_open(file_name, mode);
+    flv_iter_t iter;
+    if (NULL == reader || flv_iter_init(&iter, reader, flags) != 0)
+    {
+        flv_reader_close(reader);
+        return res;
+    }
+    flv_tag_view_t view;
+    while (flv_iter_next(&iter, &view) == 1)
+    {
+        res.check += view.tag_type + view.timestamp + view.body_len;
+        ++res.tags;
+    }
+    flv_reader_close(reader);
+    res.secs = bench_now() - start;
+    return res;
+}
+
+//copy_walk - header, body and PreviousTagSize of every tag through flv_copy
+static io_result_t copy_walk(const char *file_name, int mode)
+{
+    io_result_t res = { 0, 0, 0 };
+    double start = bench_now();
+    flv_reader_t *reader = flv_reader_open(file_name, mode);
+    flv_writer_t *writer = flv_writer_open("/dev/null");
+    flv_iter_t iter;
+    if (NULL == reader || NULL == writer || flv_iter_init(&iter, reader, 0) != 0)
+    {
+        flv_reader_close(reader);
+        flv_writer_close(writer);
+        return res;
+    }
+    flv_tag_view_t view;
+    while (flv_iter_next(&iter, &view) == 1)
+    {
+        flv_writer_write(writer, view.tag, sizeof(flv_tag_t));
+        res.check += flv_copy(reader, writer, view.data_size);
+        uint8_t be_size[4];
+        flv_put_be32(be_size, view.data_size + sizeof(flv_tag_t));
+        flv_writer_write(writer, be_size, sizeof(be_size));
+        ++res.tags;
+    }
+    flv_writer_close(writer);
+    flv_reader_close(reader);
+    res.secs = bench_now() - start;
+    return res;
+}
+
+static void report(const char *name, const io_result_t &best, uint64_t bytes)
+{
+    double mb = bytes / (1024.0 * 1024.0);
+    printf("%-20s %8.2f ms %10.1f Mtags/s %10.1f MB/s\n", name, best.secs * 1000,
+        (best.secs > 0) ? best.tags / best.secs / 1e6 : 0.0, (best.secs > 0) ? mb / best.secs : 0.0);
+}
+
+static void keep_best(io_result_t *best, const io_result_t &res, uint32_t round)
+{
+    if (0 == round || res.secs < best->secs)
+    {
+        *best = res;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench_gen_opts_t opts;
+    bench_gen_defaults(&opts);
+    uint32_t rounds = 5;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (bench_gen_option(&opts, argv[i]) == 0)
+        {
+            continue;
+        }
+        if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        rounds = std::max((uint32_t)strtoul(argv[i], NULL, 10), 1u);
+    }
+
+    const char *tmp_name = "io_bench.tmp.flv";
+    uint64_t bytes = 0;
+    uint32_t tags = 0;
+    if (bench_gen_write(&opts, tmp_name, &bytes, &tags) != 0)
+    {
+        fprintf(stderr, "Failed to write %s\n", tmp_name);
+        return EXIT_FAILURE;
+    }
+    size_t size = 0;
+    int mapped = 0;
+    const uint8_t *base = (const uint8_t *)flv_map_file(tmp_name, &size, &mapped);
+    if (NULL == base)
+    {
+        fprintf(stderr, "Failed to map %s\n", tmp_name);
+        remove(tmp_name);
+        return EXIT_FAILURE;
+    }
+
+    static const char *names[] = { "raw headers", "iter buffered", "iter mmap", "iter body buffered", "iter body mmap",
+        "copy buffered", "copy mmap" };
+    const int runs = sizeof(names) / sizeof(names[0]);
+    io_result_t best[runs];
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        keep_best(&best[0], raw_walk(base, size), r);
+        keep_best(&best[1], iter_walk(tmp_name, FLV_IO_MODE_BUFFERED, 0), r);
+        keep_best(&best[2], iter_walk(tmp_name, FLV_IO_MODE_MMAP, 0), r);
+        keep_best(&best[3], iter_walk(tmp_name, FLV_IO_MODE_BUFFERED, FLV_ITER_BODY), r);
+        keep_best(&best[4], iter_walk(tmp_name, FLV_IO_MODE_MMAP, FLV_ITER_BODY), r);
+        keep_best(&best[5], copy_walk(tmp_name, FLV_IO_MODE_BUFFERED), r);
+        keep_best(&best[6], copy_walk(tmp_name, FLV_IO_MODE_MMAP), r);
+    }
+    flv_unmap_file((void *)base, size, mapped);
+    remove(tmp_name);
+
+    printf("%u tags, %.1f MB, best of %u rounds\n", tags, bytes / (1024.0 * 1024.0), rounds);
+    for (int i = 0; i < runs; ++i)
+    {
+        if (best[i].tags != best[0].tags)
+        {
+            fprintf(stderr, "%s saw %u tags, expected %u\n", names[i], best[i].tags, best[0].tags);
+            return EXIT_FAILURE;
+        }
+        report(names[i], best[i], bytes);
+    }
+    return 0;
+}
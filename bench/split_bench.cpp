@@ -0,0 +1,234 @@
+// split_bench.cpp : end-to-end runs of flvparser on a synthetic file.
+//
+// usage: split_bench [ --bin=flvparser ] [ --rounds=N ] [ --segment=S ] [ --video=N ... generator options ]
+//
+// Generates the file in a temporary directory, then runs the binary on it
+// once per configuration below, cutting every S seconds (10 by default):
+// with --segment=S, or the "cue" ones with a cue file holding the same
+// points, written next to the file.
+// Each configuration runs rounds times (3 by default) with the slices of the
+// previous round removed first; the best time is reported as input MB/s and
+// tags/s, with the largest peak RSS any round of it reached, as wait4()
+// reports it for the child.
+
+#include "stdafx.h"
+#include "flvparser.h"
+#include "bench_gen.h"
+#include <string>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+typedef struct __bench_config {
+    const char *name;
+    const char *options[3];     //after flv_file, NULL terminated
+} bench_config_t;
+
+//the segment option or the cue file is put in front of the ones that cut
+#define BENCH_SEGMENT   "S"
+#define BENCH_CUE       "C"
+
+static const bench_config_t configs[] = {
+    { "default",    { BENCH_SEGMENT, NULL } },
+    { "mmap",       { BENCH_SEGMENT, "--mmap", NULL } },
+    { "quiet",      { BENCH_SEGMENT, "--quiet", NULL } },
+    { "bindump",    { BENCH_SEGMENT, "--bindump", NULL } },
+    { "jobs=0",     { BENCH_SEGMENT, "--jobs=0", NULL } },
+    { "split",      { BENCH_SEGMENT, "--split", NULL } },
+    { "h264",       { BENCH_SEGMENT, "--h264", NULL } },
+    { "fmp4",       { BENCH_SEGMENT, "--fmp4", NULL } },
+    { "cue",        { BENCH_CUE, NULL } },
+    { "cue jobs=0", { BENCH_CUE, "--jobs=0", NULL } },
+    { "cue mmap",   { BENCH_CUE, "--mmap", NULL } },
+    { "stats",      { "--stats", NULL } },
+    { "probe",      { "--probe", NULL } },
+};
+
+//clean_dir - everything in dir but the NULL terminated keep names, the outputs of the last run
+static void clean_dir(const char *dir, const char *const *keep)
+{
+    DIR *dh = opendir(dir);
+    if (NULL == dh)
+    {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dh)) != NULL)
+    {
+        const char *const *name = keep;
+        while (*name != NULL && strcmp(entry->d_name, *name) != 0)
+        {
+            ++name;
+        }
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 || *name != NULL)
+        {
+            continue;
+        }
+        std::string path = std::string(dir) + "/" + entry->d_name;
+        remove(path.c_str());
+    }
+    closedir(dh);
+}
+
+//write_cue - a cue point every secs seconds of a file lasting duration, as flvparser reads them
+static int write_cue(const char *file_name, double secs, double duration)
+{
+    FILE *fh = fopen(file_name, "w");
+    if (NULL == fh)
+    {
+        return -1;
+    }
+    for (uint32_t k = 1; k * secs < duration; ++k)
+    {
+        uint32_t s = (uint32_t)(k * secs);
+        fprintf(fh, "%02u:%02u:%02u:00\n", s / 3600, s / 60 % 60, s % 60);
+    }
+    return (fclose(fh) == 0) ? 0 : -1;
+}
+
+//run - one run of bin with output thrown away, wall time in *secs and peak RSS in KB in *rss
+static int run(const char *bin, const std::vector<const char *> &args, double *secs, long *rss)
+{
+    double start = bench_now();
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (0 == pid)
+    {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0)
+        {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            close(null_fd);
+        }
+        execv(bin, (char *const *)&args[0]);
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid)
+    {
+        return -1;
+    }
+    *secs = bench_now() - start;
+    *rss = usage.ru_maxrss;
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    bench_gen_opts_t opts;
+    bench_gen_defaults(&opts);
+    const char *bin = "./flvparser";
+    uint32_t rounds = 3;
+    std::string segment = "--segment=10";
+    double segment_secs = 10;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (bench_gen_option(&opts, argv[i]) == 0)
+        {
+            continue;
+        }
+        if (strncmp(argv[i], "--bin=", 6) == 0)
+        {
+            bin = argv[i] + 6;
+        }
+        else if (strncmp(argv[i], "--rounds=", 9) == 0)
+        {
+            rounds = std::max((uint32_t)strtoul(argv[i] + 9, NULL, 10), 1u);
+        }
+        else if (strncmp(argv[i], "--segment=", 10) == 0)
+        {
+            segment = argv[i];
+            segment_secs = std::max(strtod(argv[i] + 10, NULL), 1.0);
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (access(bin, X_OK) != 0)
+    {
+        fprintf(stderr, "No flvparser at %s, build it or give --bin=\n", bin);
+        return EXIT_FAILURE;
+    }
+
+    char dir[] = "/tmp/split_bench.XXXXXX";
+    if (NULL == mkdtemp(dir))
+    {
+        fprintf(stderr, "Failed to create a temporary directory\n");
+        return EXIT_FAILURE;
+    }
+    const char *in_base = "bench.flv", *cue_base = "bench.cue";
+    const char *inputs[] = { in_base, cue_base, NULL };
+    std::string in_file = std::string(dir) + "/" + in_base;
+    std::string cue_file = std::string(dir) + "/" + cue_base;
+    uint64_t bytes = 0;
+    uint32_t tags = 0;
+    double start = bench_now();
+    if (bench_gen_write(&opts, in_file.c_str(), &bytes, &tags) != 0
+        || write_cue(cue_file.c_str(), segment_secs, bench_gen_duration(&opts)) != 0)
+    {
+        fprintf(stderr, "Failed to write %s\n", in_file.c_str());
+        remove(in_file.c_str());
+        remove(cue_file.c_str());
+        rmdir(dir);
+        return EXIT_FAILURE;
+    }
+    double mb = bytes / (1024.0 * 1024.0);
+    printf("%u tags, %.1f MB generated in %.2f s, %s, best of %u rounds\n", tags, mb, bench_now() - start,
+        segment.c_str(), rounds);
+    printf("%-10s %9s %10s %12s %10s\n", "config", "ms", "MB/s", "Mtags/s", "peak RSS");
+
+    int failed = 0;
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); ++c)
+    {
+        std::vector<const char *> args;
+        args.push_back(bin);
+        args.push_back(in_file.c_str());
+        for (const char *const *opt = configs[c].options; *opt != NULL; ++opt)
+        {
+            const char *arg = *opt;
+            if (strcmp(arg, BENCH_SEGMENT) == 0)
+            {
+                arg = segment.c_str();
+            }
+            else if (strcmp(arg, BENCH_CUE) == 0)
+            {
+                arg = cue_file.c_str();
+            }
+            args.push_back(arg);
+        }
+        args.push_back(NULL);
+
+        double best = 0;
+        long peak = 0;
+        int ret = 0;
+        for (uint32_t r = 0; r < rounds && 0 == ret; ++r)
+        {
+            clean_dir(dir, inputs);
+            double secs = 0;
+            long rss = 0;
+            ret = run(bin, args, &secs, &rss);
+            best = (0 == r || secs < best) ? secs : best;
+            peak = std::max(peak, rss);
+        }
+        if (ret != 0)
+        {
+            printf("%-10s failed\n", configs[c].name);
+            ++failed;
+            continue;
+        }
+        printf("%-10s %9.1f %10.1f %12.2f %7.1f MB\n", configs[c].name, best * 1000, (best > 0) ? mb / best : 0.0,
+            (best > 0) ? tags / best / 1e6 : 0.0, peak / 1024.0);
+    }
+
+    const char *none[] = { NULL };
+    clean_dir(dir, none);
+    rmdir(dir);
+    return (0 == failed) ? 0 : EXIT_FAILURE;
+}
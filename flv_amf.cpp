@@ -0,0 +1,945 @@
+// flv_amf.cpp : AMF0 script data decoding (onMetaData and friends) and encoding.
+
+#include "stdafx.h"
+#include "flv_amf.h"
+
+uint8_t read_byte(flv_reader_t *ifh, uint8_t *p_amf_byte)
+{
+    uint8_t cn = 0;
+    flv_reader_read(ifh, &cn, sizeof(cn));
+    if (NULL != p_amf_byte)
+    {
+        *p_amf_byte = cn;
+    }
+    return cn;
+}
+
+amf_number_t read_number(flv_reader_t *ifh, amf_number_t *p_amf_number)
+{
+    amf_number_t dn = 0;
+    flv_reader_read(ifh, (char*)&dn, sizeof(dn));
+    std::reverse((uint8_t *)&dn, (uint8_t *)&dn + sizeof(dn));
+    if (NULL != p_amf_number)
+    {
+        *p_amf_number = dn;
+    }
+    return dn;
+}
+
+//read_chars - n string bytes, viewed in place when the input is mapped, else copied into the arena
+static const uint8_t *read_chars(flv_reader_t *ifh, flv_arena_t *arena, uint32_t n)
+{
+    if (ifh->mapped)
+    {
+        //the mapping outlives the tree, no copy needed
+        const uint8_t *p = flv_reader_peek(ifh, n);
+        if (NULL != p)
+        {
+            flv_reader_skip(ifh, n);
+            return p;
+        }
+    }
+    uint8_t *data = (uint8_t *)flv_arena_alloc(arena, n + 1);
+    if (NULL == data)
+    {
+        flv_reader_skip(ifh, n);
+        return (const uint8_t *)"";
+    }
+    uint32_t got = flv_reader_read(ifh, data, n);
+    data[got] = '\0';
+    return data;
+}
+
+const uint8_t *read_string(flv_reader_t *ifh, flv_arena_t *arena, amf_string_t *p_amf_string)
+{
+    uint8_t be_size[2] = { 0 };
+    flv_reader_read(ifh, be_size, sizeof(be_size));
+    p_amf_string->size = (uint16_t)flv_get_be16(be_size);
+    p_amf_string->data = read_chars(ifh, arena, p_amf_string->size);
+
+    return p_amf_string->data;
+}
+
+const uint8_t *read_long_string(flv_reader_t *ifh, flv_arena_t *arena, amf_long_string_t *p_amf_long_string)
+{
+    uint8_t be_size[4] = { 0 };
+    flv_reader_read(ifh, be_size, sizeof(be_size));
+    p_amf_long_string->size = flv_get_be32(be_size);
+    p_amf_long_string->data = read_chars(ifh, arena, p_amf_long_string->size);
+
+    return p_amf_long_string->data;
+}
+
+const uint8_t *read_datadate(flv_reader_t *ifh, amf_date_t *p_amf_datetime)
+{
+    amf_number_t &date_time = p_amf_datetime->date_time;
+    int16_t &offset = p_amf_datetime->offset;
+    read_number(ifh, &date_time);
+    flv_reader_read(ifh, (char *)&offset, sizeof(offset));
+    std::reverse((uint8_t *)&offset, (uint8_t *)&offset + sizeof(offset));
+
+    static uint8_t local_time[] = { 0 };
+    return local_time;
+}
+
+uint32_t read_object(flv_reader_t *ifh, flv_writer_t *parse_file, flv_arena_t *arena, amf_object_t **pp_amf_object)
+{
+    if (NULL == *pp_amf_object)
+    {
+        *pp_amf_object = flv_arena_new<amf_object_t>(arena);
+    }
+    amf_object_t *p_amf_object = *pp_amf_object;
+    uint32_t arr_size = 0;
+    flv_writer_printf(parse_file, "object:\n");
+    while (!flv_reader_eof(ifh))
+    {
+        amf_object_property_t *p_object_property = flv_arena_new<amf_object_property_t>(arena);
+        amf_string_t *p_amf_string = &p_object_property->property_name;
+        read_string(ifh, arena, p_amf_string);
+        if (p_amf_string->size)
+        {
+            flv_writer_printf(parse_file, "\t%.*s: ", (int)p_amf_string->size, p_amf_string->data);
+        }
+
+        uint8_t type = read_amf_data(ifh, parse_file, arena, &p_object_property->p_data_value);
+        amf_list_push(&p_amf_object->object_property_lst, p_object_property);
+        if (type == AMF_TYPE_OBJECT_END)
+        {
+            break;
+        }
+        ++arr_size;
+    }
+
+    return arr_size;
+}
+
+uint32_t read_emca_array(flv_reader_t *ifh, flv_writer_t *parse_file, flv_arena_t *arena, amf_emca_array_t **pp_amf_emca_array)
+{
+    if (NULL == *pp_amf_emca_array)
+    {
+        *pp_amf_emca_array = flv_arena_new<amf_emca_array_t>(arena);
+    }
+    amf_emca_array_t *p_amf_emca_array = *pp_amf_emca_array;
+    uint32_t &arr_size = p_amf_emca_array->arr_len;
+    uint8_t be_size[4] = { 0 };
+    flv_reader_read(ifh, be_size, sizeof(be_size));
+    arr_size = flv_get_be32(be_size);
+    
+    flv_writer_printf(parse_file, "emca_array:\n");
+    for (uint32_t i = 0; i < arr_size && !flv_reader_eof(ifh); ++i)
+    {
+        amf_object_property_t *p_amf_obj_property = flv_arena_new<amf_object_property_t>(arena);
+        amf_string_t *p_amf_string = &p_amf_obj_property->property_name;
+        read_string(ifh, arena, p_amf_string);
+        flv_writer_printf(parse_file, "\t%.*s: ", (int)p_amf_string->size, p_amf_string->data);
+
+        uint8_t type = read_amf_data(ifh, parse_file, arena, &p_amf_obj_property->p_data_value);
+        amf_list_push(&p_amf_emca_array->object_property_lst, p_amf_obj_property);
+        if (type == AMF_TYPE_OBJECT_END)
+        {
+            break;
+        }
+    }
+    return arr_size;
+}
+
+uint32_t read_strict_array(flv_reader_t *ifh, flv_writer_t *parse_file, flv_arena_t *arena, amf_strict_array_t **pp_amf_strict_array)
+{
+    if (NULL == *pp_amf_strict_array)
+    {
+        *pp_amf_strict_array = flv_arena_new<amf_strict_array_t>(arena);
+    }
+    amf_strict_array_t *p_amf_strict_array = *pp_amf_strict_array;
+    uint32_t &arr_size = p_amf_strict_array->arr_len;
+    uint8_t be_size[4] = { 0 };
+    flv_reader_read(ifh, be_size, sizeof(be_size));
+    arr_size = flv_get_be32(be_size);
+    flv_writer_printf(parse_file, "strict_array:\n");
+    for (uint32_t i = 0; i < arr_size && !flv_reader_eof(ifh); ++i)
+    {
+        flv_writer_printf(parse_file, "\tvalue%u: ", i);
+        amf_data_value_t *p_amf_data = NULL;
+        read_amf_data(ifh, parse_file, arena, &p_amf_data);
+        amf_list_push(&p_amf_strict_array->amf_data_value_lst, p_amf_data);
+    }
+    return arr_size;
+}
+
+const uint8_t *read_end_marker(flv_reader_t *ifh, flv_arena_t *arena, amf_data_value_t *p_amf_marker)
+{
+    if (NULL == p_amf_marker)
+    {
+        return NULL;
+    }
+    amf_object_end_marker_t *p_end_marker = NULL;
+    switch (p_amf_marker->type)
+    {
+    case AMF_TYPE_OBJECT:
+        if (NULL == p_amf_marker->data_value.p_object)
+        {
+            p_amf_marker->data_value.p_object = flv_arena_new<amf_object_t>(arena);
+        }
+        p_end_marker = &p_amf_marker->data_value.p_object->object_end_marker;
+        break;
+    case AMF_TYPE_ECMA_ARRAY:
+        if (NULL == p_amf_marker->data_value.p_emca_array)
+        {
+            p_amf_marker->data_value.p_emca_array = flv_arena_new<amf_emca_array_t>(arena);
+        }
+        p_end_marker = &p_amf_marker->data_value.p_emca_array->object_end_marker;
+        break;
+    default:
+        break;
+    }
+    if (NULL != p_end_marker)
+    {
+        uint24_t &end_marker = p_end_marker->end_mark;
+        flv_reader_read(ifh, (char *)end_marker, sizeof(end_marker));
+
+        //the stored marker is the canonical one whatever the file holds, in release builds too
+        end_marker[0] = FLV_OBJECT_END_MARKER[0];
+        end_marker[1] = FLV_OBJECT_END_MARKER[1];
+        end_marker[2] = FLV_OBJECT_END_MARKER[2];
+        assert(memcmp(end_marker, FLV_OBJECT_END_MARKER, sizeof(end_marker)) == 0);
+        return end_marker;
+    }
+    return NULL;
+}
+
+uint8_t read_amf_data(flv_reader_t *ifh, flv_writer_t *parse_file, flv_arena_t *arena, amf_data_value_t **pp_amf_data)
+{
+    if (NULL == *pp_amf_data)
+    {
+        *pp_amf_data = flv_arena_new<amf_data_value_t>(arena);
+    }
+    uint8_t type = read_byte(ifh, &(*pp_amf_data)->type);
+    switch (type)
+    {
+    case AMF_TYPE_NUMBER:
+        {
+            amf_number_t dfn = read_number(ifh, &(*pp_amf_data)->data_value.number);
+            flv_writer_printf(parse_file, "%0.2lf\n", dfn);
+        }
+        break;
+    case AMF_TYPE_BOOLEAN:
+        {
+            uint8_t cn = read_byte(ifh, &(*pp_amf_data)->data_value.boolean_vaule);
+            flv_writer_printf(parse_file, "%d\n", cn);
+        }
+        break;
+    case AMF_TYPE_STRING:
+        {
+            amf_string_t &value = (*pp_amf_data)->data_value.string_value;
+            read_string(ifh, arena, &value);
+            flv_writer_printf(parse_file, "%.*s\n", (int)value.size, value.data);
+        }
+        break;
+    case AMF_TYPE_OBJECT:
+        {
+            flv_writer_printf(parse_file, "\n");
+            uint32_t nobject = read_object(ifh, parse_file, arena, &(*pp_amf_data)->data_value.p_object);
+            flv_writer_printf(parse_file, "object's num = %d\n", nobject);
+        }
+        break;
+    case AMF_TYPE_REFERENCE:
+        {
+            unsigned short reference = 0;
+            flv_reader_read(ifh, (char *)&reference, sizeof(reference));
+            flv_writer_printf(parse_file, "%u\n", reference);
+        }
+        break;
+    case AMF_TYPE_ECMA_ARRAY:
+        {
+            flv_writer_printf(parse_file, "\n");
+            uint32_t narr = read_emca_array(ifh, parse_file, arena, &(*pp_amf_data)->data_value.p_emca_array);
+            flv_writer_printf(parse_file, "emca_array's num = %d\n", narr);
+        }
+        break;
+    case AMF_TYPE_OBJECT_END:
+        {
+            read_end_marker(ifh, arena, *pp_amf_data);
+        }
+        break;
+    case AMF_TYPE_STRICT_ARRAY:
+        {
+            flv_writer_printf(parse_file, "\n");
+            uint32_t nsarr = read_strict_array(ifh, parse_file, arena, &(*pp_amf_data)->data_value.p_strict_array);
+            flv_writer_printf(parse_file, "strict_array's num = %d\n", nsarr);
+        }
+        break;
+    case AMF_TYPE_LONG_STRING:
+        {
+            amf_long_string_t &value = (*pp_amf_data)->data_value.long_string_value;
+            read_long_string(ifh, arena, &value);
+            flv_writer_printf(parse_file, "%.*s\n", (int)value.size, value.data);
+        }
+        break;
+    default:
+        break;
+    }
+    return type;
+}
+
+//span_need - true when n more bytes are there, else the span is marked bad and emptied
+static inline bool span_need(amf_span_t *span, size_t n)
+{
+    if ((size_t)(span->end - span->p) < n)
+    {
+        span->p = span->end;
+        span->error = 1;
+        return false;
+    }
+    return true;
+}
+
+static inline uint8_t span_u8(amf_span_t *span)
+{
+    return span_need(span, 1) ? *span->p++ : 0;
+}
+
+static inline uint32_t span_be16(amf_span_t *span)
+{
+    if (!span_need(span, 2))
+    {
+        return 0;
+    }
+    uint32_t v = flv_get_be16(span->p);
+    span->p += 2;
+    return v;
+}
+
+static inline uint32_t span_be32(amf_span_t *span)
+{
+    if (!span_need(span, 4))
+    {
+        return 0;
+    }
+    uint32_t v = flv_get_be32(span->p);
+    span->p += 4;
+    return v;
+}
+
+static inline amf_number_t span_number(amf_span_t *span)
+{
+    amf_number_t dn = 0;
+    if (span_need(span, sizeof(dn)))
+    {
+        uint64_t bits = flv_get_be64(span->p);
+        memcpy(&dn, &bits, sizeof(dn));
+        span->p += sizeof(dn);
+    }
+    return dn;
+}
+
+//span_chars - a view of the next n bytes
+static inline const uint8_t *span_chars(amf_span_t *span, uint32_t n)
+{
+    if (!span_need(span, n))
+    {
+        return (const uint8_t *)"";
+    }
+    const uint8_t *p = span->p;
+    span->p += n;
+    return p;
+}
+
+static inline bool span_at_end_marker(const amf_span_t *span)
+{
+    return span->end - span->p >= 3 && span->p[0] == 0 && span->p[1] == 0 && span->p[2] == AMF_TYPE_OBJECT_END;
+}
+
+static void decode_value(amf_span_t *span, flv_arena_t *arena, amf_data_value_t *p_amf_data, int depth);
+
+//decode_properties - name/value pairs up to the end marker, or count of them for an ECMA array
+static void decode_properties(amf_span_t *span, flv_arena_t *arena, amf_obj_property_list_t *lst, uint32_t count,
+    bool counted, int depth)
+{
+    for (uint32_t i = 0; !span->error && span->p < span->end && (!counted || i < count || !span_at_end_marker(span)); ++i)
+    {
+        amf_object_property_t *p_property = flv_arena_new<amf_object_property_t>(arena);
+        p_property->property_name.size = (uint16_t)span_be16(span);
+        p_property->property_name.data = span_chars(span, p_property->property_name.size);
+        p_property->p_data_value = flv_arena_new<amf_data_value_t>(arena);
+        decode_value(span, arena, p_property->p_data_value, depth + 1);
+        amf_list_push(lst, p_property);
+        if (p_property->p_data_value->type == AMF_TYPE_OBJECT_END)
+        {
+            return;
+        }
+    }
+    if (counted && span_at_end_marker(span))
+    {
+        //the ECMA array's own end marker is consumed, not listed
+        span->p += 3;
+    }
+}
+
+static void decode_value(amf_span_t *span, flv_arena_t *arena, amf_data_value_t *p_amf_data, int depth)
+{
+    if (depth > AMF_MAX_DEPTH)
+    {
+        span->error = 1;
+        return;
+    }
+    p_amf_data->type = span_u8(span);
+    amf_data_value_t::data_value_t &value = p_amf_data->data_value;
+    switch (p_amf_data->type)
+    {
+    case AMF_TYPE_NUMBER:
+        value.number = span_number(span);
+        break;
+    case AMF_TYPE_BOOLEAN:
+        value.boolean_vaule = span_u8(span);
+        break;
+    case AMF_TYPE_STRING:
+        value.string_value.size = (uint16_t)span_be16(span);
+        value.string_value.data = span_chars(span, value.string_value.size);
+        break;
+    case AMF_TYPE_OBJECT:
+        value.p_object = flv_arena_new<amf_object_t>(arena);
+        decode_properties(span, arena, &value.p_object->object_property_lst, 0, false, depth);
+        break;
+    case AMF_TYPE_NULL:
+    case AMF_TYPE_UNDEFINED:
+    case AMF_TYPE_OBJECT_END:
+        break;
+    case AMF_TYPE_REFERENCE:
+        value.reference_number = (uint16_t)span_be16(span);
+        break;
+    case AMF_TYPE_ECMA_ARRAY:
+        value.p_emca_array = flv_arena_new<amf_emca_array_t>(arena);
+        value.p_emca_array->arr_len = span_be32(span);
+        decode_properties(span, arena, &value.p_emca_array->object_property_lst, value.p_emca_array->arr_len, true, depth);
+        break;
+    case AMF_TYPE_STRICT_ARRAY:
+        {
+            amf_strict_array_t *p_strict_array = value.p_strict_array = flv_arena_new<amf_strict_array_t>(arena);
+            uint32_t count = p_strict_array->arr_len = span_be32(span);
+            //every element takes at least its type byte, anything larger is corrupt
+            if (count > (size_t)(span->end - span->p))
+            {
+                span->error = 1;
+                break;
+            }
+            if (count == 0)
+            {
+                break;
+            }
+            //all elements in one block, linked in order
+            amf_data_value_t *p_items = (amf_data_value_t *)flv_arena_alloc(arena, count * sizeof(amf_data_value_t));
+            if (NULL == p_items)
+            {
+                span->error = 1;
+                break;
+            }
+            //every node is written once, no clearing pass over the block first
+            uint32_t i = 0;
+            for (; i < count && !span->error; ++i)
+            {
+                amf_data_value_t *p_item = &p_items[i];
+                p_item->next = p_item + 1;
+                //keyframes tables are runs of numbers, decode those inline
+                if (span->end - span->p >= 9 && span->p[0] == AMF_TYPE_NUMBER)
+                {
+                    uint64_t bits = flv_get_be64(span->p + 1);
+                    p_item->type = AMF_TYPE_NUMBER;
+                    memcpy(&p_item->data_value.number, &bits, sizeof(bits));
+                    span->p += 9;
+                    continue;
+                }
+                memset(&p_item->data_value, 0, sizeof(p_item->data_value));
+                decode_value(span, arena, p_item, depth + 1);
+            }
+            p_items[i - 1].next = NULL;
+            amf_script_data_list_t &lst = p_strict_array->amf_data_value_lst;
+            lst.first = p_items;
+            lst.last = &p_items[i - 1];
+            lst.count = i;
+        }
+        break;
+    case AMF_TYPE_DATE:
+        value.date_value.date_time = span_number(span);
+        value.date_value.offset = (int16_t)span_be16(span);
+        break;
+    case AMF_TYPE_LONG_STRING:
+        value.long_string_value.size = span_be32(span);
+        value.long_string_value.data = span_chars(span, value.long_string_value.size);
+        break;
+    default:
+        //movie clips, AMF3 switches and the like can't be skipped safely
+        span->error = 1;
+        break;
+    }
+}
+
+//amf_decode - decode the value at span->p into *pp_amf_data (allocated when NULL), returns its type
+uint8_t amf_decode(amf_span_t *span, flv_arena_t *arena, amf_data_value_t **pp_amf_data)
+{
+    if (NULL == *pp_amf_data)
+    {
+        *pp_amf_data = flv_arena_new<amf_data_value_t>(arena);
+    }
+    decode_value(span, arena, *pp_amf_data, 0);
+    return (*pp_amf_data)->type;
+}
+
+//amf_decode_script - decode every value of a script tag body (name, value, ...) onto lst
+uint32_t amf_decode_script(const uint8_t *body, size_t len, flv_arena_t *arena, amf_script_data_list_t *lst)
+{
+    amf_span_t span;
+    amf_span_init(&span, body, len);
+    uint32_t count = 0;
+    while (span.p < span.end)
+    {
+        amf_data_value_t *p_amf_data = NULL;
+        amf_decode(&span, arena, &p_amf_data);
+        if (span.error)
+        {
+            break;
+        }
+        amf_list_push(lst, p_amf_data);
+        ++count;
+    }
+    return count;
+}
+
+//amf_log_data - write a decoded value the way the stream readers log it
+void amf_log_data(flv_writer_t *parse_file, const amf_data_value_t *p_data_value)
+{
+    if (NULL == parse_file || NULL == p_data_value)
+    {
+        return;
+    }
+    const amf_data_value_t::data_value_t &value = p_data_value->data_value;
+    switch (p_data_value->type)
+    {
+    case AMF_TYPE_NUMBER:
+        flv_writer_printf(parse_file, "%0.2lf\n", value.number);
+        break;
+    case AMF_TYPE_BOOLEAN:
+        flv_writer_printf(parse_file, "%d\n", value.boolean_vaule);
+        break;
+    case AMF_TYPE_STRING:
+        flv_writer_printf(parse_file, "%.*s\n", (int)value.string_value.size, value.string_value.data);
+        break;
+    case AMF_TYPE_OBJECT:
+        {
+            uint32_t nobject = 0;
+            flv_writer_printf(parse_file, "\nobject:\n");
+            for (const amf_object_property_t *p_property = value.p_object->object_property_lst.first;
+                p_property != NULL; p_property = p_property->next)
+            {
+                if (p_property->property_name.size)
+                {
+                    flv_writer_printf(parse_file, "\t%.*s: ", (int)p_property->property_name.size, p_property->property_name.data);
+                }
+                amf_log_data(parse_file, p_property->p_data_value);
+                nobject += (p_property->p_data_value->type != AMF_TYPE_OBJECT_END);
+            }
+            flv_writer_printf(parse_file, "object's num = %d\n", nobject);
+        }
+        break;
+    case AMF_TYPE_REFERENCE:
+        flv_writer_printf(parse_file, "%u\n", value.reference_number);
+        break;
+    case AMF_TYPE_ECMA_ARRAY:
+        flv_writer_printf(parse_file, "\nemca_array:\n");
+        for (const amf_object_property_t *p_property = value.p_emca_array->object_property_lst.first;
+            p_property != NULL; p_property = p_property->next)
+        {
+            flv_writer_printf(parse_file, "\t%.*s: ", (int)p_property->property_name.size, p_property->property_name.data);
+            amf_log_data(parse_file, p_property->p_data_value);
+        }
+        flv_writer_printf(parse_file, "emca_array's num = %d\n", value.p_emca_array->arr_len);
+        break;
+    case AMF_TYPE_STRICT_ARRAY:
+        {
+            uint32_t i = 0;
+            flv_writer_printf(parse_file, "\nstrict_array:\n");
+            for (const amf_data_value_t *p_item = value.p_strict_array->amf_data_value_lst.first; p_item != NULL; p_item = p_item->next)
+            {
+                flv_writer_printf(parse_file, "\tvalue%u: ", i++);
+                amf_log_data(parse_file, p_item);
+            }
+            flv_writer_printf(parse_file, "strict_array's num = %d\n", value.p_strict_array->arr_len);
+        }
+        break;
+    case AMF_TYPE_DATE:
+        flv_writer_printf(parse_file, "%0.2lf\n", value.date_value.date_time);
+        break;
+    case AMF_TYPE_LONG_STRING:
+        flv_writer_printf(parse_file, "%.*s\n", (int)value.long_string_value.size, value.long_string_value.data);
+        break;
+    default:
+        break;
+    }
+}
+
+static void skip_value(amf_span_t *span, int depth);
+
+//skip_properties - step over name/value pairs by the same rules decode_properties reads them
+static void skip_properties(amf_span_t *span, uint32_t count, bool counted, int depth)
+{
+    for (uint32_t i = 0; !span->error && span->p < span->end && (!counted || i < count || !span_at_end_marker(span)); ++i)
+    {
+        span_chars(span, span_be16(span));
+        bool end_marker = (span->p < span->end && *span->p == AMF_TYPE_OBJECT_END);
+        skip_value(span, depth + 1);
+        if (end_marker)
+        {
+            return;
+        }
+    }
+    if (counted && span_at_end_marker(span))
+    {
+        span->p += 3;
+    }
+}
+
+static void skip_value(amf_span_t *span, int depth)
+{
+    if (depth > AMF_MAX_DEPTH)
+    {
+        span->error = 1;
+        return;
+    }
+    switch (span_u8(span))
+    {
+    case AMF_TYPE_NUMBER:
+        span_chars(span, 8);
+        break;
+    case AMF_TYPE_BOOLEAN:
+        span_chars(span, 1);
+        break;
+    case AMF_TYPE_STRING:
+        span_chars(span, span_be16(span));
+        break;
+    case AMF_TYPE_OBJECT:
+        skip_properties(span, 0, false, depth);
+        break;
+    case AMF_TYPE_NULL:
+    case AMF_TYPE_UNDEFINED:
+    case AMF_TYPE_OBJECT_END:
+        break;
+    case AMF_TYPE_REFERENCE:
+        span_chars(span, 2);
+        break;
+    case AMF_TYPE_ECMA_ARRAY:
+        {
+            uint32_t count = span_be32(span);
+            skip_properties(span, count, true, depth);
+        }
+        break;
+    case AMF_TYPE_STRICT_ARRAY:
+        {
+            uint32_t count = span_be32(span);
+            for (uint32_t i = 0; i < count && !span->error; ++i)
+            {
+                //numbers are the common case, step over them without the call
+                if (span->end - span->p >= 9 && span->p[0] == AMF_TYPE_NUMBER)
+                {
+                    span->p += 9;
+                    continue;
+                }
+                skip_value(span, depth + 1);
+            }
+        }
+        break;
+    case AMF_TYPE_DATE:
+        span_chars(span, 10);
+        break;
+    case AMF_TYPE_LONG_STRING:
+        span_chars(span, span_be32(span));
+        break;
+    default:
+        span->error = 1;
+        break;
+    }
+}
+
+//amf_skip - step over the value at span->p without decoding it, 0 or -1 on corrupt data
+int amf_skip(amf_span_t *span)
+{
+    skip_value(span, 0);
+    return span->error ? -1 : 0;
+}
+
+//amf_lazy_open - index the top-level properties of a script tag body, -1 if it is corrupt
+int amf_lazy_open(amf_lazy_t *lazy, const uint8_t *body, size_t len)
+{
+    amf_span_t span;
+    amf_span_init(&span, body, len);
+    lazy->name.size = 0;
+    lazy->name.data = (const uint8_t *)"";
+    lazy->props.clear();
+    lazy->end = span.end;
+
+    //the name is optional, some tags carry a bare value
+    if (span.p < span.end && *span.p == AMF_TYPE_STRING)
+    {
+        ++span.p;
+        lazy->name.size = (uint16_t)span_be16(&span);
+        lazy->name.data = span_chars(&span, lazy->name.size);
+    }
+    lazy->type = span_u8(&span);
+    if (lazy->type != AMF_TYPE_OBJECT && lazy->type != AMF_TYPE_ECMA_ARRAY)
+    {
+        return span.error ? -1 : 0;
+    }
+
+    uint32_t count = (lazy->type == AMF_TYPE_ECMA_ARRAY) ? span_be32(&span) : 0;
+    for (uint32_t i = 0; !span.error && span.p < span.end; ++i)
+    {
+        if (span_at_end_marker(&span) && (lazy->type == AMF_TYPE_OBJECT || i >= count))
+        {
+            break;
+        }
+        amf_lazy_prop_t prop;
+        prop.name.size = (uint16_t)span_be16(&span);
+        prop.name.data = span_chars(&span, prop.name.size);
+        prop.value = span.p;
+        prop.type = (span.p < span.end) ? *span.p : AMF_TYPE_UNDEFINED;
+        skip_value(&span, 1);
+        if (span.error)
+        {
+            break;
+        }
+        lazy->props.push_back(prop);
+    }
+    return span.error ? -1 : 0;
+}
+
+//match_segment - compare a property name with the path up to the next '.'
+static inline bool match_segment(const amf_string_t &name, const char *segment, size_t len)
+{
+    return name.size == len && memcmp(name.data, segment, len) == 0;
+}
+
+//amf_lazy_locate - put span on the value at path (names joined by '.', array elements by index), returns its type or -1
+int amf_lazy_locate(const amf_lazy_t *lazy, const char *path, amf_span_t *span)
+{
+    const char *segment = path;
+    size_t len = strcspn(segment, ".");
+    const amf_lazy_prop_t *prop = NULL;
+    for (size_t i = 0; i < lazy->props.size() && NULL == prop; ++i)
+    {
+        prop = match_segment(lazy->props[i].name, segment, len) ? &lazy->props[i] : NULL;
+    }
+    if (NULL == prop)
+    {
+        return -1;
+    }
+    amf_span_init(span, prop->value, lazy->end - prop->value);
+
+    //walk down the remaining segments by skipping the siblings
+    for (segment += len; *segment == '.'; segment += len)
+    {
+        ++segment;
+        len = strcspn(segment, ".");
+        uint8_t type = span_u8(span);
+        bool found = false;
+        if (type == AMF_TYPE_OBJECT || type == AMF_TYPE_ECMA_ARRAY)
+        {
+            uint32_t count = (type == AMF_TYPE_ECMA_ARRAY) ? span_be32(span) : 0;
+            for (uint32_t i = 0; !span->error && span->p < span->end && !found; ++i)
+            {
+                if (span_at_end_marker(span) && (type == AMF_TYPE_OBJECT || i >= count))
+                {
+                    break;
+                }
+                amf_string_t name;
+                name.size = (uint16_t)span_be16(span);
+                name.data = span_chars(span, name.size);
+                found = match_segment(name, segment, len);
+                if (!found)
+                {
+                    skip_value(span, 1);
+                }
+            }
+        }
+        else if (type == AMF_TYPE_STRICT_ARRAY && len > 0 && strspn(segment, "0123456789") == len)
+        {
+            uint32_t index = (uint32_t)strtoul(segment, NULL, 10);
+            uint32_t count = span_be32(span);
+            for (uint32_t i = 0; i < index && i < count && !span->error; ++i)
+            {
+                skip_value(span, 1);
+            }
+            found = (index < count);
+        }
+        if (!found || span->error)
+        {
+            return -1;
+        }
+    }
+    return (span->p < span->end) ? *span->p : -1;
+}
+
+//amf_lazy_get - decode only the value at path, NULL if there is none
+amf_data_value_t *amf_lazy_get(const amf_lazy_t *lazy, const char *path, flv_arena_t *arena)
+{
+    amf_span_t span;
+    if (amf_lazy_locate(lazy, path, &span) < 0)
+    {
+        return NULL;
+    }
+    amf_data_value_t *p_amf_data = NULL;
+    amf_decode(&span, arena, &p_amf_data);
+    return span.error ? NULL : p_amf_data;
+}
+
+//amf_lazy_number - read the number at path without an arena, -1 if it is missing or not a number
+int amf_lazy_number(const amf_lazy_t *lazy, const char *path, amf_number_t *p_amf_number)
+{
+    amf_span_t span;
+    if (amf_lazy_locate(lazy, path, &span) != AMF_TYPE_NUMBER)
+    {
+        return -1;
+    }
+    ++span.p;
+    *p_amf_number = span_number(&span);
+    return span.error ? -1 : 0;
+}
+
+//put_bytes - grow out by n bytes and return where they go
+static inline uint8_t *put_bytes(std::vector<uint8_t> *out, size_t n)
+{
+    size_t at = out->size();
+    out->resize(at + n);
+    return &(*out)[at];
+}
+
+void write_byte(std::vector<uint8_t> *out, uint8_t amf_byte)
+{
+    out->push_back(amf_byte);
+}
+
+void write_number(std::vector<uint8_t> *out, amf_number_t amf_number)
+{
+    uint64_t bits;
+    memcpy(&bits, &amf_number, sizeof(bits));
+    flv_put_be64(put_bytes(out, sizeof(bits)), bits);
+}
+
+//write_string - size and bytes, the type byte is up to the caller as with read_string
+void write_string(std::vector<uint8_t> *out, const amf_string_t *p_amf_string)
+{
+    flv_put_be16(put_bytes(out, 2), p_amf_string->size);
+    out->insert(out->end(), p_amf_string->data, p_amf_string->data + p_amf_string->size);
+}
+
+void write_long_string(std::vector<uint8_t> *out, const amf_long_string_t *p_amf_long_string)
+{
+    flv_put_be32(put_bytes(out, 4), p_amf_long_string->size);
+    out->insert(out->end(), p_amf_long_string->data, p_amf_long_string->data + p_amf_long_string->size);
+}
+
+void write_datadate(std::vector<uint8_t> *out, const amf_date_t *p_amf_datadate)
+{
+    write_number(out, p_amf_datadate->date_time);
+    flv_put_be16(put_bytes(out, 2), (uint16_t)p_amf_datadate->offset);
+}
+
+//write_properties - name/value pairs, an end marker read into the list is left for the caller to write
+static uint32_t write_properties(std::vector<uint8_t> *out, const amf_obj_property_list_t *lst)
+{
+    uint32_t count = 0;
+    for (const amf_object_property_t *p_property = lst->first; p_property != NULL; p_property = p_property->next)
+    {
+        if (p_property->p_data_value->type == AMF_TYPE_OBJECT_END)
+        {
+            continue;
+        }
+        write_string(out, &p_property->property_name);
+        write_amf_data(out, p_property->p_data_value);
+        ++count;
+    }
+    return count;
+}
+
+uint32_t write_object(std::vector<uint8_t> *out, const amf_object_t *p_amf_object)
+{
+    uint32_t count = write_properties(out, &p_amf_object->object_property_lst);
+    write_end_marker(out);
+    return count;
+}
+
+//write_emca_array - the length is counted from the properties, not taken from arr_len
+uint32_t write_emca_array(std::vector<uint8_t> *out, const amf_emca_array_t *p_amf_emca_array)
+{
+    size_t len_at = out->size();
+    put_bytes(out, 4);
+    uint32_t count = write_properties(out, &p_amf_emca_array->object_property_lst);
+    flv_put_be32(&(*out)[len_at], count);
+    write_end_marker(out);
+    return count;
+}
+
+uint32_t write_strict_array(std::vector<uint8_t> *out, const amf_strict_array_t *p_amf_strict_array)
+{
+    const amf_script_data_list_t &lst = p_amf_strict_array->amf_data_value_lst;
+    flv_put_be32(put_bytes(out, 4), lst.count);
+    for (const amf_data_value_t *p_item = lst.first; p_item != NULL; p_item = p_item->next)
+    {
+        write_amf_data(out, p_item);
+    }
+    return lst.count;
+}
+
+void write_end_marker(std::vector<uint8_t> *out)
+{
+    uint8_t *p = put_bytes(out, 3);
+    flv_put_be16(p, 0);
+    p[2] = AMF_TYPE_OBJECT_END;
+}
+
+//write_amf_data - type byte and value, the inverse of read_amf_data and amf_decode
+void write_amf_data(std::vector<uint8_t> *out, const amf_data_value_t *p_amf_data)
+{
+    const amf_data_value_t::data_value_t &value = p_amf_data->data_value;
+    write_byte(out, p_amf_data->type);
+    switch (p_amf_data->type)
+    {
+    case AMF_TYPE_NUMBER:
+        write_number(out, value.number);
+        break;
+    case AMF_TYPE_BOOLEAN:
+        write_byte(out, value.boolean_vaule);
+        break;
+    case AMF_TYPE_STRING:
+        write_string(out, &value.string_value);
+        break;
+    case AMF_TYPE_OBJECT:
+        write_object(out, value.p_object);
+        break;
+    case AMF_TYPE_REFERENCE:
+        flv_put_be16(put_bytes(out, 2), value.reference_number);
+        break;
+    case AMF_TYPE_ECMA_ARRAY:
+        write_emca_array(out, value.p_emca_array);
+        break;
+    case AMF_TYPE_STRICT_ARRAY:
+        write_strict_array(out, value.p_strict_array);
+        break;
+    case AMF_TYPE_DATE:
+        write_datadate(out, &value.date_value);
+        break;
+    case AMF_TYPE_LONG_STRING:
+        write_long_string(out, &value.long_string_value);
+        break;
+    default:
+        //null, undefined, a bare end marker and unsupported types are the type byte alone
+        break;
+    }
+}
+
+//amf_encode_script - encode every value of lst back to back, a script tag body; returns the bytes added
+size_t amf_encode_script(const amf_script_data_list_t *lst, std::vector<uint8_t> *out)
+{
+    size_t start = out->size();
+    for (const amf_data_value_t *p_amf_data = lst->first; p_amf_data != NULL; p_amf_data = p_amf_data->next)
+    {
+        write_amf_data(out, p_amf_data);
+    }
+    return out->size() - start;
+}
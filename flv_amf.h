@@ -0,0 +1,123 @@
+// flv_amf.h : AMF0 script data decoding into the amf_* tree of flv_format.h, and back.
+//
+// The readers pull their input from an flv_reader_t positioned on the value
+// and log what they decode to parse_file, which may be NULL when the caller
+// only wants the tree.
+//
+// Every node of a tree comes out of one flv_arena_t and the tree is released
+// with flv_arena_free(). Strings of a mapped input point into the mapping,
+// so such a tree must not outlive its reader.
+//
+// amf_decode() builds the same tree from a script tag body already in memory:
+// bounds-checked big-endian loads, no I/O calls, and strings left as views
+// into the span. The span has to outlive the tree.
+//
+// amf_lazy_open() only records where each top-level property of a script tag
+// starts. Paths such as "keyframes.times" or "keyframes.times.0" are then
+// resolved by skipping over the encoded values, and amf_lazy_get() decodes
+// just the subtree asked for.
+//
+// The write_* functions are the readers run backwards: they append the AMF0
+// encoding of a tree to a byte vector, big-endian, recounting ECMA array
+// lengths and end markers from the lists rather than trusting what was read.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_io.h"
+#include "flv_arena.h"
+
+//********** functions for amf's object
+amf_number_t read_number(flv_reader_t *ifh, amf_number_t *p_amf_number);
+uint8_t read_byte(flv_reader_t *ifh, uint8_t *p_amf_byte);
+const uint8_t *read_string(flv_reader_t *ifh, flv_arena_t *arena, amf_string_t *p_amf_string);
+const uint8_t *read_long_string(flv_reader_t *ifh, flv_arena_t *arena, amf_long_string_t *p_amf_long_string);
+const uint8_t *read_datadate(flv_reader_t *ifh, amf_date_t *p_amf_datadate);
+uint32_t read_object(flv_reader_t *ifh, flv_writer_t *parse_file, flv_arena_t *arena, amf_object_t **pp_amf_object);
+uint32_t read_emca_array(flv_reader_t *ifh, flv_writer_t *parse_file, flv_arena_t *arena, amf_emca_array_t **pp_amf_emca_array);
+uint32_t read_strict_array(flv_reader_t *ifh, flv_writer_t *parse_file, flv_arena_t *arena, amf_strict_array_t **pp_amf_strict_array);
+const uint8_t *read_end_marker(flv_reader_t *ifh, flv_arena_t *arena, amf_data_value_t *p_amf_marker);
+uint8_t read_amf_data(flv_reader_t *ifh, flv_writer_t *parse_file, flv_arena_t *arena, amf_data_value_t **pp_amf_data);
+
+//************ zero-copy decoding over a span of memory
+#define AMF_MAX_DEPTH   64      //deeper nesting is treated as corrupt
+
+typedef struct __amf_span {
+    const uint8_t *p;           //next byte to decode
+    const uint8_t *end;
+    int error;                  //a load ran past end or hit an unknown type
+} amf_span_t;
+
+inline void amf_span_init(amf_span_t *span, const uint8_t *p, size_t len)
+{
+    span->p = p;
+    span->end = p + len;
+    span->error = 0;
+}
+
+uint8_t amf_decode(amf_span_t *span, flv_arena_t *arena, amf_data_value_t **pp_amf_data);
+uint32_t amf_decode_script(const uint8_t *body, size_t len, flv_arena_t *arena, amf_script_data_list_t *lst);
+void amf_log_data(flv_writer_t *parse_file, const amf_data_value_t *p_data_value);
+
+//************ lazy decoding, properties are located first and decoded on demand
+typedef struct __amf_lazy_prop {
+    amf_string_t name;
+    uint8_t type;
+    const uint8_t *value;       //the value's type byte inside the body
+} amf_lazy_prop_t;
+
+typedef struct __amf_lazy {
+    amf_string_t name;          //leading string of the tag, e.g. "onMetaData"
+    uint8_t type;               //type of the value after it
+    std::vector<amf_lazy_prop_t> props;     //its top-level properties when an object or ECMA array
+    const uint8_t *end;         //end of the body
+} amf_lazy_t;
+
+int amf_lazy_open(amf_lazy_t *lazy, const uint8_t *body, size_t len);
+int amf_lazy_locate(const amf_lazy_t *lazy, const char *path, amf_span_t *span);
+amf_data_value_t *amf_lazy_get(const amf_lazy_t *lazy, const char *path, flv_arena_t *arena);
+int amf_lazy_number(const amf_lazy_t *lazy, const char *path, amf_number_t *p_amf_number);
+int amf_skip(amf_span_t *span);
+
+//************ encoding into a byte vector
+void write_byte(std::vector<uint8_t> *out, uint8_t amf_byte);
+void write_number(std::vector<uint8_t> *out, amf_number_t amf_number);
+void write_string(std::vector<uint8_t> *out, const amf_string_t *p_amf_string);
+void write_long_string(std::vector<uint8_t> *out, const amf_long_string_t *p_amf_long_string);
+void write_datadate(std::vector<uint8_t> *out, const amf_date_t *p_amf_datadate);
+uint32_t write_object(std::vector<uint8_t> *out, const amf_object_t *p_amf_object);
+uint32_t write_emca_array(std::vector<uint8_t> *out, const amf_emca_array_t *p_amf_emca_array);
+uint32_t write_strict_array(std::vector<uint8_t> *out, const amf_strict_array_t *p_amf_strict_array);
+void write_end_marker(std::vector<uint8_t> *out);
+void write_amf_data(std::vector<uint8_t> *out, const amf_data_value_t *p_amf_data);
+size_t amf_encode_script(const amf_script_data_list_t *lst, std::vector<uint8_t> *out);
+
+//********** list helpers for amf's object
+inline void amf_list_push(amf_script_data_list_t *lst, amf_data_value_t *p_data_value)
+{
+    if (NULL == lst->last)
+    {
+        lst->first = p_data_value;
+    }
+    else
+    {
+        lst->last->next = p_data_value;
+    }
+    lst->last = p_data_value;
+    ++lst->count;
+}
+
+inline void amf_list_push(amf_obj_property_list_t *lst, amf_object_property_t *p_obj_property)
+{
+    if (NULL == lst->last)
+    {
+        lst->first = p_obj_property;
+    }
+    else
+    {
+        lst->last->next = p_obj_property;
+    }
+    lst->last = p_obj_property;
+    ++lst->count;
+}
@@ -0,0 +1,87 @@
+// flv_arena.cpp : bump allocator implementation.
+
+#include "stdafx.h"
+#include "flv_arena.h"
+
+void flv_arena_init(flv_arena_t *arena)
+{
+    memset(arena, 0, sizeof(*arena));
+}
+
+//add_chunk - start a chunk at least twice the last one and big enough for size
+static bool add_chunk(flv_arena_t *arena, size_t size)
+{
+    size_t chunk_size = (NULL == arena->head) ? FLV_ARENA_FIRST_CHUNK : std::min(arena->head->size * 2, (size_t)FLV_ARENA_MAX_CHUNK);
+    chunk_size = std::max(chunk_size, size);
+    flv_arena_chunk_t *chunk = (flv_arena_chunk_t *)malloc(sizeof(flv_arena_chunk_t) + chunk_size);
+    if (NULL == chunk)
+    {
+        return false;
+    }
+    chunk->next = arena->head;
+    chunk->size = chunk_size;
+    arena->head = chunk;
+    arena->cur = (uint8_t *)(chunk + 1);
+    arena->end = arena->cur + chunk_size;
+    return true;
+}
+
+void *flv_arena_alloc(flv_arena_t *arena, size_t size)
+{
+    size = (size + FLV_ARENA_ALIGNMENT - 1) & ~(size_t)(FLV_ARENA_ALIGNMENT - 1);
+    if ((size_t)(arena->end - arena->cur) < size && !add_chunk(arena, size))
+    {
+        return NULL;
+    }
+    void *p = arena->cur;
+    arena->cur += size;
+    arena->used += size;
+    return p;
+}
+
+//flv_arena_reset - drop every allocation, keeping one chunk as large as all of them so a tree of the same size fits without a malloc
+void flv_arena_reset(flv_arena_t *arena)
+{
+    if (NULL == arena->head)
+    {
+        return;
+    }
+    if (NULL != arena->head->next)
+    {
+        size_t total = 0;
+        for (const flv_arena_chunk_t *chunk = arena->head; NULL != chunk; chunk = chunk->next)
+        {
+            total += chunk->size;
+        }
+        flv_arena_free(arena);
+        if (!add_chunk(arena, total))
+        {
+            return;
+        }
+    }
+    arena->cur = (uint8_t *)(arena->head + 1);
+    arena->end = arena->cur + arena->head->size;
+    arena->used = 0;
+}
+
+void flv_arena_free(flv_arena_t *arena)
+{
+    flv_arena_chunk_t *chunk = arena->head;
+    while (NULL != chunk)
+    {
+        flv_arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    flv_arena_init(arena);
+}
+
+size_t flv_arena_memory(const flv_arena_t *arena)
+{
+    size_t total = 0;
+    for (const flv_arena_chunk_t *chunk = arena->head; NULL != chunk; chunk = chunk->next)
+    {
+        total += sizeof(flv_arena_chunk_t) + chunk->size;
+    }
+    return total;
+}
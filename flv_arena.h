@@ -0,0 +1,44 @@
+// flv_arena.h : bump allocator for the AMF script data trees.
+//
+// Nodes are carved out of a chain of chunks that grow geometrically, so a
+// tree with thousands of keyframes entries costs a handful of mallocs and is
+// released with one flv_arena_free(), without walking it.
+
+#pragma once
+
+#include "stdafx.h"
+
+//************ arena constants
+#define FLV_ARENA_FIRST_CHUNK   4096
+#define FLV_ARENA_MAX_CHUNK     (1024 * 1024)
+#define FLV_ARENA_ALIGNMENT     8
+
+typedef struct __flv_arena_chunk {
+    struct __flv_arena_chunk *next;     //older chunk
+    size_t size;                        //usable bytes after the chunk header
+} flv_arena_chunk_t;
+
+typedef struct __flv_arena {
+    flv_arena_chunk_t *head;            //chunk being carved, NULL until the first allocation
+    uint8_t *cur;
+    uint8_t *end;
+    size_t used;                        //bytes handed out
+} flv_arena_t;
+
+//********** arena functions
+void flv_arena_init(flv_arena_t *arena);
+void *flv_arena_alloc(flv_arena_t *arena, size_t size);
+void flv_arena_reset(flv_arena_t *arena);
+void flv_arena_free(flv_arena_t *arena);
+size_t flv_arena_memory(const flv_arena_t *arena);
+
+//flv_arena_new - a zeroed T out of the arena, nothing to destruct later
+template <typename T> inline T *flv_arena_new(flv_arena_t *arena)
+{
+    T *p = (T *)flv_arena_alloc(arena, sizeof(T));
+    if (NULL != p)
+    {
+        memset(p, 0, sizeof(T));
+    }
+    return p;
+}
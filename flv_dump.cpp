@@ -0,0 +1,170 @@
+// flv_dump.cpp : binary tag dump implementation.
+
+#include "stdafx.h"
+#include "flv_io.h"
+#include "flv_dump.h"
+
+#define DUMP_CHUNK 4096     //records built between two writes
+
+static bool kept(const flv_filter_t *filter, const flv_tag_index_t *index, uint32_t n)
+{
+    return NULL == filter || !filter->active
+        || flv_filter_match(filter, flv_index_tag_type(index, n), flv_index_av_hdr(index, n), index->timestamp[n]);
+}
+
+static uint64_t padded(uint64_t size)
+{
+    return (size + 7) & ~(uint64_t)7;
+}
+
+//flv_dump_write - the tags of index the filter keeps, with the bodies of the script tags among them
+int flv_dump_write(const char *file_name, const char *name, const flv_hdr_t *flv_hdr, const flv_tag_index_t *index,
+    const flv_filter_t *filter, const std::vector<flv_dump_script_t> &scripts)
+{
+    //number the kept tags first, the blobs refer to them by that number
+    uint32_t tag_count = flv_index_count(index), kept_count = 0;
+    std::vector<flv_dump_blob_t> blobs;
+    std::vector<const flv_dump_script_t *> bodies;
+    size_t script = 0;
+    uint64_t blob_size = 0;
+    for (uint32_t n = 0; n < tag_count; ++n)
+    {
+        bool keep = kept(filter, index, n);
+        for (; script < scripts.size() && scripts[script].tag_num <= n; ++script)
+        {
+            if (keep && scripts[script].tag_num == n)
+            {
+                flv_dump_blob_t blob;
+                blob.tag = kept_count;
+                blob.size = scripts[script].body_len;
+                blob.offset = blob_size;
+                blobs.push_back(blob);
+                bodies.push_back(&scripts[script]);
+                blob_size += padded(blob.size);
+            }
+        }
+        kept_count += keep;
+    }
+
+    flv_dump_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, FLV_DUMP_MAGIC, sizeof(hdr.magic));
+    hdr.version = FLV_DUMP_VERSION;
+    hdr.byte_order = FLV_DUMP_BYTE_ORDER;
+    strncpy(hdr.name, name, sizeof(hdr.name) - 1);
+    memcpy(hdr.flv_hdr, flv_hdr, sizeof(flv_hdr_t));
+    hdr.tag_count = kept_count;
+    hdr.blob_count = (uint32_t)blobs.size();
+    hdr.blob_offset = sizeof(hdr) + (uint64_t)kept_count * sizeof(flv_dump_rec_t) + blobs.size() * sizeof(flv_dump_blob_t);
+
+    flv_writer_t *writer = flv_writer_open(file_name);
+    if (NULL == writer)
+    {
+        return -1;
+    }
+    flv_writer_write(writer, &hdr, sizeof(hdr));
+
+    std::vector<flv_dump_rec_t> chunk;
+    chunk.reserve(DUMP_CHUNK);
+    for (uint32_t n = 0; n < tag_count; ++n)
+    {
+        if (!kept(filter, index, n))
+        {
+            continue;
+        }
+        flv_dump_rec_t rec;
+        rec.offset = flv_index_offset(index, n);
+        rec.timestamp = index->timestamp[n];
+        rec.data_size = flv_index_data_size(index, n);
+        rec.pre_tag_size = flv_index_pre_tag_size(index, n);
+        rec.tag_type = flv_index_tag_type(index, n);
+        rec.av_hdr = flv_index_av_hdr(index, n);
+        rec.type_flags = index->type_flags[n];
+        rec.reserved = 0;
+        chunk.push_back(rec);
+        if (chunk.size() == DUMP_CHUNK)
+        {
+            flv_writer_write(writer, &chunk[0], (uint32_t)(chunk.size() * sizeof(flv_dump_rec_t)));
+            chunk.clear();
+        }
+    }
+    if (!chunk.empty())
+    {
+        flv_writer_write(writer, &chunk[0], (uint32_t)(chunk.size() * sizeof(flv_dump_rec_t)));
+    }
+
+    if (!blobs.empty())
+    {
+        flv_writer_write(writer, &blobs[0], (uint32_t)(blobs.size() * sizeof(flv_dump_blob_t)));
+    }
+    static const uint8_t zeros[8] = { 0 };
+    for (size_t i = 0; i < blobs.size(); ++i)
+    {
+        flv_writer_write(writer, bodies[i]->body, blobs[i].size);
+        flv_writer_write(writer, zeros, (uint32_t)(padded(blobs[i].size) - blobs[i].size));
+    }
+    if (flv_writer_close(writer) != 0)
+    {
+        remove(file_name);
+        return -1;
+    }
+    return 0;
+}
+
+//flv_dump_open - map a dump, NULL when it is missing or malformed
+flv_dump_t *flv_dump_open(const char *file_name)
+{
+    flv_dump_t *dump = new flv_dump_t();
+    dump->base = flv_map_file(file_name, &dump->size, &dump->mapped);
+    if (NULL == dump->base || dump->size < sizeof(flv_dump_hdr_t))
+    {
+        flv_dump_close(dump);
+        return NULL;
+    }
+
+    const flv_dump_hdr_t *hdr = (const flv_dump_hdr_t *)dump->base;
+    uint64_t tables = sizeof(flv_dump_hdr_t) + (uint64_t)hdr->tag_count * sizeof(flv_dump_rec_t)
+        + (uint64_t)hdr->blob_count * sizeof(flv_dump_blob_t);
+    if (memcmp(hdr->magic, FLV_DUMP_MAGIC, sizeof(hdr->magic)) != 0
+        || hdr->version != FLV_DUMP_VERSION
+        || hdr->byte_order != FLV_DUMP_BYTE_ORDER
+        || hdr->blob_offset != tables
+        || hdr->blob_offset > dump->size
+        || hdr->name[FLV_DUMP_NAME_SIZE - 1] != 0)
+    {
+        flv_dump_close(dump);
+        return NULL;
+    }
+    dump->hdr = hdr;
+    dump->recs = (const flv_dump_rec_t *)(hdr + 1);
+    dump->blobs = (const flv_dump_blob_t *)(dump->recs + hdr->tag_count);
+    dump->blob_data = (const uint8_t *)dump->base + hdr->blob_offset;
+
+    //every blob has to lie inside the file and belong to a script tag
+    uint64_t blob_size = dump->size - hdr->blob_offset;
+    for (uint32_t i = 0; i < hdr->blob_count; ++i)
+    {
+        const flv_dump_blob_t &blob = dump->blobs[i];
+        if (blob.offset > blob_size || blob.size > blob_size - blob.offset
+            || blob.tag >= hdr->tag_count || dump->recs[blob.tag].tag_type != TAG_TYPE_META
+            || (i > 0 && blob.tag <= dump->blobs[i - 1].tag))
+        {
+            flv_dump_close(dump);
+            return NULL;
+        }
+    }
+    return dump;
+}
+
+void flv_dump_close(flv_dump_t *dump)
+{
+    if (NULL == dump)
+    {
+        return;
+    }
+    if (dump->base != NULL)
+    {
+        flv_unmap_file(dump->base, dump->size, dump->mapped);
+    }
+    delete dump;
+}
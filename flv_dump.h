@@ -0,0 +1,84 @@
+// flv_dump.h : compact binary tag dump (<project>_<n>.flvdump).
+//
+// The same content as the XML dump at a fixed 24 bytes a tag, for tools that
+// load dumps of many files: they map the file and index the records, nothing
+// is parsed. Script tags keep their AMF body as written in the source, in a
+// blob section after the records.
+//
+// Layout, every part 8-byte aligned and in host byte order (byte_order tells
+// a foreign-endian file apart):
+//
+//   flv_dump_hdr_t
+//   tag_count  flv_dump_rec_t      one per tag, in file order
+//   blob_count flv_dump_blob_t     sorted by tag
+//   blob bytes                     each padded to 8 bytes
+//
+// A new version is only needed when a record or the header changes; readers
+// reject any version they don't know.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_index.h"
+#include "flv_filter.h"
+
+//************ dump constants
+#define FLV_DUMP_EXT            "flvdump"
+#define FLV_DUMP_MAGIC          "FLVDUMP"
+#define FLV_DUMP_VERSION        1
+#define FLV_DUMP_BYTE_ORDER     0x01020304
+#define FLV_DUMP_NAME_SIZE      256
+
+typedef struct __flv_dump_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    char name[FLV_DUMP_NAME_SIZE];  //project name, null terminated
+    uint8_t flv_hdr[16];            //the source's FLV header, sizeof(flv_hdr_t) bytes of it
+    uint32_t tag_count;
+    uint32_t blob_count;
+    uint64_t blob_offset;           //file offset of the first blob byte
+} flv_dump_hdr_t;
+
+typedef struct __flv_dump_rec {
+    uint64_t offset;        //file offset of the tag header
+    uint32_t timestamp;     //milliseconds, timestampex included
+    uint32_t data_size;
+    uint32_t pre_tag_size;  //PreviousTagSize ahead of the tag
+    uint8_t tag_type;
+    uint8_t av_hdr;         //first body byte of audio and video tags
+    uint8_t type_flags;     //FLV_INDEX_* bits
+    uint8_t reserved;
+} flv_dump_rec_t;
+
+typedef struct __flv_dump_blob {
+    uint32_t tag;           //record the body belongs to
+    uint32_t size;
+    uint64_t offset;        //from blob_offset
+} flv_dump_blob_t;
+
+//a script tag's body handed to flv_dump_write, by its number in the index
+typedef struct __flv_dump_script {
+    uint32_t tag_num;
+    const uint8_t *body;
+    uint32_t body_len;
+} flv_dump_script_t;
+
+typedef struct __flv_dump {
+    const flv_dump_hdr_t *hdr;
+    const flv_dump_rec_t *recs;
+    const flv_dump_blob_t *blobs;
+    const uint8_t *blob_data;
+    void *base;
+    size_t size;
+    int mapped;
+} flv_dump_t;
+
+//********** dump functions
+int flv_dump_write(const char *file_name, const char *name, const flv_hdr_t *flv_hdr, const flv_tag_index_t *index,
+    const flv_filter_t *filter, const std::vector<flv_dump_script_t> &scripts);
+flv_dump_t *flv_dump_open(const char *file_name);
+void flv_dump_close(flv_dump_t *dump);
+
+inline const uint8_t *flv_dump_blob_body(const flv_dump_t *dump, const flv_dump_blob_t *blob) { return dump->blob_data + blob->offset; }
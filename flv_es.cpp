@@ -0,0 +1,333 @@
+// flv_es.cpp : elementary stream framing implementation.
+
+#include "stdafx.h"
+#include "flv_es.h"
+
+static const uint32_t aac_sample_rates[13] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+typedef struct __bit_reader {
+    const uint8_t *p;
+    uint32_t bits;          //bits available
+    uint32_t pos;           //bits consumed
+} bit_reader_t;
+
+//read_bits - the next n (<= 24) bits MSB first, 0 past the end
+static uint32_t read_bits(bit_reader_t *br, uint32_t n)
+{
+    uint32_t v = 0;
+    for (uint32_t i = 0; i < n; ++i, ++br->pos)
+    {
+        uint32_t bit = (br->pos < br->bits) ? (br->p[br->pos >> 3] >> (7 - (br->pos & 7))) & 1 : 0;
+        v = (v << 1) | bit;
+    }
+    return v;
+}
+
+//read_ue - unsigned Exp-Golomb code
+static uint32_t read_ue(bit_reader_t *br)
+{
+    uint32_t zeros = 0;
+    while (br->pos < br->bits && read_bits(br, 1) == 0 && zeros < 31)
+    {
+        ++zeros;
+    }
+    return (zeros == 0) ? 0 : ((1u << zeros) - 1 + read_bits(br, zeros));
+}
+
+//read_se - signed Exp-Golomb code
+static int32_t read_se(bit_reader_t *br)
+{
+    uint32_t v = read_ue(br);
+    return (v & 1) ? (int32_t)((v + 1) / 2) : -(int32_t)(v / 2);
+}
+
+//read_object_type - 5 bits, 31 escapes to 32 + the next 6
+static uint32_t read_object_type(bit_reader_t *br)
+{
+    uint32_t object_type = read_bits(br, 5);
+    return (object_type == 31) ? 32 + read_bits(br, 6) : object_type;
+}
+
+//read_freq_index - 4 bits, 15 means an explicit 24 bit rate which gets the nearest index
+static uint32_t read_freq_index(bit_reader_t *br)
+{
+    uint32_t freq_index = read_bits(br, 4);
+    if (freq_index == 15)
+    {
+        uint32_t rate = read_bits(br, 24);
+        freq_index = 0;
+        for (uint32_t i = 1; i < 13; ++i)
+        {
+            if ((uint32_t)abs((int)(aac_sample_rates[i] - rate)) < (uint32_t)abs((int)(aac_sample_rates[freq_index] - rate)))
+            {
+                freq_index = i;
+            }
+        }
+    }
+    return freq_index;
+}
+
+//flv_aac_parse_config - decode an AudioSpecificConfig, -1 when ADTS can't carry it
+int flv_aac_parse_config(const uint8_t *p, uint32_t n, flv_aac_config_t *config)
+{
+    bit_reader_t br = { p, n * 8, 0 };
+    config->valid = 0;
+    if (n < 2)
+    {
+        return -1;
+    }
+    uint32_t object_type = read_object_type(&br);
+    uint32_t freq_index = read_freq_index(&br);
+    uint32_t channels = read_bits(&br, 4);
+
+    //SBR/PS (HE-AAC v1/v2): ADTS signals the core AAC at the core rate, the decoder finds SBR implicitly
+    if (object_type == 5 || object_type == 29)
+    {
+        read_freq_index(&br);
+        object_type = read_object_type(&br);
+    }
+
+    //the profile field is 2 bits: Main, LC, SSR, LTP
+    if (object_type < 1 || object_type > 4 || channels > 7)
+    {
+        return -1;
+    }
+    config->object_type = (uint8_t)object_type;
+    config->freq_index = (uint8_t)freq_index;
+    config->channels = (uint8_t)channels;
+    config->valid = 1;
+    return 0;
+}
+
+//flv_aac_sample_rate - Hz of the config's frequency index
+uint32_t flv_aac_sample_rate(const flv_aac_config_t *config)
+{
+    return (config->freq_index < 13) ? aac_sample_rates[config->freq_index] : 0;
+}
+
+//flv_adts_header - the 7 byte header (no CRC) of a frame with payload_len bytes of raw AAC
+void flv_adts_header(const flv_aac_config_t *config, uint32_t payload_len, uint8_t *p)
+{
+    uint32_t frame_len = payload_len + FLV_ADTS_HEADER_SIZE;
+    p[0] = 0xFF;    //syncword
+    p[1] = 0xF1;    //syncword, MPEG-4, layer 0, no CRC
+    p[2] = (uint8_t)(((config->object_type - 1) << 6) | (config->freq_index << 2) | (config->channels >> 2));
+    p[3] = (uint8_t)(((config->channels & 0x03) << 6) | (frame_len >> 11));
+    p[4] = (uint8_t)(frame_len >> 3);
+    p[5] = (uint8_t)(((frame_len & 0x07) << 5) | 0x1F);     //buffer fullness 0x7FF: variable rate
+    p[6] = 0xFC;    //one raw data block
+}
+
+static const uint8_t start_code[4] = { 0, 0, 0, 1 };
+
+//flv_avc_parse_config - decode an AVCDecoderConfigurationRecord, -1 when it is cut short or malformed
+int flv_avc_parse_config(const uint8_t *p, uint32_t n, flv_avc_config_t *config)
+{
+    const uint8_t *end = p + n;
+    config->valid = 0;
+    config->param_sets.clear();
+    if (n < 6 || p[0] != 1 || (p[4] & 0x03) == 2)
+    {
+        return -1;
+    }
+    config->profile = p[1];
+    config->level = p[3];
+    config->length_size = (uint8_t)((p[4] & 0x03) + 1);
+    config->sps_count = 0;
+    config->pps_count = 0;
+    config->width = config->height = 0;
+
+    //numOfSequenceParameterSets then the units, numOfPictureParameterSets then the units
+    p += 5;
+    for (int list = 0; list < 2; ++list)
+    {
+        if (p >= end)
+        {
+            return -1;
+        }
+        uint32_t count = (list == 0) ? (*p++ & 0x1F) : *p++;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (end - p < 2 || (uint32_t)(end - p - 2) < flv_get_be16(p))
+            {
+                return -1;
+            }
+            uint32_t len = flv_get_be16(p);
+            if (list == 0 && i == 0)
+            {
+                flv_avc_parse_sps(p + 2, len, &config->width, &config->height);
+            }
+            config->param_sets.insert(config->param_sets.end(), start_code, start_code + sizeof(start_code));
+            config->param_sets.insert(config->param_sets.end(), p + 2, p + 2 + len);
+            p += 2 + len;
+        }
+        if (list == 0)
+        {
+            config->sps_count = (uint8_t)count;
+        }
+        else
+        {
+            config->pps_count = (uint8_t)count;
+        }
+    }
+    config->valid = 1;
+    return 0;
+}
+
+//skip_scaling_list - step over one scaling_list() of an SPS
+static void skip_scaling_list(bit_reader_t *br, uint32_t size)
+{
+    int32_t last_scale = 8, next_scale = 8;
+    for (uint32_t j = 0; j < size; ++j)
+    {
+        if (next_scale != 0)
+        {
+            next_scale = (last_scale + read_se(br) + 256) % 256;
+        }
+        last_scale = (next_scale == 0) ? last_scale : next_scale;
+    }
+}
+
+//flv_avc_parse_sps - cropped picture size from an SPS NAL unit (header byte included), -1 if it is cut short
+int flv_avc_parse_sps(const uint8_t *p, uint32_t n, uint32_t *width, uint32_t *height)
+{
+    //the RBSP, without emulation prevention bytes (00 00 03)
+    std::vector<uint8_t> rbsp;
+    rbsp.reserve(n);
+    uint32_t zeros = 0;
+    for (uint32_t i = 1; i < n; ++i)
+    {
+        if (zeros >= 2 && p[i] == 3)
+        {
+            zeros = 0;
+            continue;
+        }
+        zeros = (p[i] == 0) ? zeros + 1 : 0;
+        rbsp.push_back(p[i]);
+    }
+    if (rbsp.size() < 4)
+    {
+        return -1;
+    }
+    bit_reader_t br = { &rbsp[0], (uint32_t)rbsp.size() * 8, 0 };
+
+    uint32_t profile_idc = read_bits(&br, 8);
+    read_bits(&br, 16);     //constraint flags, level_idc
+    read_ue(&br);           //seq_parameter_set_id
+    uint32_t chroma_format_idc = 1, separate_colour_plane = 0;
+    if (profile_idc == 100 || profile_idc == 110 || profile_idc == 122 || profile_idc == 244 || profile_idc == 44
+        || profile_idc == 83 || profile_idc == 86 || profile_idc == 118 || profile_idc == 128 || profile_idc == 138
+        || profile_idc == 139 || profile_idc == 134 || profile_idc == 135)
+    {
+        chroma_format_idc = read_ue(&br);
+        if (chroma_format_idc == 3)
+        {
+            separate_colour_plane = read_bits(&br, 1);
+        }
+        read_ue(&br);       //bit_depth_luma_minus8
+        read_ue(&br);       //bit_depth_chroma_minus8
+        read_bits(&br, 1);  //qpprime_y_zero_transform_bypass_flag
+        if (read_bits(&br, 1))
+        {
+            for (uint32_t i = 0; i < ((chroma_format_idc != 3) ? 8u : 12u); ++i)
+            {
+                if (read_bits(&br, 1))
+                {
+                    skip_scaling_list(&br, (i < 6) ? 16 : 64);
+                }
+            }
+        }
+    }
+    read_ue(&br);           //log2_max_frame_num_minus4
+    uint32_t pic_order_cnt_type = read_ue(&br);
+    if (pic_order_cnt_type == 0)
+    {
+        read_ue(&br);       //log2_max_pic_order_cnt_lsb_minus4
+    }
+    else if (pic_order_cnt_type == 1)
+    {
+        read_bits(&br, 1);
+        read_se(&br);
+        read_se(&br);
+        for (uint32_t i = read_ue(&br); i > 0 && br.pos < br.bits; --i)
+        {
+            read_se(&br);
+        }
+    }
+    read_ue(&br);           //max_num_ref_frames
+    read_bits(&br, 1);      //gaps_in_frame_num_value_allowed_flag
+    uint32_t width_mbs = read_ue(&br) + 1;
+    uint32_t height_map_units = read_ue(&br) + 1;
+    uint32_t frame_mbs_only = read_bits(&br, 1);
+    if (!frame_mbs_only)
+    {
+        read_bits(&br, 1);  //mb_adaptive_frame_field_flag
+    }
+    read_bits(&br, 1);      //direct_8x8_inference_flag
+    uint32_t crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    if (read_bits(&br, 1))
+    {
+        crop_left = read_ue(&br);
+        crop_right = read_ue(&br);
+        crop_top = read_ue(&br);
+        crop_bottom = read_ue(&br);
+    }
+    if (br.pos > br.bits)
+    {
+        return -1;
+    }
+
+    //crop units depend on the chroma subsampling
+    uint32_t crop_unit_x = 1, crop_unit_y = 2 - frame_mbs_only;
+    if (chroma_format_idc != 0 && !separate_colour_plane)
+    {
+        crop_unit_x = (chroma_format_idc == 3) ? 1 : 2;
+        crop_unit_y *= (chroma_format_idc == 1) ? 2 : 1;
+    }
+    *width = width_mbs * 16 - crop_unit_x * (crop_left + crop_right);
+    *height = (2 - frame_mbs_only) * height_map_units * 16 - crop_unit_y * (crop_top + crop_bottom);
+    return 0;
+}
+
+//flv_avc_write_annexb - move the n bytes of length-prefixed NAL units at the reader to the writer with
+//start codes, the parameter sets ahead of an IDR unless the access unit brings its own; -1 if one is cut short
+int flv_avc_write_annexb(flv_reader_t *reader, flv_writer_t *writer, const flv_avc_config_t *config, uint32_t n)
+{
+    bool has_sps = false, sent_sps = false;
+    while (n > config->length_size)
+    {
+        const uint8_t *p = flv_reader_peek(reader, config->length_size + 1);
+        if (NULL == p)
+        {
+            return -1;
+        }
+        uint32_t nal_len = 0;
+        for (uint32_t i = 0; i < config->length_size; ++i)
+        {
+            nal_len = (nal_len << 8) | p[i];
+        }
+        if (nal_len == 0 || nal_len > n - config->length_size)
+        {
+            return -1;
+        }
+        uint8_t nal_type = p[config->length_size] & 0x1F;
+        has_sps = has_sps || (nal_type == FLV_AVC_NAL_SPS);
+        if (nal_type == FLV_AVC_NAL_IDR && !has_sps && !sent_sps && !config->param_sets.empty())
+        {
+            flv_writer_write(writer, &config->param_sets[0], (uint32_t)config->param_sets.size());
+            sent_sps = true;
+        }
+
+        //the start code replaces the length, the unit itself goes in one block copy
+        flv_reader_skip(reader, config->length_size);
+        flv_writer_write(writer, start_code, sizeof(start_code));
+        if (flv_copy(reader, writer, nal_len) != nal_len)
+        {
+            return -1;
+        }
+        n -= config->length_size + nal_len;
+    }
+    return 0;
+}
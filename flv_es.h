@@ -0,0 +1,57 @@
+// flv_es.h : elementary stream framing for the codec payloads of the tags.
+//
+// FLV carries AAC as bare access units and sends the decoder setup once, in
+// an AudioSpecificConfig sequence header. A stand-alone .aac file needs an
+// ADTS header in front of every frame instead, which is built here from that
+// config straight into the writer's block. MP3 tags already hold whole MP3
+// frames and are written as they are.
+//
+// AVC is stored as length-prefixed NAL units with the SPS and PPS kept in an
+// AVCDecoderConfigurationRecord. For an Annex-B .h264 stream every NAL unit
+// gets a start code instead, and the parameter sets are repeated in front of
+// each IDR picture so that decoding can begin at any key frame. NAL units go
+// through flv_copy(), so a mapped input reaches the file through writev()
+// without being copied.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_io.h"
+
+//************ ADTS constants
+#define FLV_ADTS_HEADER_SIZE    7       //without CRC
+#define FLV_ADTS_MAX_FRAME      8191    //13 bit frame_length, header included
+
+//************ H.264 NAL unit types
+#define FLV_AVC_NAL_IDR         5
+#define FLV_AVC_NAL_SPS         7
+#define FLV_AVC_NAL_PPS         8
+
+typedef struct __flv_aac_config {
+    uint8_t object_type;    //audio object type, 2 for AAC LC (the core one for HE-AAC)
+    uint8_t freq_index;     //sampling frequency index
+    uint8_t channels;       //channel configuration, 0 when a PCE defines it
+    int valid;
+} flv_aac_config_t;
+
+typedef struct __flv_avc_config {
+    uint8_t profile;
+    uint8_t level;
+    uint8_t length_size;            //bytes in front of every NAL unit: 1, 2 or 4
+    uint8_t sps_count;
+    uint8_t pps_count;
+    uint32_t width;                 //picture size from the first SPS, 0 when it can't be read
+    uint32_t height;
+    std::vector<uint8_t> param_sets;    //the SPS then the PPS units, each behind a start code
+    int valid;
+} flv_avc_config_t;
+
+//********** AAC functions
+int flv_aac_parse_config(const uint8_t *p, uint32_t n, flv_aac_config_t *config);
+uint32_t flv_aac_sample_rate(const flv_aac_config_t *config);
+void flv_adts_header(const flv_aac_config_t *config, uint32_t payload_len, uint8_t *p);
+
+//********** AVC functions
+int flv_avc_parse_config(const uint8_t *p, uint32_t n, flv_avc_config_t *config);
+int flv_avc_parse_sps(const uint8_t *p, uint32_t n, uint32_t *width, uint32_t *height);
+int flv_avc_write_annexb(flv_reader_t *reader, flv_writer_t *writer, const flv_avc_config_t *config, uint32_t n);
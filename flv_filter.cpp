@@ -0,0 +1,138 @@
+// flv_filter.cpp : tag filter implementation.
+
+#include "stdafx.h"
+#include "flv_filter.h"
+
+void flv_filter_init(flv_filter_t *filter)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->to = UINT32_MAX;
+}
+
+//parse_value - the N of a name=N term, -1 when it isn't a number up to max
+static long parse_value(const char *p, long max)
+{
+    char *end = NULL;
+    long v = strtol(p, &end, 10);
+    return (end != p && *end == '\0' && v >= 0 && v <= max) ? v : -1;
+}
+
+//parse_secs - the S of from=S or to=S in ms, -1 when it isn't a number
+static int64_t parse_secs(const char *p)
+{
+    char *end = NULL;
+    double secs = strtod(p, &end);
+    return (end != p && *end == '\0' && secs >= 0 && secs * 1000 < UINT32_MAX) ? (int64_t)(secs * 1000 + 0.5) : -1;
+}
+
+//flv_filter_parse - add the terms of spec to the filter, -1 at the first one that isn't understood
+int flv_filter_parse(flv_filter_t *filter, const char *spec)
+{
+    char term[64];
+    const char *p = spec;
+    while (*p != '\0')
+    {
+        size_t len = strcspn(p, ",");
+        if (len == 0 || len >= sizeof(term))
+        {
+            return -1;
+        }
+        memcpy(term, p, len);
+        term[len] = '\0';
+        p += len + (p[len] == ',');
+
+        long v = 0;
+        int64_t ms = 0;
+        if (strcmp(term, "video") == 0)
+        {
+            filter->types |= 1u << TAG_TYPE_VIDEO;
+        }
+        else if (strcmp(term, "audio") == 0)
+        {
+            filter->types |= 1u << TAG_TYPE_AUDIO;
+        }
+        else if (strcmp(term, "meta") == 0)
+        {
+            filter->types |= 1u << TAG_TYPE_META;
+        }
+        else if (strcmp(term, "key") == 0)
+        {
+            filter->types |= 1u << TAG_TYPE_VIDEO;
+            filter->frame_types |= 1u << FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME;
+        }
+        else if (strncmp(term, "frame=", 6) == 0 && (v = parse_value(term + 6, 15)) >= 0)
+        {
+            filter->frame_types |= (uint16_t)(1u << v);
+        }
+        else if (strncmp(term, "codec=", 6) == 0 && (v = parse_value(term + 6, 15)) >= 0)
+        {
+            filter->codecs |= (uint16_t)(1u << v);
+        }
+        else if (strncmp(term, "sound=", 6) == 0 && (v = parse_value(term + 6, 15)) >= 0)
+        {
+            filter->sound_formats |= (uint16_t)(1u << v);
+        }
+        else if (strncmp(term, "from=", 5) == 0 && (ms = parse_secs(term + 5)) >= 0)
+        {
+            filter->from = (uint32_t)ms;
+        }
+        else if (strncmp(term, "to=", 3) == 0 && (ms = parse_secs(term + 3)) >= 0)
+        {
+            filter->to = (uint32_t)ms;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    filter->active = 1;
+    return 0;
+}
+
+//flv_filter_match - true when a tag with this type, first body byte and timestamp is kept
+bool flv_filter_match(const flv_filter_t *filter, uint8_t tag_type, uint8_t av_hdr, uint32_t timestamp)
+{
+    if (!flv_filter_keeps_type(filter, tag_type) || timestamp < filter->from || timestamp > filter->to)
+    {
+        return false;
+    }
+    if (tag_type == TAG_TYPE_VIDEO)
+    {
+        return (filter->frame_types == 0 || (filter->frame_types & (1u << ((av_hdr >> 4) & 0x0F))))
+            && (filter->codecs == 0 || (filter->codecs & (1u << (av_hdr & 0x0F))));
+    }
+    if (tag_type == TAG_TYPE_AUDIO)
+    {
+        return filter->sound_formats == 0 || (filter->sound_formats & (1u << ((av_hdr >> 4) & 0x0F)));
+    }
+    return true;
+}
+
+//flv_filter_hdr_flags - the FLV header's has_audio/has_video flags without the tag types the filter drops
+uint8_t flv_filter_hdr_flags(const flv_filter_t *filter, uint8_t flags)
+{
+    if (!flv_filter_keeps_type(filter, TAG_TYPE_AUDIO))
+    {
+        flags &= ~0x04;
+    }
+    if (!flv_filter_keeps_type(filter, TAG_TYPE_VIDEO))
+    {
+        flags &= ~0x01;
+    }
+    return flags;
+}
+
+//flv_filter_index - copy the entries of index[first_tag, end_tag) the filter keeps to out, returns how many
+uint32_t flv_filter_index(const flv_filter_t *filter, const flv_tag_index_t *index, uint32_t first_tag, uint32_t end_tag,
+    flv_tag_index_t *out)
+{
+    flv_index_clear(out);
+    for (uint32_t n = first_tag; n < end_tag; ++n)
+    {
+        if (flv_filter_match(filter, flv_index_tag_type(index, n), flv_index_av_hdr(index, n), index->timestamp[n]))
+        {
+            flv_index_copy(out, index, n);
+        }
+    }
+    return flv_index_count(out);
+}
@@ -0,0 +1,46 @@
+// flv_filter.h : tag predicates for thinned renditions of a file.
+//
+// A filter keeps the tags whose already decoded fields match: the tag type,
+// the video frame type and codec id or the audio sound format (all from the
+// first body byte the iterator hands out with the header), and a timestamp
+// range. Nothing else is looked at, so a tag that doesn't match is stepped
+// over by the iterator with a skip inside the block, a seek or a move in the
+// mapping, and its body is never copied or decoded. A mapped file's pages
+// behind it stay untouched; a buffered reader still brings it into the block,
+// which the iterator's sync check fills with the whole tag.
+//
+// A spec is a comma separated list of terms:
+//   video, audio, meta     keep these tag types (every type when none is named)
+//   key                    video key frames only, same as video,frame=1
+//   frame=N, codec=N       video frame type / codec id N, repeat a term to allow several
+//   sound=N                audio sound format N
+//   from=S, to=S           source timestamps from S to S seconds, both included
+//
+// The source's script tags are filtered like any other, but a whole FLV slice
+// still opens with its own onMetaData, built from the tags the filter keeps.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_index.h"
+
+typedef struct __flv_filter {
+    int active;
+    uint32_t types;             //bit per tag type kept, 0 for all
+    uint16_t frame_types;       //bit per video frame type kept, 0 for all
+    uint16_t codecs;            //bit per video codec id kept, 0 for all
+    uint16_t sound_formats;     //bit per audio sound format kept, 0 for all
+    uint32_t from;              //timestamp range, ms
+    uint32_t to;
+} flv_filter_t;
+
+//********** filter functions
+void flv_filter_init(flv_filter_t *filter);
+int flv_filter_parse(flv_filter_t *filter, const char *spec);
+bool flv_filter_match(const flv_filter_t *filter, uint8_t tag_type, uint8_t av_hdr, uint32_t timestamp);
+uint8_t flv_filter_hdr_flags(const flv_filter_t *filter, uint8_t flags);
+uint32_t flv_filter_index(const flv_filter_t *filter, const flv_tag_index_t *index, uint32_t first_tag, uint32_t end_tag,
+    flv_tag_index_t *out);
+
+inline bool flv_filter_keeps_type(const flv_filter_t *filter, uint8_t tag_type) { return filter->types == 0 || (filter->types & (1u << tag_type)) != 0; }
@@ -0,0 +1,178 @@
+// flv_format.h : FLV/AMF0 on-disk layout and the constants used to decode it.
+//
+// The tag and header structs mirror the file byte for byte (packed, big-endian
+// fields left as stored), so they can be read in place from a block or mapping.
+
+#pragma once
+
+#include "stdafx.h"
+
+#define FLV_HEADER_SIGNATURE "FLV"
+#define FLV_OBJECT_END_MARKER "009"
+
+//************ tag types
+#define TAG_TYPE_AUDIO 8
+#define TAG_TYPE_VIDEO 9
+#define TAG_TYPE_META 18
+
+//*********** amf type define
+#define AMF_TYPE_NUMBER          0
+#define AMF_TYPE_BOOLEAN         1
+#define AMF_TYPE_STRING          2
+#define AMF_TYPE_OBJECT          3
+#define AMF_TYPE_MOVIECLIP       4
+#define AMF_TYPE_NULL            5
+#define AMF_TYPE_UNDEFINED       6
+#define AMF_TYPE_REFERENCE       7
+#define AMF_TYPE_ECMA_ARRAY      8
+#define AMF_TYPE_OBJECT_END      9
+#define AMF_TYPE_STRICT_ARRAY   10
+#define AMF_TYPE_DATE           11
+#define AMF_TYPE_LONG_STRING    12
+
+//*********** sound format define
+#define FLV_AUDIO_TAG_SOUND_FORMAT_LINEAR_PCM          0
+#define FLV_AUDIO_TAG_SOUND_FORMAT_ADPCM               1
+#define FLV_AUDIO_TAG_SOUND_FORMAT_MP3                 2
+#define FLV_AUDIO_TAG_SOUND_FORMAT_LINEAR_PCM_LE       3
+#define FLV_AUDIO_TAG_SOUND_FORMAT_NELLYMOSER_16_MONO  4
+#define FLV_AUDIO_TAG_SOUND_FORMAT_NELLYMOSER_8_MONO   5
+#define FLV_AUDIO_TAG_SOUND_FORMAT_NELLYMOSER          6
+#define FLV_AUDIO_TAG_SOUND_FORMAT_G711_A              7
+#define FLV_AUDIO_TAG_SOUND_FORMAT_G711_MU             8
+#define FLV_AUDIO_TAG_SOUND_FORMAT_RESERVED            9
+#define FLV_AUDIO_TAG_SOUND_FORMAT_AAC                 10
+#define FLV_AUDIO_TAG_SOUND_FORMAT_SPEEX               11
+#define FLV_AUDIO_TAG_SOUND_FORMAT_MP3_8               14
+#define FLV_AUDIO_TAG_SOUND_FORMAT_DEVICE_SPECIFIC     15
+
+//*********** sound rate define
+#define FLV_AUDIO_TAG_SOUND_RATE_5_5     0
+#define FLV_AUDIO_TAG_SOUND_RATE_11      1
+#define FLV_AUDIO_TAG_SOUND_RATE_22      2
+#define FLV_AUDIO_TAG_SOUND_RATE_44      3
+
+//*********** mono or sterno sound define
+#define FLV_AUDIO_TAG_SOUND_TYPE_MONO    0
+#define FLV_AUDIO_TAG_SOUND_TYPE_STEREO  1
+
+//*********** sound sample size define
+#define FLV_AUDIO_TAG_SOUND_SIZE_8       0
+#define FLV_AUDIO_TAG_SOUND_SIZE_16      1
+
+//*********** video's codec define
+#define FLV_VIDEO_TAG_CODEC_JPEG            1
+#define FLV_VIDEO_TAG_CODEC_SORENSEN_H263   2
+#define FLV_VIDEO_TAG_CODEC_SCREEN_VIDEO    3
+#define FLV_VIDEO_TAG_CODEC_ON2_VP6         4
+#define FLV_VIDEO_TAG_CODEC_ON2_VP6_ALPHA   5
+#define FLV_VIDEO_TAG_CODEC_SCREEN_VIDEO_V2 6
+#define FLV_VIDEO_TAG_CODEC_AVC             7
+
+//*********** video's frame type define
+#define FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME               1
+#define FLV_VIDEO_TAG_FRAME_TYPE_INTERFRAME             2
+#define FLV_VIDEO_TAG_FRAME_TYPE_DISPOSABLE_INTERFRAME  3
+#define FLV_VIDEO_TAG_FRAME_TYPE_GENERATED_KEYFRAME     4
+#define FLV_VIDEO_TAG_FRAME_TYPE_COMMAND_FRAME          5
+
+//*********** TYPEDEFs
+#pragma pack(push, 1)
+
+typedef uint8_t uint24_t[3];
+typedef double amf_number_t;
+typedef struct __amf_data_value amf_data_value_t;
+typedef struct __amf_object_property amf_object_property_t;
+
+//the AMF tree lives in an flv_arena_t, so its lists are intrusive and need no destructor
+typedef struct __amf_script_data_list {
+    amf_data_value_t *first;
+    amf_data_value_t *last;
+    uint32_t count;
+} amf_script_data_list_t;
+
+typedef struct __amf_obj_property_list {
+    amf_object_property_t *first;
+    amf_object_property_t *last;
+    uint32_t count;
+} amf_obj_property_list_t;
+
+typedef struct __flv_hdr {
+    uint8_t signature[3];
+    uint8_t version;
+    uint8_t flags;
+    uint32_t data_offset;
+} flv_hdr_t;
+
+typedef struct __flv_tag {
+    uint8_t tag_type;
+    uint24_t data_size;
+    uint24_t timestamp;
+    uint8_t timestampex;
+    uint24_t reserved;
+} flv_tag_t;
+
+//strings are views of size bytes, into the arena (NUL terminated) or the mapped input
+typedef struct __amf_string {
+    uint16_t size;
+    const uint8_t *data;
+} amf_string_t;
+
+typedef struct __amf_long_string {
+    uint32_t size;
+    const uint8_t *data;
+} amf_long_string_t;
+
+typedef struct __amf_date {
+    amf_number_t date_time;
+    int16_t offset;
+} amf_date_t;
+
+typedef struct __amf_object_property {
+    amf_string_t property_name;
+    amf_data_value_t *p_data_value;
+    amf_object_property_t *next;
+} amf_object_property_t;
+
+typedef struct __amf_object_end_marker {
+    uint24_t end_mark;
+} amf_object_end_marker_t;
+
+typedef struct __amf_emca_array {
+    uint32_t arr_len;
+    amf_obj_property_list_t object_property_lst;
+    amf_object_end_marker_t object_end_marker;
+} amf_emca_array_t;
+
+typedef struct __amf_object {
+    amf_obj_property_list_t object_property_lst;
+    amf_object_end_marker_t object_end_marker;
+} amf_object_t;
+
+typedef struct __amf_strict_array {
+    uint32_t arr_len;
+    amf_script_data_list_t amf_data_value_lst;
+} amf_strict_array_t;
+
+typedef struct __amf_data_value {
+    uint8_t type;
+    //only the member selected by type is meaningful, the union keeps a (packed) node at 21 bytes
+    typedef union __data_value {
+        amf_number_t number;
+        uint8_t boolean_vaule;
+        uint16_t reference_number;
+        amf_emca_array_t *p_emca_array;
+        amf_strict_array_t *p_strict_array;
+        amf_object_t *p_object;
+        amf_date_t date_value;
+        amf_string_t string_value;
+        amf_long_string_t long_string_value;
+    } data_value_t;
+    data_value_t data_value;
+    amf_data_value_t *next;
+} amf_data_value_t;
+
+#pragma pack(pop)
+
+static_assert(sizeof(amf_data_value_t) == 1 + sizeof(amf_long_string_t) + sizeof(void *),
+    "an AMF node is its type byte, the largest union member and the next pointer");
@@ -0,0 +1,130 @@
+// flv_index.cpp : compact per-tag index implementation.
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_index.h"
+
+void flv_index_clear(flv_tag_index_t *index)
+{
+    std::vector<std::pair<uint32_t, uint64_t> >().swap(index->offset_mark);
+    index->next_offset = 0;
+    std::vector<uint32_t>().swap(index->timestamp);
+    std::vector<uint32_t>().swap(index->size_avhdr);
+    std::vector<uint8_t>().swap(index->type_flags);
+    std::vector<std::pair<uint32_t, uint32_t> >().swap(index->odd_pre_tag_size);
+}
+
+//flv_index_flags - tag type and FLV_INDEX_KEYFRAME/FLV_INDEX_SEQ_HDR from the first body bytes
+uint8_t flv_index_flags(uint8_t tag_type, const uint8_t *body, uint32_t body_len)
+{
+    uint8_t av_hdr = (body_len > 0) ? body[0] : 0;
+    uint8_t flags = tag_type & FLV_INDEX_TYPE_MASK;
+
+    if (tag_type == TAG_TYPE_VIDEO && body_len > 0)
+    {
+        if (((av_hdr >> 4) & 0x0F) == FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME)
+        {
+            flags |= FLV_INDEX_KEYFRAME;
+        }
+        if ((av_hdr & 0x0F) == FLV_VIDEO_TAG_CODEC_AVC && body_len > 1 && body[1] == 0)
+        {
+            flags |= FLV_INDEX_SEQ_HDR;
+        }
+    }
+    else if (tag_type == TAG_TYPE_AUDIO && body_len > 1)
+    {
+        if (((av_hdr >> 4) & 0x0F) == FLV_AUDIO_TAG_SOUND_FORMAT_AAC && body[1] == 0)
+        {
+            flags |= FLV_INDEX_SEQ_HDR;
+        }
+    }
+    return flags;
+}
+
+//push - one entry, its offset stored when it starts a stride or doesn't follow the tag before
+static void push(flv_tag_index_t *index, uint64_t offset, uint32_t timestamp, uint32_t size_avhdr, uint8_t flags)
+{
+    uint32_t n = flv_index_count(index);
+    if (n % FLV_INDEX_STRIDE == 0 || offset != index->next_offset)
+    {
+        index->offset_mark.push_back(std::make_pair(n, offset));
+    }
+    index->next_offset = offset + sizeof(flv_tag_t) + (size_avhdr >> 8) + 4;
+    index->timestamp.push_back(timestamp);
+    index->size_avhdr.push_back(size_avhdr);
+    index->type_flags.push_back(flags);
+}
+
+//flv_index_append - record one tag, body points at its first body_len (<= 2) bytes
+uint32_t flv_index_append(flv_tag_index_t *index, uint64_t offset, uint32_t pre_tag_size,
+    uint8_t tag_type, uint32_t data_size, uint32_t timestamp, const uint8_t *body, uint32_t body_len)
+{
+    uint32_t n = flv_index_count(index);
+    uint8_t av_hdr = (body_len > 0) ? body[0] : 0;
+    uint8_t flags = flv_index_flags(tag_type, body, body_len);
+
+    //PreviousTagSize is implied by the tag before unless the file says otherwise
+    uint32_t expected = (n == 0) ? 0 : flv_index_data_size(index, n - 1) + 11;
+    if (pre_tag_size != expected)
+    {
+        flags |= FLV_INDEX_ODD_PREV;
+        index->odd_pre_tag_size.push_back(std::make_pair(n, pre_tag_size));
+    }
+
+    push(index, offset, timestamp, (data_size << 8) | av_hdr, flags);
+    return n;
+}
+
+//flv_index_copy - append tag n of index to out, as a tag whose PreviousTagSize isn't known
+void flv_index_copy(flv_tag_index_t *out, const flv_tag_index_t *index, uint32_t n)
+{
+    push(out, flv_index_offset(index, n), index->timestamp[n], index->size_avhdr[n],
+        index->type_flags[n] & ~FLV_INDEX_ODD_PREV);
+}
+
+//flv_index_offset - the nearest stored offset at or before n plus the sizes of the tags in between
+uint64_t flv_index_offset(const flv_tag_index_t *index, uint32_t n)
+{
+    std::vector<std::pair<uint32_t, uint64_t> >::const_iterator citer = std::upper_bound(
+        index->offset_mark.begin(), index->offset_mark.end(), std::make_pair(n, UINT64_MAX)) - 1;
+    uint64_t offset = citer->second;
+    for (uint32_t k = citer->first; k < n; ++k)
+    {
+        offset += sizeof(flv_tag_t) + flv_index_data_size(index, k) + 4;
+    }
+    return offset;
+}
+
+uint32_t flv_index_pre_tag_size(const flv_tag_index_t *index, uint32_t n)
+{
+    if (index->type_flags[n] & FLV_INDEX_ODD_PREV)
+    {
+        std::vector<std::pair<uint32_t, uint32_t> >::const_iterator citer = std::lower_bound(
+            index->odd_pre_tag_size.begin(), index->odd_pre_tag_size.end(), std::make_pair(n, (uint32_t)0));
+        return citer->second;
+    }
+    return (n == 0) ? 0 : flv_index_data_size(index, n - 1) + 11;
+}
+
+size_t flv_index_memory(const flv_tag_index_t *index)
+{
+    return index->offset_mark.capacity() * sizeof(std::pair<uint32_t, uint64_t>)
+        + index->timestamp.capacity() * sizeof(uint32_t)
+        + index->size_avhdr.capacity() * sizeof(uint32_t)
+        + index->type_flags.capacity() * sizeof(uint8_t)
+        + index->odd_pre_tag_size.capacity() * sizeof(std::pair<uint32_t, uint32_t>);
+}
+
+//flv_index_scan - index every tag from the iterator's position on, reading headers only
+uint32_t flv_index_scan(flv_iter_t *iter, flv_tag_index_t *index)
+{
+    uint32_t count = 0;
+    flv_tag_view_t view;
+    while (flv_iter_next(iter, &view))
+    {
+        flv_index_append(index, view.offset, view.pre_tag_size, view.tag_type, view.data_size, view.timestamp,
+            view.body, view.body_len);
+        ++count;
+    }
+    return count;
+}
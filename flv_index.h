@@ -0,0 +1,49 @@
+// flv_index.h : compact per-tag index built while the file streams by.
+//
+// Every tag costs about 10 bytes spread over a few parallel arrays instead of
+// a list node holding a full flv_body_t: 9 for timestamp, size and flags, and
+// a share of the offsets, which are only stored every FLV_INDEX_STRIDE tags
+// and wherever a gap breaks the chain of sizes; the rest are summed up from
+// the sizes. A 10 hour recording at 25 fps with AAC (about 2.5M tags) takes
+// 25 MB, at 60 fps with 48 kHz audio (3.9M tags) 39 MB. PreviousTagSize is
+// only kept when it disagrees with the size of the tag before it.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_io.h"
+#include "flv_iter.h"
+
+//************ type_flags bits
+#define FLV_INDEX_TYPE_MASK     0x1F    //tag type (8, 9 or 18)
+#define FLV_INDEX_KEYFRAME      0x20    //video key frame
+#define FLV_INDEX_SEQ_HDR       0x40    //AVC/AAC sequence header
+#define FLV_INDEX_ODD_PREV      0x80    //PreviousTagSize stored in odd_pre_tag_size
+
+#define FLV_INDEX_STRIDE        16      //tags between two stored offsets
+
+typedef struct __flv_tag_index {
+    std::vector<std::pair<uint32_t, uint64_t> > offset_mark;   //(tag number, file offset of its header)
+    uint64_t next_offset;               //where the tag after the last one starts when nothing is skipped
+    std::vector<uint32_t> timestamp;    //milliseconds, timestampex included
+    std::vector<uint32_t> size_avhdr;   //data_size << 8 | first body byte
+    std::vector<uint8_t> type_flags;    //tag type | FLV_INDEX_* bits
+    std::vector<std::pair<uint32_t, uint32_t> > odd_pre_tag_size;   //(tag number, value)
+} flv_tag_index_t;
+
+//********** index functions
+void flv_index_clear(flv_tag_index_t *index);
+uint8_t flv_index_flags(uint8_t tag_type, const uint8_t *body, uint32_t body_len);
+uint32_t flv_index_append(flv_tag_index_t *index, uint64_t offset, uint32_t pre_tag_size,
+    uint8_t tag_type, uint32_t data_size, uint32_t timestamp, const uint8_t *body, uint32_t body_len);
+void flv_index_copy(flv_tag_index_t *out, const flv_tag_index_t *index, uint32_t n);
+uint64_t flv_index_offset(const flv_tag_index_t *index, uint32_t n);
+uint32_t flv_index_pre_tag_size(const flv_tag_index_t *index, uint32_t n);
+size_t flv_index_memory(const flv_tag_index_t *index);
+uint32_t flv_index_scan(flv_iter_t *iter, flv_tag_index_t *index);
+
+inline uint32_t flv_index_count(const flv_tag_index_t *index) { return (uint32_t)index->timestamp.size(); }
+inline uint8_t flv_index_tag_type(const flv_tag_index_t *index, uint32_t n) { return index->type_flags[n] & FLV_INDEX_TYPE_MASK; }
+inline uint32_t flv_index_data_size(const flv_tag_index_t *index, uint32_t n) { return index->size_avhdr[n] >> 8; }
+inline uint8_t flv_index_av_hdr(const flv_tag_index_t *index, uint32_t n) { return (uint8_t)index->size_avhdr[n]; }
+inline bool flv_index_is_keyframe(const flv_tag_index_t *index, uint32_t n) { return (index->type_flags[n] & FLV_INDEX_KEYFRAME) != 0; }
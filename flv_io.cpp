@@ -0,0 +1,648 @@
+// flv_io.cpp : block-buffered reader/writer implementation.
+
+#include "stdafx.h"
+#include "flv_io.h"
+
+#ifdef _WIN32
+#define flv_fseek _fseeki64
+#define flv_ftell _ftelli64
+#else
+#define flv_fseek fseeko
+#define flv_ftell ftello
+#endif
+
+void *flv_aligned_alloc(size_t size)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, FLV_IO_ALIGNMENT);
+#else
+    void *p = NULL;
+    if (posix_memalign(&p, FLV_IO_ALIGNMENT, size) != 0)
+    {
+        return NULL;
+    }
+    return p;
+#endif
+}
+
+void flv_aligned_free(void *p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+//flv_map_file - the whole file read-only in memory, NULL when it can't be opened or is empty
+void *flv_map_file(const char *file_name, size_t *size, int *mapped)
+{
+    FILE *fh = fopen(file_name, "rb");
+    if (NULL == fh)
+    {
+        return NULL;
+    }
+    flv_fseek(fh, 0, SEEK_END);
+    int64_t end = (int64_t)flv_ftell(fh);
+    if (end <= 0)
+    {
+        fclose(fh);
+        return NULL;
+    }
+    *size = (size_t)end;
+    *mapped = 0;
+    void *base = NULL;
+#ifndef _WIN32
+    void *p = mmap(NULL, *size, PROT_READ, MAP_SHARED, fileno(fh), 0);
+    if (p != MAP_FAILED)
+    {
+        base = p;
+        *mapped = 1;
+    }
+#endif
+    if (!*mapped)
+    {
+        base = malloc(*size);
+        flv_fseek(fh, 0, SEEK_SET);
+        if (base != NULL && fread(base, 1, *size, fh) != *size)
+        {
+            free(base);
+            base = NULL;
+        }
+    }
+    fclose(fh);
+    return base;
+}
+
+void flv_unmap_file(void *base, size_t size, int mapped)
+{
+#ifndef _WIN32
+    if (mapped)
+    {
+        munmap(base, size);
+        return;
+    }
+#endif
+    (void)size;
+    (void)mapped;
+    free(base);
+}
+
+//refill - drop the consumed part of the block and append fresh bytes from the file
+static size_t refill(flv_reader_t *reader)
+{
+    if (reader->mapped)
+    {
+        //the whole file is already in the block
+        reader->eof = 1;
+        return 0;
+    }
+    if (reader->pos > 0)
+    {
+        memmove(reader->buf, reader->buf + reader->pos, reader->len - reader->pos);
+        reader->buf_offset += reader->pos;
+        reader->len -= reader->pos;
+        reader->pos = 0;
+    }
+    size_t n = 0;
+    if (reader->stream)
+    {
+        //take what has arrived, a live source may not fill the block for a while
+        int64_t got;
+        while ((got = read(fileno(reader->fh), reader->buf + reader->len, reader->buf_size - reader->len)) < 0 && errno == EINTR)
+        {
+        }
+        n = (got > 0) ? (size_t)got : 0;
+    }
+    else
+    {
+        n = fread(reader->buf + reader->len, 1, reader->buf_size - reader->len, reader->fh);
+    }
+    if (n == 0)
+    {
+        reader->eof = 1;
+    }
+    reader->len += n;
+    return n;
+}
+
+#ifndef _WIN32
+//map_file - map the whole input read-only, false if it can't be mapped (empty, pipe, ...)
+static bool map_file(flv_reader_t *reader)
+{
+    struct stat st;
+    int fd = fileno(reader->fh);
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+    {
+        return false;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+    reader->buf = (uint8_t *)p;
+    reader->buf_size = reader->len = (size_t)st.st_size;
+    reader->mapped = 1;
+    return true;
+}
+#endif
+
+#ifndef _WIN32
+//open_tcp - connect to tcp://host:port and read the socket through a FILE, NULL on failure
+static FILE *open_tcp(const char *address)
+{
+    char host[_MAX_PATH];
+    const char *colon = strrchr(address, ':');
+    if (NULL == colon || colon == address || (size_t)(colon - address) >= sizeof(host))
+    {
+        return NULL;
+    }
+    memcpy(host, address, colon - address);
+    host[colon - address] = 0;
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, colon + 1, &hints, &res) != 0)
+    {
+        return NULL;
+    }
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai != NULL && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    FILE *fh = (fd >= 0) ? fdopen(fd, "rb") : NULL;
+    if (NULL == fh && fd >= 0)
+    {
+        close(fd);
+    }
+    return fh;
+}
+#endif
+
+//open_input - a file, stdin ("-") or a TCP connection
+static FILE *open_input(const char *file_name)
+{
+    if (strcmp(file_name, FLV_IO_STDIN_NAME) == 0)
+    {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+        return _fdopen(_dup(_fileno(stdin)), "rb");
+#else
+        return fdopen(dup(fileno(stdin)), "rb");
+#endif
+    }
+#ifndef _WIN32
+    if (strncmp(file_name, FLV_IO_TCP_PREFIX, strlen(FLV_IO_TCP_PREFIX)) == 0)
+    {
+        return open_tcp(file_name + strlen(FLV_IO_TCP_PREFIX));
+    }
+#endif
+    return fopen(file_name, "rb");
+}
+
+flv_reader_t *flv_reader_open(const char *file_name, int mode)
+{
+    FILE *fh = open_input(file_name);
+    if (NULL == fh)
+    {
+        return NULL;
+    }
+    //the reader does its own buffering, stdio would only add a second copy
+    setvbuf(fh, NULL, _IONBF, 0);
+
+    flv_reader_t *reader = new flv_reader_t();
+    reader->fh = fh;
+    struct stat st;
+    reader->stream = (fstat(fileno(fh), &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG);
+#ifndef _WIN32
+    if (mode == FLV_IO_MODE_MMAP && map_file(reader))
+    {
+        return reader;
+    }
+#else
+    (void)mode;
+#endif
+    reader->buf_size = reader->stream ? FLV_IO_STREAM_BLOCK_SIZE : FLV_IO_BLOCK_SIZE;
+    reader->buf = (uint8_t *)flv_aligned_alloc(reader->buf_size);
+    if (NULL == reader->buf)
+    {
+        fclose(fh);
+        delete reader;
+        return NULL;
+    }
+    return reader;
+}
+
+void flv_reader_close(flv_reader_t *reader)
+{
+    if (NULL == reader)
+    {
+        return;
+    }
+    fclose(reader->fh);
+#ifndef _WIN32
+    if (reader->mapped)
+    {
+        munmap(reader->buf, reader->buf_size);
+        delete reader;
+        return;
+    }
+#endif
+    flv_aligned_free(reader->buf);
+    delete reader;
+}
+
+uint32_t flv_reader_read(flv_reader_t *reader, void *p, uint32_t n)
+{
+    uint8_t *dst = (uint8_t *)p;
+    uint32_t done = 0;
+    while (done < n)
+    {
+        size_t avail = reader->len - reader->pos;
+        if (avail == 0)
+        {
+            //large reads bypass the block and land straight in the caller's buffer
+            if (!reader->mapped && n - done >= reader->buf_size)
+            {
+                reader->buf_offset += reader->len;
+                reader->pos = reader->len = 0;
+                size_t got = fread(dst + done, 1, n - done, reader->fh);
+                reader->buf_offset += got;
+                done += (uint32_t)got;
+                if (got == 0)
+                {
+                    reader->eof = 1;
+                }
+                break;
+            }
+            if (refill(reader) == 0)
+            {
+                break;
+            }
+            avail = reader->len - reader->pos;
+        }
+        uint32_t chunk = (uint32_t)std::min(avail, (size_t)(n - done));
+        memcpy(dst + done, reader->buf + reader->pos, chunk);
+        reader->pos += chunk;
+        done += chunk;
+    }
+    return done;
+}
+
+//peek - make n contiguous bytes available without consuming them, NULL on short input
+const uint8_t *flv_reader_peek(flv_reader_t *reader, uint32_t n)
+{
+    if (n > reader->buf_size)
+    {
+        return NULL;
+    }
+    while (reader->len - reader->pos < n)
+    {
+        if (refill(reader) == 0)
+        {
+            return NULL;
+        }
+    }
+    return reader->buf + reader->pos;
+}
+
+//flv_reader_window - everything the block holds from the read cursor on (the rest of a mapping), NULL at the end;
+//a stream gets one read for whatever has arrived instead of waiting for a full block
+const uint8_t *flv_reader_window(flv_reader_t *reader, size_t *avail)
+{
+    while (!reader->mapped && reader->len - reader->pos < reader->buf_size && refill(reader) > 0 && !reader->stream)
+    {
+    }
+    *avail = reader->len - reader->pos;
+    return (*avail > 0) ? reader->buf + reader->pos : NULL;
+}
+
+uint32_t flv_reader_skip(flv_reader_t *reader, uint32_t n)
+{
+    size_t avail = reader->len - reader->pos;
+    if (n <= avail)
+    {
+        reader->pos += n;
+        return n;
+    }
+    if (flv_reader_seek(reader, flv_reader_tell(reader) + n) != 0)
+    {
+        return 0;
+    }
+    return n;
+}
+
+int flv_reader_seek(flv_reader_t *reader, int64_t offset)
+{
+    //stay inside the current block when possible
+    if (offset >= reader->buf_offset && offset <= reader->buf_offset + (int64_t)reader->len)
+    {
+        reader->pos = (size_t)(offset - reader->buf_offset);
+        return 0;
+    }
+    if (reader->mapped)
+    {
+        //past the end of the mapping
+        reader->pos = reader->len;
+        reader->eof = 1;
+        return -1;
+    }
+    if (reader->stream)
+    {
+        //forward only, the bytes up to offset are read and dropped
+        while (offset > reader->buf_offset + (int64_t)reader->len)
+        {
+            reader->buf_offset += reader->len;
+            reader->pos = reader->len = 0;
+            if (refill(reader) == 0)
+            {
+                return -1;
+            }
+        }
+        if (offset < reader->buf_offset)
+        {
+            return -1;
+        }
+        reader->pos = (size_t)(offset - reader->buf_offset);
+        return 0;
+    }
+    if (flv_fseek(reader->fh, offset, SEEK_SET) != 0)
+    {
+        return -1;
+    }
+    reader->buf_offset = offset;
+    reader->pos = reader->len = 0;
+    reader->eof = 0;
+    return 0;
+}
+
+int64_t flv_reader_tell(const flv_reader_t *reader)
+{
+    return reader->buf_offset + (int64_t)reader->pos;
+}
+
+//flv_reader_size - size of the file behind a reader, 0 for a stream
+uint64_t flv_reader_size(const flv_reader_t *reader)
+{
+    if (reader->mapped)
+    {
+        return reader->buf_size;
+    }
+    struct stat st;
+    return (!reader->stream && fstat(fileno(reader->fh), &st) == 0) ? (uint64_t)st.st_size : 0;
+}
+
+int flv_reader_eof(const flv_reader_t *reader)
+{
+    return (reader->eof || reader->mapped) && reader->pos == reader->len;
+}
+
+flv_writer_t *flv_writer_open(const char *file_name)
+{
+    FILE *fh = (strcmp(file_name, FLV_IO_STDOUT_NAME) == 0) ? stdout : fopen(file_name, "wb");
+    if (NULL == fh)
+    {
+        return NULL;
+    }
+    setvbuf(fh, NULL, _IONBF, 0);
+
+    flv_writer_t *writer = new flv_writer_t();
+    writer->fh = fh;
+    writer->buf_size = FLV_IO_BLOCK_SIZE;
+    writer->buf = (uint8_t *)flv_aligned_alloc(writer->buf_size);
+    if (NULL == writer->buf)
+    {
+        fclose(fh);
+        delete writer;
+        return NULL;
+    }
+    return writer;
+}
+
+int flv_writer_close(flv_writer_t *writer)
+{
+    if (NULL == writer)
+    {
+        return 0;
+    }
+    int ret = flv_writer_flush(writer);
+    if (writer->fh != stdout && fclose(writer->fh) != 0)
+    {
+        ret = -1;
+    }
+    flv_aligned_free(writer->buf);
+    delete writer;
+    return ret;
+}
+
+#ifndef _WIN32
+//flush_gather - hand every pending range to writev(), resuming after short writes
+static int flush_gather(flv_writer_t *writer)
+{
+    int fd = fileno(writer->fh);
+    struct iovec *iov = writer->iov;
+    int niov = writer->niov;
+    int ret = 0;
+    while (niov > 0)
+    {
+        ssize_t n = writev(fd, iov, std::min(niov, (int)IOV_MAX));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ret = -1;
+            break;
+        }
+        writer->bytes_written += n;
+        while (niov > 0 && (size_t)n >= iov->iov_len)
+        {
+            n -= iov->iov_len;
+            ++iov;
+            --niov;
+        }
+        if (niov > 0)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    writer->niov = 0;
+    writer->len = 0;
+    return ret;
+}
+#endif
+
+int flv_writer_flush(flv_writer_t *writer)
+{
+#ifndef _WIN32
+    if (writer->niov > 0)
+    {
+        return flush_gather(writer);
+    }
+#endif
+    if (writer->len == 0)
+    {
+        return 0;
+    }
+    size_t n = fwrite(writer->buf, 1, writer->len, writer->fh);
+    int ret = (n == writer->len) ? 0 : -1;
+    writer->bytes_written += n;
+    writer->len = 0;
+    return ret;
+}
+
+uint32_t flv_writer_write(flv_writer_t *writer, const void *p, uint32_t n)
+{
+    const uint8_t *src = (const uint8_t *)p;
+    if (writer->len + n > writer->buf_size)
+    {
+        flv_writer_flush(writer);
+        //whole blocks go straight to the file
+        if (n >= writer->buf_size)
+        {
+            size_t done = fwrite(src, 1, n, writer->fh);
+            writer->bytes_written += done;
+            return (uint32_t)done;
+        }
+    }
+    memcpy(flv_writer_reserve(writer, n), src, n);
+    return n;
+}
+
+//flv_writer_reserve - n bytes at the end of the block for the caller to fill in place, NULL when n exceeds the block
+uint8_t *flv_writer_reserve(flv_writer_t *writer, uint32_t n)
+{
+    if (writer->len + n > writer->buf_size)
+    {
+        if (n > writer->buf_size)
+        {
+            return NULL;
+        }
+        flv_writer_flush(writer);
+    }
+#ifndef _WIN32
+    if (writer->niov > 0)
+    {
+        //extend the last range when it already ends at the block's tail
+        struct iovec *last = &writer->iov[writer->niov - 1];
+        if ((uint8_t *)last->iov_base + last->iov_len == writer->buf + writer->len)
+        {
+            last->iov_len += n;
+        }
+        else if (writer->niov == FLV_IO_IOV_COUNT)
+        {
+            flush_gather(writer);
+        }
+        else
+        {
+            writer->iov[writer->niov].iov_base = writer->buf + writer->len;
+            writer->iov[writer->niov].iov_len = n;
+            ++writer->niov;
+        }
+    }
+#endif
+    uint8_t *p = writer->buf + writer->len;
+    writer->len += n;
+    return p;
+}
+
+//write_ref - queue a range that stays valid until the next flush (e.g. a mapped input)
+uint32_t flv_writer_write_ref(flv_writer_t *writer, const void *p, uint32_t n)
+{
+#ifndef _WIN32
+    if (n >= FLV_IO_REF_MIN)
+    {
+        if (writer->niov >= FLV_IO_IOV_COUNT - 1)
+        {
+            flush_gather(writer);
+        }
+        if (writer->niov == 0 && writer->len > 0)
+        {
+            //whatever is buffered goes out first
+            writer->iov[0].iov_base = writer->buf;
+            writer->iov[0].iov_len = writer->len;
+            writer->niov = 1;
+        }
+        writer->iov[writer->niov].iov_base = (void *)p;
+        writer->iov[writer->niov].iov_len = n;
+        ++writer->niov;
+        return n;
+    }
+#endif
+    return flv_writer_write(writer, p, n);
+}
+
+//printf - formatted text, a NULL writer discards it so library callers can skip the log
+int flv_writer_printf(flv_writer_t *writer, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = flv_writer_vprintf(writer, fmt, args);
+    va_end(args);
+    return n;
+}
+
+int flv_writer_vprintf(flv_writer_t *writer, const char *fmt, va_list args)
+{
+    if (NULL == writer)
+    {
+        return 0;
+    }
+    char line[512];
+    va_list again;
+    va_copy(again, args);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    if (n >= 0 && (size_t)n >= sizeof(line))
+    {
+        //longer than a log line usually gets, format again on the heap
+        std::vector<char> long_line(n + 1);
+        vsnprintf(&long_line[0], long_line.size(), fmt, again);
+        va_end(again);
+        return (int)flv_writer_write(writer, &long_line[0], n);
+    }
+    va_end(again);
+    if (n < 0)
+    {
+        return n;
+    }
+    return (int)flv_writer_write(writer, line, n);
+}
+
+//flv_copy - move *n* bytes from the reader to the writer a block at a time
+uint32_t flv_copy(flv_reader_t *reader, flv_writer_t *writer, uint32_t n)
+{
+    uint32_t done = 0;
+    while (done < n)
+    {
+        if (reader->pos == reader->len && refill(reader) == 0)
+        {
+            break;
+        }
+        uint32_t chunk = (uint32_t)std::min(reader->len - reader->pos, (size_t)(n - done));
+        if (reader->mapped)
+        {
+            //zero copy, the writer points into the mapping
+            flv_writer_write_ref(writer, reader->buf + reader->pos, chunk);
+        }
+        else
+        {
+            flv_writer_write(writer, reader->buf + reader->pos, chunk);
+        }
+        reader->pos += chunk;
+        done += chunk;
+    }
+    return done;
+}
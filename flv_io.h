@@ -0,0 +1,102 @@
+// flv_io.h : block-buffered reader/writer used for all of the parser's I/O.
+//
+// The reader and writer keep large aligned blocks so that tag headers are
+// decoded out of memory and tag bodies are moved with a single memcpy/fwrite
+// instead of going through stdio one byte at a time.
+//
+// In mmap mode the reader's block is the whole mapped file: peek() hands out
+// pointers straight into the mapping and flv_copy() queues those ranges on the
+// writer, which hands them to writev() without an intermediate copy.
+//
+// Inputs that are not regular files ("-" for stdin, named pipes, and
+// tcp://host:port) are read as streams: refills take whatever read() has
+// ready instead of waiting for a full block, seeking forward consumes the
+// bytes in between, and nothing before the block can be gone back to. Their
+// block holds any tag whole, so a tag can be checked without seeking.
+// A writer opened on "-" writes to stdout.
+
+#pragma once
+
+#include "stdafx.h"
+
+//************ I/O constants
+#define FLV_IO_BLOCK_SIZE   (1024 * 1024)
+#define FLV_IO_STREAM_BLOCK_SIZE    (16 * 1024 * 1024 + 64 * 1024)  //the largest tag and the header after it
+#define FLV_IO_ALIGNMENT    4096
+#define FLV_IO_IOV_COUNT    1024    //ranges gathered per writev()
+#define FLV_IO_REF_MIN      64      //shorter ranges are cheaper to copy
+
+//************ reader modes
+#define FLV_IO_MODE_BUFFERED    0
+#define FLV_IO_MODE_MMAP        1
+
+#define FLV_IO_STDIN_NAME       "-"
+#define FLV_IO_STDOUT_NAME      "-"
+#define FLV_IO_TCP_PREFIX       "tcp://"
+
+typedef struct __flv_reader {
+    FILE *fh;
+    uint8_t *buf;
+    size_t buf_size;
+    size_t pos;             //read cursor inside buf
+    size_t len;             //valid bytes inside buf
+    int64_t buf_offset;     //file offset of buf[0]
+    int eof;
+    int mapped;             //buf is the read-only mapping of the whole file
+    int stream;             //forward only: a pipe, socket or stdin
+} flv_reader_t;
+
+typedef struct __flv_writer {
+    FILE *fh;
+    uint8_t *buf;
+    size_t buf_size;
+    size_t len;             //pending bytes inside buf
+    uint64_t bytes_written;
+#ifndef _WIN32
+    struct iovec iov[FLV_IO_IOV_COUNT];
+    int niov;               //pending gather ranges, 0 when only buf is pending
+#endif
+} flv_writer_t;
+
+//********** big-endian helpers
+inline uint32_t flv_get_be16(const uint8_t *p) { return ((uint32_t)p[0] << 8) | p[1]; }
+inline uint32_t flv_get_be24(const uint8_t *p) { return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2]; }
+inline uint32_t flv_get_be32(const uint8_t *p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+inline uint64_t flv_get_be64(const uint8_t *p) { return ((uint64_t)flv_get_be32(p) << 32) | flv_get_be32(p + 4); }
+inline void flv_put_be16(uint8_t *p, uint32_t v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; }
+inline void flv_put_be24(uint8_t *p, uint32_t v) { p[0] = (uint8_t)(v >> 16); p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)v; }
+inline void flv_put_be32(uint8_t *p, uint32_t v) { p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v; }
+inline void flv_put_be64(uint8_t *p, uint64_t v) { flv_put_be32(p, (uint32_t)(v >> 32)); flv_put_be32(p + 4, (uint32_t)v); }
+
+//********** aligned block allocation
+void *flv_aligned_alloc(size_t size);
+void flv_aligned_free(void *p);
+
+//********** whole-file mapping, read into memory where mmap isn't available
+void *flv_map_file(const char *file_name, size_t *size, int *mapped);
+void flv_unmap_file(void *base, size_t size, int mapped);
+
+//********** reader functions
+flv_reader_t *flv_reader_open(const char *file_name, int mode);
+void flv_reader_close(flv_reader_t *reader);
+uint32_t flv_reader_read(flv_reader_t *reader, void *p, uint32_t n);
+const uint8_t *flv_reader_peek(flv_reader_t *reader, uint32_t n);
+const uint8_t *flv_reader_window(flv_reader_t *reader, size_t *avail);
+uint32_t flv_reader_skip(flv_reader_t *reader, uint32_t n);
+int flv_reader_seek(flv_reader_t *reader, int64_t offset);
+int64_t flv_reader_tell(const flv_reader_t *reader);
+uint64_t flv_reader_size(const flv_reader_t *reader);
+int flv_reader_eof(const flv_reader_t *reader);
+
+//********** writer functions
+flv_writer_t *flv_writer_open(const char *file_name);
+int flv_writer_close(flv_writer_t *writer);
+uint32_t flv_writer_write(flv_writer_t *writer, const void *p, uint32_t n);
+uint8_t *flv_writer_reserve(flv_writer_t *writer, uint32_t n);
+uint32_t flv_writer_write_ref(flv_writer_t *writer, const void *p, uint32_t n);
+int flv_writer_printf(flv_writer_t *writer, const char *fmt, ...);
+int flv_writer_vprintf(flv_writer_t *writer, const char *fmt, va_list args);
+int flv_writer_flush(flv_writer_t *writer);
+
+//********** bulk transfer
+uint32_t flv_copy(flv_reader_t *reader, flv_writer_t *writer, uint32_t n);
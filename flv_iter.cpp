@@ -0,0 +1,232 @@
+// flv_iter.cpp : pull iterator over the tags of an FLV file.
+
+#include "stdafx.h"
+#include "flv_iter.h"
+#include "flv_scan.h"
+
+//flv_iter_init - read the file header and stand before the first tag, -1 if it isn't an FLV file
+int flv_iter_init(flv_iter_t *iter, flv_reader_t *reader, uint32_t flags)
+{
+    memset(iter, 0, sizeof(*iter));
+    iter->reader = reader;
+    iter->flags = flags;
+    if (flv_reader_seek(reader, 0) != 0
+        || flv_reader_read(reader, &iter->flv_hdr, sizeof(flv_hdr_t)) != sizeof(flv_hdr_t)
+        || memcmp(iter->flv_hdr.signature, FLV_HEADER_SIGNATURE, sizeof(iter->flv_hdr.signature)) != 0)
+    {
+        return -1;
+    }
+    iter->data_offset = flv_get_be32((const uint8_t *)&iter->flv_hdr.data_offset);
+    return flv_iter_rewind(iter);
+}
+
+//flv_iter_rewind - the next tag is the first one again
+int flv_iter_rewind(flv_iter_t *iter)
+{
+    iter->next = iter->data_offset;
+    iter->count = iter->resyncs = 0;
+    iter->skipped = 0;
+    return flv_reader_seek(iter->reader, iter->next);
+}
+
+//flv_iter_seek - the next tag is the one whose header starts at tag_offset
+int flv_iter_seek(flv_iter_t *iter, int64_t tag_offset)
+{
+    if (tag_offset < (int64_t)(iter->data_offset + 4))
+    {
+        return -1;
+    }
+    iter->next = tag_offset - 4;
+    return flv_reader_seek(iter->reader, iter->next);
+}
+
+//resync - offset of the first tag header at or after from, -1 if there is none before *end (the end of the file)
+static int64_t resync(flv_reader_t *reader, int64_t from, int64_t *end)
+{
+    size_t avail = 0;
+    const uint8_t *window = NULL;
+    while (flv_reader_seek(reader, from) == 0 && (window = flv_reader_window(reader, &avail)) != NULL)
+    {
+        int partial = 0;
+        const uint8_t *hit = flv_scan_sync(window, window + avail, &partial);
+        if (NULL != hit && !partial)
+        {
+            return from + (hit - window);
+        }
+        if (NULL != hit)
+        {
+            //its body runs past the window, check the PreviousTagSize where it is
+            int64_t at = from + (hit - window);
+            uint32_t data_size = flv_get_be24(hit + 1);
+            uint32_t trailer = sizeof(flv_tag_t) + data_size;
+            const uint8_t *p = NULL;
+            if (flv_reader_seek(reader, at) == 0 && (p = flv_reader_peek(reader, trailer + 4)) != NULL)
+            {
+                p += trailer;
+            }
+            else if (!reader->stream && flv_reader_seek(reader, at + trailer) == 0)
+            {
+                p = flv_reader_peek(reader, 4);
+            }
+            if (NULL != p && flv_get_be32(p) == data_size + sizeof(flv_tag_t))
+            {
+                return at;
+            }
+            from = at + 1;
+            continue;
+        }
+        if (avail < sizeof(flv_tag_t))
+        {
+            break;
+        }
+        //headers straddling the end of the window are looked at again with the next one
+        from += avail - (sizeof(flv_tag_t) - 1);
+    }
+    *end = from + avail;
+    return -1;
+}
+
+//tag_in_sync - the tag behind the PreviousTagSize at the reader looks real: known type, stream id 0, and its own
+//PreviousTagSize or else (some muxers get that wrong) the header after it checks out; the reader stays put,
+//*cut_off is set for a last tag the end of the file cuts short
+static bool tag_in_sync(flv_reader_t *reader, int64_t at, const uint8_t *p, int *cut_off)
+{
+    *cut_off = 0;
+    if (!flv_scan_header_ok(p + 4))
+    {
+        return false;
+    }
+    uint32_t data_size = flv_get_be24(p + 5);
+    uint32_t trailer = 4 + sizeof(flv_tag_t) + data_size;
+
+    //usually the whole tag and the next header are in the block already
+    p = flv_reader_peek(reader, trailer + 4 + sizeof(flv_tag_t));
+    if (NULL != p)
+    {
+        return flv_get_be32(p + trailer) == data_size + sizeof(flv_tag_t) || flv_scan_header_ok(p + trailer + 4);
+    }
+
+    //a tag larger than the block, or the last one: look behind it directly
+    if (!reader->stream && flv_reader_seek(reader, at + trailer) == 0 && (p = flv_reader_peek(reader, 4)) != NULL)
+    {
+        bool in_sync = flv_get_be32(p) == data_size + sizeof(flv_tag_t);
+        if (!in_sync)
+        {
+            p = flv_reader_peek(reader, 4 + sizeof(flv_tag_t));
+            in_sync = (NULL == p || flv_scan_header_ok(p + 4));
+        }
+        flv_reader_seek(reader, at);
+        return in_sync;
+    }
+
+    //it runs past the end: a cut-off file keeps its last tag, but a damaged data_size may hide more behind it
+    bool last = true;
+    if (reader->stream)
+    {
+        //its block holds any tag, so the rest of the stream is in the block already
+        size_t avail = 0;
+        const uint8_t *window = flv_reader_window(reader, &avail);
+        for (size_t from = 5; last && from < avail; )
+        {
+            int partial = 0;
+            const uint8_t *hit = flv_scan_sync(window + from, window + avail, &partial);
+            if (NULL == hit)
+            {
+                break;
+            }
+            last = (partial != 0);
+            from = (size_t)(hit - window) + 1;
+        }
+        *cut_off = (avail < trailer);
+    }
+    else
+    {
+        int64_t end = 0;
+        last = resync(reader, at + 5, &end) < 0;
+        flv_reader_seek(reader, at);
+        *cut_off = ((uint64_t)at + trailer > flv_reader_size(reader));
+    }
+    return last;
+}
+
+//flv_iter_next - decode the next tag into view, 1 for a tag, 0 at the end of the file
+int flv_iter_next(flv_iter_t *iter, flv_tag_view_t *view)
+{
+    flv_reader_t *reader = iter->reader;
+    uint64_t skipped = 0;
+    int cut_off = 0;
+    const uint8_t *p = NULL;
+    for (;;)
+    {
+        if (flv_reader_tell(reader) != iter->next && flv_reader_seek(reader, iter->next) != 0)
+        {
+            return 0;
+        }
+
+        //PreviousTagSize and the tag header come out of the block in one go
+        p = flv_reader_peek(reader, 4 + sizeof(flv_tag_t));
+        if (NULL == p)
+        {
+            return 0;
+        }
+        if (tag_in_sync(reader, iter->next, p, &cut_off))
+        {
+            break;
+        }
+
+        //a damaged size field sent the walk off into the data, carry on from the next tag that checks out
+        int64_t at = iter->next + 4, end = at;
+        int64_t found = resync(reader, at + 1, &end);
+        ++iter->resyncs;
+        if (found < 0)
+        {
+            iter->skipped += (uint64_t)(end - at);
+            iter->next = end;
+            return 0;
+        }
+        skipped += (uint64_t)(found - at);
+        iter->skipped += (uint64_t)(found - at);
+        iter->next = found - 4;
+    }
+    p = flv_reader_peek(reader, 4 + sizeof(flv_tag_t));
+    if (NULL == p)
+    {
+        return 0;
+    }
+    uint32_t pre_tag_size = flv_get_be32(p);
+    flv_reader_skip(reader, 4);
+    const flv_tag_t *tag = (const flv_tag_t *)(p + 4);
+    uint32_t data_size = flv_get_be24(tag->data_size);
+
+    //then as much of the body as asked for, falling back to its leading bytes
+    uint32_t want = (iter->flags & FLV_ITER_BODY) ? data_size : std::min(data_size, (uint32_t)2);
+    p = flv_reader_peek(reader, sizeof(flv_tag_t) + want);
+    if (NULL == p && want > 2)
+    {
+        want = std::min(data_size, (uint32_t)2);
+        p = flv_reader_peek(reader, sizeof(flv_tag_t) + want);
+    }
+    if (NULL == p)
+    {
+        want = 0;
+        p = flv_reader_peek(reader, sizeof(flv_tag_t));
+    }
+    tag = (const flv_tag_t *)p;
+
+    view->offset = flv_reader_tell(reader);
+    view->pre_tag_size = pre_tag_size;
+    view->tag = tag;
+    view->tag_type = tag->tag_type;
+    view->data_size = data_size;
+    view->timestamp = flv_get_be24(tag->timestamp) | ((uint32_t)tag->timestampex << 24);
+    view->stream_id = flv_get_be24(tag->reserved);
+    view->body = p + sizeof(flv_tag_t);
+    view->body_len = want;
+    view->skipped = skipped;
+    view->cut_off = cut_off;
+
+    flv_reader_skip(reader, sizeof(flv_tag_t));
+    iter->next = view->offset + sizeof(flv_tag_t) + data_size;
+    ++iter->count;
+    return 1;
+}
@@ -0,0 +1,55 @@
+// flv_iter.h : pull iterator over the tags of an FLV file.
+//
+// The iterator lives wherever the caller puts it and allocates nothing. Each
+// flv_iter_next() decodes the next tag header and hands out views into the
+// reader's block (or the mapping), so nothing is copied on the way through.
+// The views stay valid until the next call on the reader.
+//
+// After flv_iter_next() the reader sits on the first body byte: the caller
+// may stream the body with flv_copy()/flv_reader_read(), skip it, or ignore
+// it, the next call picks up at the following tag either way.
+//
+// Every tag is checked against its PreviousTagSize before it is handed out.
+// When a damaged size field has thrown the walk off, the iterator scans
+// ahead (flv_scan.h) for the next tag that checks out and carries on from
+// there; view->skipped and the iterator's totals say how much was dropped.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_io.h"
+
+//************ iterator flags
+#define FLV_ITER_BODY   1   //view the whole body, not just its first bytes
+
+typedef struct __flv_tag_view {
+    int64_t offset;             //file offset of the tag header
+    uint32_t pre_tag_size;      //PreviousTagSize stored in front of the tag
+    const flv_tag_t *tag;       //the raw header, big-endian as stored
+    uint8_t tag_type;
+    uint32_t data_size;
+    uint32_t timestamp;         //milliseconds, timestampex included
+    uint32_t stream_id;
+    const uint8_t *body;        //first body_len bytes of the body
+    uint32_t body_len;          //data_size with FLV_ITER_BODY unless larger than the reader block or cut short
+    uint64_t skipped;           //damaged bytes dropped right before this tag
+    int cut_off;                //the end of the file falls inside the body
+} flv_tag_view_t;
+
+typedef struct __flv_iter {
+    flv_reader_t *reader;
+    flv_hdr_t flv_hdr;
+    uint32_t data_offset;       //end of the file header, decoded
+    uint32_t flags;
+    int64_t next;               //offset of the next PreviousTagSize
+    uint32_t count;             //tags handed out so far
+    uint32_t resyncs;           //times the walk lost sync
+    uint64_t skipped;           //bytes dropped getting it back
+} flv_iter_t;
+
+//********** iterator functions
+int flv_iter_init(flv_iter_t *iter, flv_reader_t *reader, uint32_t flags);
+int flv_iter_rewind(flv_iter_t *iter);
+int flv_iter_seek(flv_iter_t *iter, int64_t tag_offset);
+int flv_iter_next(flv_iter_t *iter, flv_tag_view_t *view);
@@ -0,0 +1,64 @@
+// flv_json.cpp : JSON formatting helpers.
+
+#include "stdafx.h"
+#include "flv_json.h"
+
+//flv_json_printf - printf onto out, for numbers and literals up to 255 characters
+void flv_json_printf(std::vector<char> *out, const char *format, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n > 0)
+    {
+        out->insert(out->end(), buf, buf + std::min(n, (int)sizeof(buf) - 1));
+    }
+}
+
+//flv_json_string - a quoted string, escaped as JSON requires
+void flv_json_string(std::vector<char> *out, const uint8_t *p, size_t n)
+{
+    out->push_back('"');
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint8_t c = p[i];
+        if (c == '"' || c == '\\')
+        {
+            out->push_back('\\');
+            out->push_back((char)c);
+        }
+        else if (c < 0x20)
+        {
+            flv_json_printf(out, "\\u%04x", c);
+        }
+        else
+        {
+            out->push_back((char)c);
+        }
+    }
+    out->push_back('"');
+}
+
+//flv_json_cstring - a C string, null for NULL
+void flv_json_cstring(std::vector<char> *out, const char *s)
+{
+    if (NULL == s)
+    {
+        flv_json_printf(out, "null");
+        return;
+    }
+    flv_json_string(out, (const uint8_t *)s, strlen(s));
+}
+
+void flv_json_number(std::vector<char> *out, double v)
+{
+    if (v - v != 0)
+    {
+        //NaN and the infinities have no JSON form
+        flv_json_printf(out, "null");
+        return;
+    }
+    flv_json_printf(out, "%.15g", v);
+}
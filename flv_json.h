@@ -0,0 +1,16 @@
+// flv_json.h : appending JSON text to a byte vector.
+//
+// The reports that go to other programs (--probe, --stats) are built as one
+// buffer and written in a single call, so jobs running side by side can't
+// interleave their lines. These helpers only format values; the callers lay
+// out the objects themselves.
+
+#pragma once
+
+#include "stdafx.h"
+
+//********** JSON functions
+void flv_json_printf(std::vector<char> *out, const char *format, ...);
+void flv_json_string(std::vector<char> *out, const uint8_t *p, size_t n);
+void flv_json_cstring(std::vector<char> *out, const char *s);
+void flv_json_number(std::vector<char> *out, double v);
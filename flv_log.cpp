@@ -0,0 +1,117 @@
+// flv_log.cpp : asynchronous log formatting implementation.
+
+#include "stdafx.h"
+#include "flv_log.h"
+
+//consume - format records as they arrive until stopped with the ring empty
+static void consume(flv_log_t *log)
+{
+    uint32_t idle = 0;
+    while (true)
+    {
+        uint32_t tail = log->tail.load(std::memory_order_relaxed);
+        uint32_t head = log->head.load(std::memory_order_acquire);
+        if (tail != head)
+        {
+            head = (head - tail > FLV_LOG_BATCH) ? tail + FLV_LOG_BATCH : head;
+            for (; tail != head; ++tail)
+            {
+                log->format(log->writer, &log->ring[tail & (FLV_LOG_RING_SIZE - 1)]);
+            }
+            log->tail.store(tail, std::memory_order_release);
+            idle = 0;
+            continue;
+        }
+        if (!log->running.load(std::memory_order_acquire))
+        {
+            break;
+        }
+        if (++idle < FLV_LOG_SPIN)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        //a push that misses the flag is picked up on the timeout
+        std::unique_lock<std::mutex> guard(log->lock);
+        log->sleeping.store(true, std::memory_order_seq_cst);
+        if (log->head.load(std::memory_order_acquire) == tail && log->running.load(std::memory_order_acquire))
+        {
+            log->wake.wait_for(guard, std::chrono::milliseconds(1));
+        }
+        log->sleeping.store(false, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+//flv_log_init - a log onto writer, which the caller keeps owning, synchronous until started
+void flv_log_init(flv_log_t *log, flv_writer_t *writer, flv_log_format_fn_t format)
+{
+    log->writer = writer;
+    log->format = format;
+    log->ring = NULL;
+}
+
+//flv_log_start - from now on the records pushed are formatted by a consumer thread
+int flv_log_start(flv_log_t *log)
+{
+    log->ring = (flv_log_rec_t *)malloc(FLV_LOG_RING_SIZE * sizeof(flv_log_rec_t));
+    if (NULL == log->ring)
+    {
+        return -1;
+    }
+    log->head.store(0);
+    log->tail.store(0);
+    log->tail_seen = 0;
+    log->sleeping.store(false);
+    log->running.store(true);
+    log->consumer = std::thread(consume, log);
+    return 0;
+}
+
+//flv_log_sync - wait until every pushed record is formatted, the writer is the producer's until the next push
+flv_writer_t *flv_log_sync(flv_log_t *log)
+{
+    if (NULL == log->ring)
+    {
+        return log->writer;
+    }
+    uint32_t head = log->head.load(std::memory_order_relaxed);
+    while (log->tail.load(std::memory_order_acquire) != head)
+    {
+        flv_log_notify(log);
+        std::this_thread::yield();
+    }
+    return log->writer;
+}
+
+//flv_log_stop - format what is left and join the consumer
+void flv_log_stop(flv_log_t *log)
+{
+    if (NULL == log->ring)
+    {
+        return;
+    }
+    log->running.store(false, std::memory_order_release);
+    flv_log_notify(log);
+    log->consumer.join();
+    free(log->ring);
+    log->ring = NULL;
+}
+
+//flv_log_wait_space - the ring looked full, read tail again and let the consumer catch up if it is
+void flv_log_wait_space(flv_log_t *log)
+{
+    uint32_t head = log->head.load(std::memory_order_relaxed);
+    while (head - (log->tail_seen = log->tail.load(std::memory_order_acquire)) >= FLV_LOG_RING_SIZE)
+    {
+        flv_log_notify(log);
+        std::this_thread::yield();
+    }
+}
+
+void flv_log_notify(flv_log_t *log)
+{
+    std::lock_guard<std::mutex> guard(log->lock);
+    log->wake.notify_one();
+}
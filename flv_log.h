@@ -0,0 +1,96 @@
+// flv_log.h : asynchronous log formatting.
+//
+// Formatting the text and XML dumps costs more than parsing the tags they
+// describe, so the loops that produce them only fill small fixed-size records
+// and push them into a single-producer, single-consumer ring. A background
+// thread pops the records and formats them into the dump's writer through a
+// callback, which keeps the tables and the layout next to the caller.
+//
+// The ring is lock-free: the producer alone moves head and the consumer tail,
+// each published with a release store. A full ring makes the producer wait, so
+// no record is ever dropped.
+//
+// Output that doesn't fit a record (messages, AMF trees, helpers that take the
+// writer) goes through flv_log_sync: it waits until every record pushed so far
+// has been formatted, then the producer may use the writer directly until its
+// next push. A log that was never started has no consumer: its records are
+// formatted as they are pushed and its sync hands back the writer at once.
+//
+// FLV_LOG_LEVEL sets what gets built, in the Makefile's LOG_LEVEL:
+//   0 - no per-tag records, no XML dump and no messages from the parse loop
+//   1 - the messages only
+//   2 - every tag in the text log and the XML dump (default)
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_io.h"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifndef FLV_LOG_LEVEL
+#define FLV_LOG_LEVEL 2
+#endif
+
+//************ log constants
+#define FLV_LOG_RING_SIZE   16384   //records, a power of two
+#define FLV_LOG_BATCH       1024    //records formatted between two publications of tail
+#define FLV_LOG_SPIN        64      //empty polls the consumer yields through before it sleeps
+
+typedef struct __flv_log_rec {
+    uint8_t kind;           //what to format, defined by the callback
+    uint8_t tag_type;
+    uint8_t av_hdr;         //first body byte of audio and video tags
+    uint8_t timestampex;
+    uint32_t data_size;
+    uint32_t timestamp;
+    uint32_t pre_tag_size;
+} flv_log_rec_t;
+
+typedef void (*flv_log_format_fn_t)(flv_writer_t *writer, const flv_log_rec_t *rec);
+
+typedef struct __flv_log {
+    flv_writer_t *writer;
+    flv_log_format_fn_t format;
+    flv_log_rec_t *ring;
+    alignas(64) std::atomic<uint32_t> head;     //next record to push, written by the producer
+    uint32_t tail_seen;                         //the producer's last look at tail
+    alignas(64) std::atomic<uint32_t> tail;     //next record to format, written by the consumer
+    alignas(64) std::atomic<bool> running;
+    std::atomic<bool> sleeping;     //the consumer waits on wake
+    std::mutex lock;
+    std::condition_variable wake;
+    std::thread consumer;
+} flv_log_t;
+
+//********** log functions
+void flv_log_init(flv_log_t *log, flv_writer_t *writer, flv_log_format_fn_t format);
+int flv_log_start(flv_log_t *log);
+flv_writer_t *flv_log_sync(flv_log_t *log);
+void flv_log_stop(flv_log_t *log);
+void flv_log_wait_space(flv_log_t *log);
+void flv_log_notify(flv_log_t *log);
+
+//flv_log_push - queue a copy of rec for the consumer, or format it right away without one
+inline void flv_log_push(flv_log_t *log, const flv_log_rec_t *rec)
+{
+    if (NULL == log->ring)
+    {
+        log->format(log->writer, rec);
+        return;
+    }
+    uint32_t head = log->head.load(std::memory_order_relaxed);
+    if (head - log->tail_seen >= FLV_LOG_RING_SIZE)
+    {
+        flv_log_wait_space(log);
+    }
+    log->ring[head & (FLV_LOG_RING_SIZE - 1)] = *rec;
+    log->head.store(head + 1, std::memory_order_release);
+    if (log->sleeping.load(std::memory_order_relaxed))
+    {
+        flv_log_notify(log);
+    }
+}
@@ -0,0 +1,510 @@
+// flv_mp4.cpp : fragmented MP4 muxer implementation.
+
+#include "stdafx.h"
+#include "flv_mp4.h"
+
+//************ sample_flags of trun
+#define SAMPLE_FLAGS_SYNC       0x02000000  //depends on no other sample
+#define SAMPLE_FLAGS_NON_SYNC   0x01010000  //depends on others, not a sync sample
+
+static const uint32_t unity_matrix[9] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+
+//********** box building, big-endian into a byte vector
+static void put8(std::vector<uint8_t> &out, uint32_t v)
+{
+    out.push_back((uint8_t)v);
+}
+
+static void put16(std::vector<uint8_t> &out, uint32_t v)
+{
+    uint8_t p[2];
+    flv_put_be16(p, v);
+    out.insert(out.end(), p, p + sizeof(p));
+}
+
+static void put32(std::vector<uint8_t> &out, uint32_t v)
+{
+    uint8_t p[4];
+    flv_put_be32(p, v);
+    out.insert(out.end(), p, p + sizeof(p));
+}
+
+static void put64(std::vector<uint8_t> &out, uint64_t v)
+{
+    uint8_t p[8];
+    flv_put_be64(p, v);
+    out.insert(out.end(), p, p + sizeof(p));
+}
+
+static void put_zeros(std::vector<uint8_t> &out, size_t n)
+{
+    out.insert(out.end(), n, 0);
+}
+
+//begin_box - the size is left blank for end_box(), returns where the box starts
+static size_t begin_box(std::vector<uint8_t> &out, const char *type)
+{
+    size_t pos = out.size();
+    put32(out, 0);
+    out.insert(out.end(), type, type + 4);
+    return pos;
+}
+
+static size_t begin_full_box(std::vector<uint8_t> &out, const char *type, uint32_t version, uint32_t flags)
+{
+    size_t pos = begin_box(out, type);
+    put32(out, (version << 24) | (flags & 0x00FFFFFF));
+    return pos;
+}
+
+static void end_box(std::vector<uint8_t> &out, size_t pos)
+{
+    flv_put_be32(&out[pos], (uint32_t)(out.size() - pos));
+}
+
+//descriptor_len_size - bytes an MPEG-4 descriptor's length takes, 7 bits in each
+static uint32_t descriptor_len_size(uint32_t len)
+{
+    uint32_t n = 1;
+    while (n < 4 && len >= (1u << (7 * n)))
+    {
+        ++n;
+    }
+    return n;
+}
+
+//descriptor_size - a descriptor with len bytes of payload, its header included
+static uint32_t descriptor_size(uint32_t len)
+{
+    return 1 + descriptor_len_size(len) + len;
+}
+
+//put_descriptor - an MPEG-4 descriptor header, every length byte but the last with its 0x80 continuation bit
+static void put_descriptor(std::vector<uint8_t> &out, uint8_t tag, uint32_t len)
+{
+    put8(out, tag);
+    for (uint32_t n = descriptor_len_size(len) - 1; n > 0; --n)
+    {
+        put8(out, 0x80 | ((len >> (7 * n)) & 0x7F));
+    }
+    put8(out, len & 0x7F);
+}
+
+static void init_track(flv_mp4_track_t *track, uint32_t track_id)
+{
+    track->track_id = track_id;
+    track->has_config = 0;
+    track->in_init = 0;
+    track->width = track->height = 0;
+    track->sample_rate = track->channels = 0;
+    track->last_duration = 0;
+}
+
+void flv_mp4_init(flv_mp4_t *mp4)
+{
+    mp4->writer = NULL;
+    mp4->ts_offset = 0;
+    mp4->sequence = 1;
+    mp4->init_written = 0;
+    init_track(&mp4->video, FLV_MP4_VIDEO_TRACK);
+    init_track(&mp4->audio, FLV_MP4_AUDIO_TRACK);
+    mp4->fragments = 0;
+    mp4->dropped = 0;
+}
+
+//flv_mp4_set_avc_config - the video track's sample description, from the AVC sequence header
+int flv_mp4_set_avc_config(flv_mp4_t *mp4, const uint8_t *p, uint32_t n)
+{
+    flv_avc_config_t avc_config;
+    if (NULL == p || flv_avc_parse_config(p, n, &avc_config) != 0)
+    {
+        return -1;
+    }
+    flv_mp4_track_t *track = &mp4->video;
+    track->config.assign(p, p + n);
+    track->width = avc_config.width;
+    track->height = avc_config.height;
+    track->has_config = 1;
+    return 0;
+}
+
+//flv_mp4_set_aac_config - the audio track's sample description, from the AAC sequence header
+int flv_mp4_set_aac_config(flv_mp4_t *mp4, const uint8_t *p, uint32_t n)
+{
+    flv_aac_config_t aac_config;
+    if (NULL == p || flv_aac_parse_config(p, n, &aac_config) != 0)
+    {
+        return -1;
+    }
+    flv_mp4_track_t *track = &mp4->audio;
+    track->config.assign(p, p + n);
+    track->sample_rate = flv_aac_sample_rate(&aac_config);
+    track->channels = (aac_config.channels != 0) ? aac_config.channels : 2;
+    track->has_config = 1;
+    if (track->last_duration == 0 && track->sample_rate != 0)
+    {
+        //1024 samples per frame until the timestamps say otherwise
+        track->last_duration = (1024 * FLV_MP4_TIMESCALE + track->sample_rate / 2) / track->sample_rate;
+    }
+    return 0;
+}
+
+//write_sample_entry - avc1 with its avcC, or mp4a with its esds
+static void write_sample_entry(std::vector<uint8_t> &out, const flv_mp4_track_t *track)
+{
+    bool video = (track->track_id == FLV_MP4_VIDEO_TRACK);
+    size_t entry = begin_box(out, video ? "avc1" : "mp4a");
+    put_zeros(out, 6);
+    put16(out, 1);                      //data_reference_index
+    if (video)
+    {
+        put_zeros(out, 16);
+        put16(out, track->width);
+        put16(out, track->height);
+        put32(out, 0x00480000);         //72 dpi
+        put32(out, 0x00480000);
+        put32(out, 0);
+        put16(out, 1);                  //frame_count
+        put_zeros(out, 32);             //compressorname
+        put16(out, 0x0018);             //depth
+        put16(out, 0xFFFF);
+        size_t avcc = begin_box(out, "avcC");
+        out.insert(out.end(), track->config.begin(), track->config.end());
+        end_box(out, avcc);
+    }
+    else
+    {
+        uint32_t asc_len = (uint32_t)track->config.size();
+        uint32_t dcd_len = 13 + descriptor_size(asc_len);
+        put_zeros(out, 8);
+        put16(out, track->channels);
+        put16(out, 16);                 //samplesize
+        put32(out, 0);
+        put32(out, (track->sample_rate <= 0xFFFF) ? track->sample_rate << 16 : 0);
+        size_t esds = begin_full_box(out, "esds", 0, 0);
+        put_descriptor(out, 0x03, 3 + descriptor_size(dcd_len) + descriptor_size(1));   //ES_Descriptor
+        put16(out, 0);                  //ES_ID
+        put8(out, 0);
+        put_descriptor(out, 0x04, dcd_len);                            //DecoderConfigDescriptor
+        put8(out, 0x40);                //MPEG-4 audio
+        put8(out, 0x15);                //audio stream
+        put_zeros(out, 3 + 4 + 4);      //bufferSizeDB, maxBitrate, avgBitrate
+        put_descriptor(out, 0x05, asc_len);                            //DecoderSpecificInfo
+        out.insert(out.end(), track->config.begin(), track->config.end());
+        put_descriptor(out, 0x06, 1);                                  //SLConfigDescriptor
+        put8(out, 0x02);
+        end_box(out, esds);
+    }
+    end_box(out, entry);
+}
+
+static void write_trak(std::vector<uint8_t> &out, const flv_mp4_track_t *track)
+{
+    bool video = (track->track_id == FLV_MP4_VIDEO_TRACK);
+    size_t trak = begin_box(out, "trak");
+
+    size_t tkhd = begin_full_box(out, "tkhd", 0, 0x000003);    //enabled, in movie
+    put32(out, 0);
+    put32(out, 0);
+    put32(out, track->track_id);
+    put32(out, 0);
+    put32(out, 0);                      //duration, all in fragments
+    put_zeros(out, 8);
+    put16(out, 0);                      //layer
+    put16(out, 0);                      //alternate_group
+    put16(out, video ? 0 : 0x0100);     //volume
+    put16(out, 0);
+    for (int i = 0; i < 9; ++i)
+    {
+        put32(out, unity_matrix[i]);
+    }
+    put32(out, track->width << 16);
+    put32(out, track->height << 16);
+    end_box(out, tkhd);
+
+    size_t mdia = begin_box(out, "mdia");
+    size_t mdhd = begin_full_box(out, "mdhd", 0, 0);
+    put32(out, 0);
+    put32(out, 0);
+    put32(out, FLV_MP4_TIMESCALE);
+    put32(out, 0);
+    put16(out, 0x55C4);                 //und
+    put16(out, 0);
+    end_box(out, mdhd);
+
+    const char *handler = video ? "vide" : "soun";
+    const char *name = video ? "VideoHandler" : "SoundHandler";
+    size_t hdlr = begin_full_box(out, "hdlr", 0, 0);
+    put32(out, 0);
+    out.insert(out.end(), handler, handler + 4);
+    put_zeros(out, 12);
+    out.insert(out.end(), name, name + strlen(name) + 1);
+    end_box(out, hdlr);
+
+    size_t minf = begin_box(out, "minf");
+    if (video)
+    {
+        size_t vmhd = begin_full_box(out, "vmhd", 0, 1);
+        put_zeros(out, 8);              //graphicsmode, opcolor
+        end_box(out, vmhd);
+    }
+    else
+    {
+        size_t smhd = begin_full_box(out, "smhd", 0, 0);
+        put32(out, 0);                  //balance, reserved
+        end_box(out, smhd);
+    }
+    size_t dinf = begin_box(out, "dinf");
+    size_t dref = begin_full_box(out, "dref", 0, 0);
+    put32(out, 1);
+    end_box(out, begin_full_box(out, "url ", 0, 1));    //media in this file
+    end_box(out, dref);
+    end_box(out, dinf);
+
+    //an empty sample table, the samples are in the fragments
+    size_t stbl = begin_box(out, "stbl");
+    size_t stsd = begin_full_box(out, "stsd", 0, 0);
+    put32(out, 1);
+    write_sample_entry(out, track);
+    end_box(out, stsd);
+    const char *empty_tables[3] = { "stts", "stsc", "stco" };
+    for (int i = 0; i < 3; ++i)
+    {
+        size_t table = begin_full_box(out, empty_tables[i], 0, 0);
+        put32(out, 0);
+        end_box(out, table);
+    }
+    size_t stsz = begin_full_box(out, "stsz", 0, 0);
+    put32(out, 0);
+    put32(out, 0);
+    end_box(out, stsz);
+    end_box(out, stbl);
+
+    end_box(out, minf);
+    end_box(out, mdia);
+    end_box(out, trak);
+}
+
+//write_init - ftyp and moov for the tracks whose sequence headers are known by now
+static void write_init(flv_mp4_t *mp4)
+{
+    std::vector<uint8_t> out;
+    flv_mp4_track_t *tracks[2] = { &mp4->video, &mp4->audio };
+
+    size_t ftyp = begin_box(out, "ftyp");
+    out.insert(out.end(), "iso5", "iso5" + 4);
+    put32(out, 0x200);
+    out.insert(out.end(), "iso5iso6mp41avc1", "iso5iso6mp41avc1" + 16);
+    end_box(out, ftyp);
+
+    size_t moov = begin_box(out, "moov");
+    size_t mvhd = begin_full_box(out, "mvhd", 0, 0);
+    put32(out, 0);
+    put32(out, 0);
+    put32(out, FLV_MP4_TIMESCALE);
+    put32(out, 0);
+    put32(out, 0x00010000);             //rate
+    put16(out, 0x0100);                 //volume
+    put_zeros(out, 10);
+    for (int i = 0; i < 9; ++i)
+    {
+        put32(out, unity_matrix[i]);
+    }
+    put_zeros(out, 24);
+    put32(out, FLV_MP4_AUDIO_TRACK + 1);    //next_track_ID
+    end_box(out, mvhd);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        tracks[i]->in_init = tracks[i]->has_config;
+        if (tracks[i]->in_init)
+        {
+            write_trak(out, tracks[i]);
+        }
+    }
+
+    size_t mvex = begin_box(out, "mvex");
+    for (int i = 0; i < 2; ++i)
+    {
+        if (tracks[i]->in_init)
+        {
+            size_t trex = begin_full_box(out, "trex", 0, 0);
+            put32(out, tracks[i]->track_id);
+            put32(out, 1);              //default_sample_description_index
+            put32(out, 0);
+            put32(out, 0);
+            put32(out, 0);
+            end_box(out, trex);
+        }
+    }
+    end_box(out, mvex);
+    end_box(out, moov);
+
+    flv_writer_write(mp4->writer, &out[0], (uint32_t)out.size());
+    mp4->init_written = 1;
+}
+
+//write_fragment - moof and mdat for the samples gathered so far; end_dts (0 if unknown) is where
+//the next video sample starts and gives the last video sample its duration
+static int write_fragment(flv_mp4_t *mp4, uint32_t end_dts)
+{
+    flv_mp4_track_t *tracks[2] = { &mp4->video, &mp4->audio };
+    if (!mp4->init_written)
+    {
+        write_init(mp4);
+    }
+
+    std::vector<uint8_t> moof;
+    size_t data_offset_at[2] = { 0, 0 };
+    uint32_t traf_count = 0;
+    size_t moof_pos = begin_box(moof, "moof");
+    size_t mfhd = begin_full_box(moof, "mfhd", 0, 0);
+    put32(moof, mp4->sequence);
+    end_box(moof, mfhd);
+    for (int i = 0; i < 2; ++i)
+    {
+        flv_mp4_track_t *track = tracks[i];
+        if (!track->in_init)
+        {
+            mp4->dropped += (uint32_t)track->samples.size();
+            track->samples.clear();
+            track->data.clear();
+        }
+        if (track->samples.empty())
+        {
+            continue;
+        }
+        bool video = (track->track_id == FLV_MP4_VIDEO_TRACK);
+        size_t traf = begin_box(moof, "traf");
+        size_t tfhd = begin_full_box(moof, "tfhd", 0, 0x020000);  //default-base-is-moof
+        put32(moof, track->track_id);
+        end_box(moof, tfhd);
+        size_t tfdt = begin_full_box(moof, "tfdt", 1, 0);
+        put64(moof, track->samples[0].dts);
+        end_box(moof, tfdt);
+
+        //data offset, duration, size, flags and (video) composition offset per sample
+        size_t trun = begin_full_box(moof, "trun", 1, video ? 0x000F01 : 0x000701);
+        put32(moof, (uint32_t)track->samples.size());
+        data_offset_at[i] = moof.size();
+        put32(moof, 0);
+        for (size_t n = 0; n < track->samples.size(); ++n)
+        {
+            const flv_mp4_sample_t &sample = track->samples[n];
+            uint32_t next_dts = (n + 1 < track->samples.size()) ? track->samples[n + 1].dts : (video ? end_dts : 0);
+            if (next_dts > sample.dts)
+            {
+                track->last_duration = next_dts - sample.dts;
+            }
+            put32(moof, track->last_duration);
+            put32(moof, sample.size);
+            put32(moof, sample.key ? SAMPLE_FLAGS_SYNC : SAMPLE_FLAGS_NON_SYNC);
+            if (video)
+            {
+                put32(moof, (uint32_t)sample.cts);
+            }
+        }
+        end_box(moof, trun);
+        end_box(moof, traf);
+        ++traf_count;
+    }
+    end_box(moof, moof_pos);
+    if (traf_count == 0)
+    {
+        return 0;
+    }
+
+    //the video data, then the audio data, right behind the mdat header
+    uint32_t data_offset = (uint32_t)moof.size() + 8;
+    for (int i = 0; i < 2; ++i)
+    {
+        if (data_offset_at[i] != 0)
+        {
+            flv_put_be32(&moof[data_offset_at[i]], data_offset);
+            data_offset += (uint32_t)tracks[i]->data.size();
+        }
+    }
+    uint8_t mdat[8];
+    flv_put_be32(mdat, data_offset - (uint32_t)moof.size());
+    memcpy(mdat + 4, "mdat", 4);
+    flv_writer_write(mp4->writer, &moof[0], (uint32_t)moof.size());
+    flv_writer_write(mp4->writer, mdat, sizeof(mdat));
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!tracks[i]->data.empty())
+        {
+            flv_writer_write_ref(mp4->writer, &tracks[i]->data[0], (uint32_t)tracks[i]->data.size());
+        }
+    }
+
+    //the gathered samples are referenced until the writer has sent them
+    int ret = flv_writer_flush(mp4->writer);
+    for (int i = 0; i < 2; ++i)
+    {
+        tracks[i]->samples.clear();
+        tracks[i]->data.clear();
+    }
+    ++mp4->sequence;
+    ++mp4->fragments;
+    return ret;
+}
+
+//flv_mp4_open - start a file on writer, timestamp ts_offset becomes its time 0
+void flv_mp4_open(flv_mp4_t *mp4, flv_writer_t *writer, uint32_t ts_offset)
+{
+    mp4->writer = writer;
+    mp4->ts_offset = ts_offset;
+    mp4->sequence = 1;
+    mp4->init_written = 0;
+}
+
+//flv_mp4_add_sample - read the n byte payload of a coded frame from the reader, a video key frame
+//(or enough audio without video) first sends out the fragment gathered before it
+int flv_mp4_add_sample(flv_mp4_t *mp4, flv_reader_t *reader, uint8_t tag_type, uint32_t timestamp, int32_t cts,
+    bool key, uint32_t n)
+{
+    flv_mp4_track_t *track = (tag_type == TAG_TYPE_VIDEO) ? &mp4->video : &mp4->audio;
+    if (NULL == mp4->writer || !track->has_config)
+    {
+        ++mp4->dropped;
+        return 0;
+    }
+    uint32_t dts = (timestamp > mp4->ts_offset) ? timestamp - mp4->ts_offset : 0;
+
+    int ret = 0;
+    bool gop_done = (track == &mp4->video) && key && !mp4->video.samples.empty();
+    bool audio_done = (track == &mp4->audio) && !mp4->video.has_config && !mp4->audio.samples.empty()
+        && dts - mp4->audio.samples[0].dts >= FLV_MP4_AUDIO_FRAGMENT;
+    if (gop_done || audio_done)
+    {
+        ret = write_fragment(mp4, dts);
+    }
+
+    flv_mp4_sample_t sample;
+    size_t at = track->data.size();
+    track->data.resize(at + n);
+    sample.dts = dts;
+    sample.cts = cts;
+    sample.size = (n > 0) ? flv_reader_read(reader, &track->data[at], n) : 0;
+    sample.key = key;
+    track->data.resize(at + sample.size);
+    track->samples.push_back(sample);
+    return ret;
+}
+
+//flv_mp4_close - send out the last fragment, the next slice starts at end_timestamp (0 at the end of the input)
+int flv_mp4_close(flv_mp4_t *mp4, uint32_t end_timestamp)
+{
+    int ret = 0;
+    if (NULL == mp4->writer)
+    {
+        return 0;
+    }
+    if (!mp4->video.samples.empty() || !mp4->audio.samples.empty())
+    {
+        uint32_t end_dts = (end_timestamp > mp4->ts_offset) ? end_timestamp - mp4->ts_offset : 0;
+        ret = write_fragment(mp4, end_dts);
+    }
+    mp4->writer = NULL;
+    return ret;
+}
@@ -0,0 +1,66 @@
+// flv_mp4.h : remuxes AVC/AAC tags into fragmented MP4.
+//
+// Every output file stands on its own: ftyp and a moov whose mvex puts all
+// samples in fragments (the init segment), then one moof/mdat pair per GOP.
+// Samples are gathered until the next video key frame (about a second's
+// worth in files without video) and the fragment goes out right away, so only
+// one GOP is ever held in memory, whatever the length of the input. The
+// samples reach the file through the writer's gather list, not another copy.
+//
+// The init segment needs the AVC and AAC sequence headers, so it is written
+// along with the first fragment; a track whose sequence header hasn't come by
+// then is left out of that file. Times stay in FLV's milliseconds (timescale
+// 1000) and every fragment's tfdt is the decode time of its first sample, so
+// estimated durations at the end of a fragment never add up to drift.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_io.h"
+#include "flv_es.h"
+
+//************ fMP4 constants
+#define FLV_MP4_TIMESCALE       1000
+#define FLV_MP4_AUDIO_FRAGMENT  1000    //ms of audio per fragment when there is no video
+#define FLV_MP4_VIDEO_TRACK     1
+#define FLV_MP4_AUDIO_TRACK     2
+
+typedef struct __flv_mp4_sample {
+    uint32_t dts;           //ms from the start of the file
+    int32_t cts;            //composition time offset, ms
+    uint32_t size;
+    int key;
+} flv_mp4_sample_t;
+
+typedef struct __flv_mp4_track {
+    uint32_t track_id;
+    int has_config;                 //its sequence header has been seen
+    int in_init;                    //declared in the current file's moov
+    std::vector<uint8_t> config;    //AVCDecoderConfigurationRecord or AudioSpecificConfig as stored
+    uint32_t width, height;         //video
+    uint32_t sample_rate, channels; //audio
+    uint32_t last_duration;         //of the latest sample, the guess for the last one of a fragment
+    std::vector<flv_mp4_sample_t> samples;  //the fragment being gathered
+    std::vector<uint8_t> data;
+} flv_mp4_track_t;
+
+typedef struct __flv_mp4 {
+    flv_writer_t *writer;       //current output file, NULL between files
+    uint32_t ts_offset;         //source timestamp of the file's time 0
+    uint32_t sequence;          //mfhd sequence number of the next fragment
+    int init_written;
+    flv_mp4_track_t video;
+    flv_mp4_track_t audio;
+    uint32_t fragments;         //written over all files
+    uint32_t dropped;           //samples of a track the file has no trak for
+} flv_mp4_t;
+
+//********** muxer functions
+void flv_mp4_init(flv_mp4_t *mp4);
+int flv_mp4_set_avc_config(flv_mp4_t *mp4, const uint8_t *p, uint32_t n);
+int flv_mp4_set_aac_config(flv_mp4_t *mp4, const uint8_t *p, uint32_t n);
+void flv_mp4_open(flv_mp4_t *mp4, flv_writer_t *writer, uint32_t ts_offset);
+int flv_mp4_add_sample(flv_mp4_t *mp4, flv_reader_t *reader, uint8_t tag_type, uint32_t timestamp, int32_t cts,
+    bool key, uint32_t n);
+int flv_mp4_close(flv_mp4_t *mp4, uint32_t end_timestamp);
@@ -0,0 +1,82 @@
+// flv_pool.cpp : work-stealing thread pool implementation.
+
+#include "stdafx.h"
+#include "flv_pool.h"
+
+#include <thread>
+#include <mutex>
+#include <deque>
+
+typedef struct __flv_pool_queue {
+    std::mutex lock;
+    std::deque<void *> tasks;
+} flv_pool_queue_t;
+
+//take - own tasks come off the back, stolen ones off the front
+static bool take(flv_pool_queue_t *queue, bool steal, void **arg)
+{
+    std::lock_guard<std::mutex> guard(queue->lock);
+    if (queue->tasks.empty())
+    {
+        return false;
+    }
+    if (steal)
+    {
+        *arg = queue->tasks.front();
+        queue->tasks.pop_front();
+    }
+    else
+    {
+        *arg = queue->tasks.back();
+        queue->tasks.pop_back();
+    }
+    return true;
+}
+
+static void worker(std::vector<flv_pool_queue_t> *queues, uint32_t self, flv_task_fn_t fn)
+{
+    uint32_t nqueue = (uint32_t)queues->size();
+    void *arg = NULL;
+    while (true)
+    {
+        bool found = take(&(*queues)[self], false, &arg);
+        for (uint32_t i = 1; !found && i < nqueue; ++i)
+        {
+            found = take(&(*queues)[(self + i) % nqueue], true, &arg);
+        }
+        //nothing is ever queued once the pool runs, so empty everywhere means done
+        if (!found)
+        {
+            break;
+        }
+        fn(arg);
+    }
+}
+
+uint32_t flv_pool_default_threads()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void flv_pool_run(void **args, size_t count, flv_task_fn_t fn, uint32_t threads)
+{
+    if (threads == 0)
+    {
+        threads = flv_pool_default_threads();
+    }
+    threads = (uint32_t)std::max((size_t)1, std::min((size_t)threads, count));
+
+    std::vector<flv_pool_queue_t> queues(threads);
+    for (size_t i = 0; i < count; ++i)
+    {
+        queues[i % threads].tasks.push_back(args[i]);
+    }
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < threads; ++i)
+    {
+        workers.push_back(std::thread(worker, &queues, i, fn));
+    }
+    worker(&queues, 0, fn);
+    std::for_each(workers.begin(), workers.end(), std::mem_fn(&std::thread::join));
+}
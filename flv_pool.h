@@ -0,0 +1,15 @@
+// flv_pool.h : small work-stealing thread pool for batch jobs.
+//
+// Tasks are dealt round-robin onto one deque per worker. A worker pops its
+// own deque from the back and, once that is empty, steals from the front of
+// the others, so a few long files don't leave the rest of the machine idle.
+
+#pragma once
+
+#include "stdafx.h"
+
+typedef void (*flv_task_fn_t)(void *arg);
+
+//********** pool functions
+uint32_t flv_pool_default_threads();
+void flv_pool_run(void **args, size_t count, flv_task_fn_t fn, uint32_t threads);
@@ -0,0 +1,308 @@
+// flv_probe.cpp : metadata probe implementation.
+
+#include "stdafx.h"
+#include "flv_iter.h"
+#include "flv_amf.h"
+#include "flv_json.h"
+#include "flv_probe.h"
+
+static const char *video_codec_name[16] = {
+    NULL, "JPEG", "Sorenson H.263", "Screen video", "On2 VP6", "On2 VP6 alpha", "Screen video v2", "AVC",
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+static const char *sound_format_name[16] = {
+    "PCM", "ADPCM", "MP3", "PCM little endian", "Nellymoser 16 kHz", "Nellymoser 8 kHz", "Nellymoser", "G.711 A-law",
+    "G.711 mu-law", NULL, "AAC", "Speex", NULL, NULL, "MP3 8 kHz", "Device specific"
+};
+
+static const uint32_t sound_rate_hz[4] = { 5512, 11025, 22050, 44100 };
+
+//probe_last - the timestamp of the tag the file's final PreviousTagSize points back to
+static bool probe_last(flv_reader_t *reader, const flv_probe_t *probe, uint32_t *timestamp)
+{
+    if (probe->file_size < probe->data_offset + 4 + sizeof(flv_tag_t) + 4
+        || flv_reader_seek(reader, (int64_t)probe->file_size - 4) != 0)
+    {
+        return false;
+    }
+    const uint8_t *p = flv_reader_peek(reader, 4);
+    uint32_t pre_tag_size = (NULL != p) ? flv_get_be32(p) : 0;
+    if (pre_tag_size < sizeof(flv_tag_t) || pre_tag_size > probe->file_size - 4 - probe->data_offset - 4
+        || flv_reader_seek(reader, (int64_t)(probe->file_size - 4 - pre_tag_size)) != 0
+        || (p = flv_reader_peek(reader, sizeof(flv_tag_t))) == NULL)
+    {
+        return false;
+    }
+
+    //a truncated or damaged tail has no tag that fits its size
+    const flv_tag_t *tag = (const flv_tag_t *)p;
+    if ((tag->tag_type != TAG_TYPE_AUDIO && tag->tag_type != TAG_TYPE_VIDEO && tag->tag_type != TAG_TYPE_META)
+        || flv_get_be24(tag->data_size) + sizeof(flv_tag_t) != pre_tag_size)
+    {
+        return false;
+    }
+    *timestamp = flv_get_be24(tag->timestamp) | ((uint32_t)tag->timestampex << 24);
+    return true;
+}
+
+//flv_probe - describe the file from its header and first tags, -1 if it isn't an FLV file
+int flv_probe(flv_reader_t *reader, flv_probe_t *probe)
+{
+    flv_iter_t iter;
+    flv_tag_view_t view;
+    probe->tags_read = 0;
+    probe->meta.clear();
+    probe->has_video = probe->has_audio = probe->has_last = 0;
+    probe->avc = flv_avc_config_t();
+    probe->aac = flv_aac_config_t();
+    if (flv_iter_init(&iter, reader, FLV_ITER_BODY) != 0)
+    {
+        return -1;
+    }
+    probe->flv_hdr = iter.flv_hdr;
+    probe->data_offset = iter.data_offset;
+    probe->file_size = flv_reader_size(reader);
+
+    bool want_video = (iter.flv_hdr.flags & 0x01) != 0, want_audio = (iter.flv_hdr.flags & 0x04) != 0;
+    while ((want_video || want_audio || probe->tags_read == 0) && probe->tags_read < FLV_PROBE_MAX_TAGS && flv_iter_next(&iter, &view))
+    {
+        ++probe->tags_read;
+        const uint8_t *body = view.body;
+        if (view.body_len < view.data_size)
+        {
+            //larger than the block, only the headers are looked at
+            body = (view.tag_type == TAG_TYPE_META) ? NULL : body;
+        }
+        uint32_t body_len = view.body_len;
+
+        if (view.tag_type == TAG_TYPE_META && probe->meta.empty())
+        {
+            if (NULL == body)
+            {
+                probe->meta.resize(view.data_size);
+                probe->meta.resize(flv_reader_read(reader, &probe->meta[0], view.data_size));
+            }
+            else
+            {
+                probe->meta.assign(body, body + body_len);
+            }
+        }
+        else if (view.tag_type == TAG_TYPE_VIDEO && body_len > 0)
+        {
+            if (!probe->has_video)
+            {
+                probe->has_video = 1;
+                probe->video_hdr = body[0];
+                probe->video_start = view.timestamp;
+            }
+            bool avc = (body[0] & 0x0F) == FLV_VIDEO_TAG_CODEC_AVC;
+            if (avc && !probe->avc.valid && body_len > 5 && body[1] == 0)
+            {
+                flv_avc_parse_config(body + 5, body_len - 5, &probe->avc);
+            }
+            want_video = avc && !probe->avc.valid;
+        }
+        else if (view.tag_type == TAG_TYPE_AUDIO && body_len > 0)
+        {
+            if (!probe->has_audio)
+            {
+                probe->has_audio = 1;
+                probe->audio_hdr = body[0];
+                probe->audio_start = view.timestamp;
+            }
+            bool aac = ((body[0] >> 4) & 0x0F) == FLV_AUDIO_TAG_SOUND_FORMAT_AAC;
+            if (aac && !probe->aac.valid && body_len > 2 && body[1] == 0)
+            {
+                flv_aac_parse_config(body + 2, body_len - 2, &probe->aac);
+            }
+            want_audio = aac && !probe->aac.valid;
+        }
+    }
+
+    if (!reader->stream)
+    {
+        probe->has_last = probe_last(reader, probe, &probe->last_timestamp);
+    }
+    return 0;
+}
+
+//********** JSON output
+//json_amf - an AMF value as JSON: objects and ECMA arrays as objects, dates as their ms number
+static void json_amf(std::vector<char> *out, const amf_data_value_t *p_value)
+{
+    switch (p_value->type)
+    {
+    case AMF_TYPE_NUMBER:
+        flv_json_number(out, p_value->data_value.number);
+        break;
+    case AMF_TYPE_BOOLEAN:
+        flv_json_printf(out, p_value->data_value.boolean_vaule ? "true" : "false");
+        break;
+    case AMF_TYPE_STRING:
+        flv_json_string(out, p_value->data_value.string_value.data, p_value->data_value.string_value.size);
+        break;
+    case AMF_TYPE_LONG_STRING:
+        flv_json_string(out, p_value->data_value.long_string_value.data, p_value->data_value.long_string_value.size);
+        break;
+    case AMF_TYPE_DATE:
+        flv_json_number(out, p_value->data_value.date_value.date_time);
+        break;
+    case AMF_TYPE_OBJECT:
+    case AMF_TYPE_ECMA_ARRAY:
+        {
+            const amf_obj_property_list_t *lst = (p_value->type == AMF_TYPE_OBJECT)
+                ? &p_value->data_value.p_object->object_property_lst : &p_value->data_value.p_emca_array->object_property_lst;
+            const char *sep = "";
+            out->push_back('{');
+            for (const amf_object_property_t *p_property = lst->first; p_property != NULL; p_property = p_property->next)
+            {
+                if (p_property->p_data_value->type == AMF_TYPE_OBJECT_END)
+                {
+                    continue;
+                }
+                flv_json_printf(out, "%s", sep);
+                flv_json_string(out, p_property->property_name.data, p_property->property_name.size);
+                out->push_back(':');
+                json_amf(out, p_property->p_data_value);
+                sep = ",";
+            }
+            out->push_back('}');
+        }
+        break;
+    case AMF_TYPE_STRICT_ARRAY:
+        {
+            const char *sep = "";
+            out->push_back('[');
+            for (const amf_data_value_t *p_item = p_value->data_value.p_strict_array->amf_data_value_lst.first; p_item != NULL; p_item = p_item->next)
+            {
+                flv_json_printf(out, "%s", sep);
+                json_amf(out, p_item);
+                sep = ",";
+            }
+            out->push_back(']');
+        }
+        break;
+    default:
+        flv_json_printf(out, "null");
+        break;
+    }
+}
+
+//json_meta - the onMetaData properties, the keyframes table only by its length
+static bool json_meta(std::vector<char> *out, const std::vector<uint8_t> &meta, double *duration)
+{
+    amf_lazy_t lazy;
+    if (meta.empty() || amf_lazy_open(&lazy, &meta[0], meta.size()) != 0
+        || (lazy.type != AMF_TYPE_OBJECT && lazy.type != AMF_TYPE_ECMA_ARRAY))
+    {
+        return false;
+    }
+    flv_arena_t arena;
+    flv_arena_init(&arena);
+    flv_json_printf(out, ",\"metadata\":{\"name\":");
+    flv_json_string(out, lazy.name.data, lazy.name.size);
+    for (size_t i = 0; i < lazy.props.size(); ++i)
+    {
+        const amf_lazy_prop_t &prop = lazy.props[i];
+        out->push_back(',');
+        flv_json_string(out, prop.name.data, prop.name.size);
+        out->push_back(':');
+        amf_span_t span;
+        amf_span_init(&span, prop.value, lazy.end - prop.value);
+        if (prop.name.size == 9 && memcmp(prop.name.data, "keyframes", 9) == 0)
+        {
+            amf_span_t times;
+            bool table = amf_lazy_locate(&lazy, "keyframes.times", &times) == AMF_TYPE_STRICT_ARRAY && times.end - times.p >= 5;
+            flv_json_printf(out, table ? "{\"count\":%u}" : "null", table ? flv_get_be32(times.p + 1) : 0);
+            continue;
+        }
+        amf_data_value_t *p_value = NULL;
+        amf_decode(&span, &arena, &p_value);
+        if (span.error)
+        {
+            flv_json_printf(out, "null");
+            continue;
+        }
+        json_amf(out, p_value);
+        if (prop.name.size == 8 && memcmp(prop.name.data, "duration", 8) == 0 && p_value->type == AMF_TYPE_NUMBER)
+        {
+            *duration = p_value->data_value.number;
+        }
+    }
+    out->push_back('}');
+    flv_arena_free(&arena);
+    return true;
+}
+
+//flv_probe_json - the probe as one line of JSON, appended to out
+void flv_probe_json(const flv_probe_t *probe, const char *file_name, std::vector<char> *out)
+{
+    flv_json_printf(out, "{\"file\":");
+    flv_json_cstring(out, file_name);
+    if (probe->file_size != 0)
+    {
+        flv_json_printf(out, ",\"size\":%llu", (unsigned long long)probe->file_size);
+    }
+    flv_json_printf(out, ",\"format\":{\"version\":%u,\"has_audio\":%s,\"has_video\":%s,\"data_offset\":%u}",
+        probe->flv_hdr.version, (probe->flv_hdr.flags & 0x04) ? "true" : "false",
+        (probe->flv_hdr.flags & 0x01) ? "true" : "false", probe->data_offset);
+
+    if (probe->has_video)
+    {
+        uint8_t codec_id = probe->video_hdr & 0x0F;
+        flv_json_printf(out, ",\"video\":{\"codec_id\":%u,\"codec\":", codec_id);
+        flv_json_cstring(out, video_codec_name[codec_id]);
+        flv_json_printf(out, ",\"start\":%u", probe->video_start);
+        if (probe->avc.valid)
+        {
+            flv_json_printf(out, ",\"profile\":%u,\"level\":%u,\"nalu_length_size\":%u", probe->avc.profile, probe->avc.level,
+                probe->avc.length_size);
+            if (probe->avc.width != 0)
+            {
+                flv_json_printf(out, ",\"width\":%u,\"height\":%u", probe->avc.width, probe->avc.height);
+            }
+        }
+        out->push_back('}');
+    }
+    if (probe->has_audio)
+    {
+        uint8_t sound_format = (probe->audio_hdr >> 4) & 0x0F;
+        flv_json_printf(out, ",\"audio\":{\"sound_format\":%u,\"codec\":", sound_format);
+        flv_json_cstring(out, sound_format_name[sound_format]);
+        flv_json_printf(out, ",\"start\":%u", probe->audio_start);
+        if (probe->aac.valid)
+        {
+            flv_json_printf(out, ",\"object_type\":%u,\"sample_rate\":%u,\"channels\":%u", probe->aac.object_type,
+                flv_aac_sample_rate(&probe->aac), probe->aac.channels);
+        }
+        else
+        {
+            flv_json_printf(out, ",\"sample_rate\":%u,\"sample_size\":%u,\"channels\":%u", sound_rate_hz[(probe->audio_hdr >> 2) & 0x03],
+                (probe->audio_hdr & 0x02) ? 16 : 8, (probe->audio_hdr & 0x01) ? 2 : 1);
+        }
+        out->push_back('}');
+    }
+
+    //onMetaData's duration when it has one, else the span up to the last tag
+    double duration = 0;
+    json_meta(out, probe->meta, &duration);
+    if (duration > 0)
+    {
+        flv_json_printf(out, ",\"duration\":");
+        flv_json_number(out, duration);
+        flv_json_printf(out, ",\"duration_source\":\"onMetaData\"");
+    }
+    else if (probe->has_last && (probe->has_video || probe->has_audio))
+    {
+        uint32_t start = (probe->has_video && (!probe->has_audio || probe->video_start <= probe->audio_start))
+            ? probe->video_start : probe->audio_start;
+        uint32_t span = (probe->last_timestamp > start) ? probe->last_timestamp - start : 0;
+        flv_json_printf(out, ",\"duration\":%u.%03u,\"duration_source\":\"last_tag\"", span / 1000, span % 1000);
+    }
+    if (probe->has_last)
+    {
+        flv_json_printf(out, ",\"last_timestamp\":%u", probe->last_timestamp);
+    }
+    flv_json_printf(out, ",\"tags_read\":%u}\n", probe->tags_read);
+}
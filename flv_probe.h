@@ -0,0 +1,46 @@
+// flv_probe.h : what a file holds, from its first tags and its last one.
+//
+// A probe reads the file header and the first tags in one pass over the
+// reader's first block: the first script tag (onMetaData), then the first
+// audio and video tags and their AAC/AVC sequence headers. It stops as soon
+// as every stream the header announces is described, or after
+// FLV_PROBE_MAX_TAGS tags, so its cost does not grow with the file.
+//
+// The duration comes from onMetaData when it has one. Otherwise a seekable
+// file is asked for its last tag, which the final PreviousTagSize points
+// back to, so that costs only one more read.
+//
+// flv_probe_json() renders the result as a single JSON object. The
+// onMetaData properties are included as they were stored, except that the
+// keyframes table is reduced to its length.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_io.h"
+#include "flv_es.h"
+
+#define FLV_PROBE_MAX_TAGS  256     //tags looked at for a stream the header announces but doesn't deliver
+
+typedef struct __flv_probe {
+    flv_hdr_t flv_hdr;
+    uint32_t data_offset;
+    uint64_t file_size;             //0 for a stream
+    uint32_t tags_read;
+    std::vector<uint8_t> meta;      //body of the first script tag, empty if none came first
+    int has_video;                  //a video tag was seen
+    uint8_t video_hdr;              //its first body byte: frame type and codec id
+    uint32_t video_start;           //timestamp of the first video tag
+    flv_avc_config_t avc;
+    int has_audio;
+    uint8_t audio_hdr;              //sound format, rate, size and type
+    uint32_t audio_start;
+    flv_aac_config_t aac;
+    int has_last;                   //the last tag was found from the end of the file
+    uint32_t last_timestamp;
+} flv_probe_t;
+
+//********** probe functions
+int flv_probe(flv_reader_t *reader, flv_probe_t *probe);
+void flv_probe_json(const flv_probe_t *probe, const char *file_name, std::vector<char> *out);
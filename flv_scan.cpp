@@ -0,0 +1,155 @@
+// flv_scan.cpp : tag boundary scanner implementation.
+
+#include "stdafx.h"
+#include "flv_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define FLV_SCAN_SSE2 1
+#define FLV_SCAN_AVX2 1
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FLV_SCAN_SSE2 1
+#include <intrin.h>
+#include <emmintrin.h>
+#endif
+
+//check_at - 1 for a tag header at p, 0 for none, -1 when its PreviousTagSize lies past end
+static inline int check_at(const uint8_t *p, const uint8_t *end)
+{
+    if (!flv_scan_header_ok(p))
+    {
+        return 0;
+    }
+    uint32_t data_size = flv_get_be24(p + 1);
+    if ((size_t)(end - p) < sizeof(flv_tag_t) + data_size + 4)
+    {
+        return -1;
+    }
+    return (flv_get_be32(p + sizeof(flv_tag_t) + data_size) == data_size + sizeof(flv_tag_t)) ? 1 : 0;
+}
+
+//flv_scan_sync_scalar - byte at a time reference for the vector versions
+const uint8_t *flv_scan_sync_scalar(const uint8_t *p, const uint8_t *end, int *partial)
+{
+    *partial = 0;
+    for (; end - p >= (ptrdiff_t)sizeof(flv_tag_t); ++p)
+    {
+        int found = check_at(p, end);
+        if (found != 0)
+        {
+            *partial = (found < 0);
+            return p;
+        }
+    }
+    return NULL;
+}
+
+#ifdef FLV_SCAN_SSE2
+static inline int lowest_bit(uint32_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward(&bit, mask);
+    return (int)bit;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+//check_mask - full test of the candidate positions p + bit, the first hit wins
+static inline const uint8_t *check_mask(const uint8_t *p, uint32_t mask, const uint8_t *end, int *partial)
+{
+    while (mask != 0)
+    {
+        int found = check_at(p + lowest_bit(mask), end);
+        if (found != 0)
+        {
+            *partial = (found < 0);
+            return p + lowest_bit(mask);
+        }
+        mask &= mask - 1;
+    }
+    return NULL;
+}
+
+static const uint8_t *scan_sse2(const uint8_t *p, const uint8_t *end, int *partial)
+{
+    const __m128i one = _mm_set1_epi8(1), video = _mm_set1_epi8(TAG_TYPE_VIDEO);
+    const __m128i meta = _mm_set1_epi8(TAG_TYPE_META), zero = _mm_setzero_si128();
+    //16 positions need their type byte and stream id (up to p + 26) in range
+    for (; end - p >= 16 + 10; p += 16)
+    {
+        __m128i type = _mm_loadu_si128((const __m128i *)p);
+        __m128i is_tag = _mm_or_si128(_mm_cmpeq_epi8(_mm_or_si128(type, one), video), _mm_cmpeq_epi8(type, meta));
+        __m128i stream_id = _mm_or_si128(_mm_loadu_si128((const __m128i *)(p + 8)),
+            _mm_or_si128(_mm_loadu_si128((const __m128i *)(p + 9)), _mm_loadu_si128((const __m128i *)(p + 10))));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(is_tag, _mm_cmpeq_epi8(stream_id, zero)));
+        const uint8_t *hit = check_mask(p, mask, end, partial);
+        if (NULL != hit)
+        {
+            return hit;
+        }
+    }
+    return flv_scan_sync_scalar(p, end, partial);
+}
+#endif
+
+#ifdef FLV_SCAN_AVX2
+__attribute__((target("avx2")))
+static const uint8_t *scan_avx2(const uint8_t *p, const uint8_t *end, int *partial)
+{
+    const __m256i one = _mm256_set1_epi8(1), video = _mm256_set1_epi8(TAG_TYPE_VIDEO);
+    const __m256i meta = _mm256_set1_epi8(TAG_TYPE_META), zero = _mm256_setzero_si256();
+    for (; end - p >= 32 + 10; p += 32)
+    {
+        __m256i type = _mm256_loadu_si256((const __m256i *)p);
+        __m256i is_tag = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_or_si256(type, one), video), _mm256_cmpeq_epi8(type, meta));
+        __m256i stream_id = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(p + 8)),
+            _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(p + 9)), _mm256_loadu_si256((const __m256i *)(p + 10))));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(is_tag, _mm256_cmpeq_epi8(stream_id, zero)));
+        const uint8_t *hit = check_mask(p, mask, end, partial);
+        if (NULL != hit)
+        {
+            return hit;
+        }
+    }
+    return scan_sse2(p, end, partial);
+}
+#endif
+
+typedef const uint8_t *(*scan_fn_t)(const uint8_t *p, const uint8_t *end, int *partial);
+
+//pick_scan - the widest version the CPU runs
+static scan_fn_t pick_scan(const char **isa)
+{
+#ifdef FLV_SCAN_AVX2
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *isa = "avx2";
+        return scan_avx2;
+    }
+#endif
+#ifdef FLV_SCAN_SSE2
+    *isa = "sse2";
+    return scan_sse2;
+#else
+    *isa = "scalar";
+    return flv_scan_sync_scalar;
+#endif
+}
+
+static const char *scan_isa = NULL;
+static const scan_fn_t scan_best = pick_scan(&scan_isa);
+
+//flv_scan_sync - first tag header in [p, end), NULL if there is none; *partial is set when
+//its PreviousTagSize is past end, so only the header part of the test could be made
+const uint8_t *flv_scan_sync(const uint8_t *p, const uint8_t *end, int *partial)
+{
+    *partial = 0;
+    return scan_best(p, end, partial);
+}
+
+const char *flv_scan_isa(void)
+{
+    return scan_isa;
+}
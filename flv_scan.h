@@ -0,0 +1,24 @@
+// flv_scan.h : tag boundary scanner used to get back in sync after damage.
+//
+// A position is taken for a tag header when its type is audio, video or
+// script data, its stream id is 0 and the PreviousTagSize behind its body
+// equals data_size + 11. The first two tests are done 16 (SSE2) or 32 (AVX2)
+// positions at a time, only the few survivors get their PreviousTagSize
+// looked at. Builds without x86 SIMD fall back to a scalar loop.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_io.h"
+
+//flv_scan_header_ok - the cheap half of the test: known tag type and a zero stream id
+inline bool flv_scan_header_ok(const uint8_t *p)
+{
+    return (p[0] == TAG_TYPE_AUDIO || p[0] == TAG_TYPE_VIDEO || p[0] == TAG_TYPE_META) && (p[8] | p[9] | p[10]) == 0;
+}
+
+//********** scanner functions
+const uint8_t *flv_scan_sync(const uint8_t *p, const uint8_t *end, int *partial);
+const uint8_t *flv_scan_sync_scalar(const uint8_t *p, const uint8_t *end, int *partial);
+const char *flv_scan_isa(void);
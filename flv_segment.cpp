@@ -0,0 +1,107 @@
+// flv_segment.cpp : fixed-duration segmenter implementation.
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_io.h"
+#include "flv_segment.h"
+
+void flv_segment_init(flv_segmenter_t *seg, uint32_t duration, bool audio_only)
+{
+    seg->duration = (duration > 0) ? duration : 1;
+    seg->next_cut = 0;
+    seg->started = 0;
+    seg->audio_only = audio_only;
+}
+
+//flv_segment_cut - true when the tag (flv_index_flags() of it) starts a new segment
+bool flv_segment_cut(flv_segmenter_t *seg, uint8_t flags, uint32_t timestamp)
+{
+    if (!seg->started)
+    {
+        seg->started = 1;
+        seg->next_cut = timestamp + seg->duration;
+        return false;
+    }
+    uint8_t tag_type = flags & FLV_INDEX_TYPE_MASK;
+    bool sync = !(flags & FLV_INDEX_SEQ_HDR)
+        && (seg->audio_only ? tag_type == TAG_TYPE_AUDIO : (flags & FLV_INDEX_KEYFRAME) != 0);
+    if (!sync || timestamp < seg->next_cut)
+    {
+        return false;
+    }
+
+    //the next interval boundary past this tag, a long gap between key frames skips some
+    while (seg->next_cut <= timestamp)
+    {
+        seg->next_cut += seg->duration;
+    }
+    return true;
+}
+
+//flv_segment_plan - the offsets the segments after the first start at, terminated by UINT64_MAX
+uint32_t flv_segment_plan(flv_segmenter_t *seg, const flv_tag_index_t *index, std::vector<uint64_t> *cut_offset)
+{
+    uint32_t tag_count = flv_index_count(index);
+    cut_offset->clear();
+    for (uint32_t n = 0; n < tag_count; ++n)
+    {
+        if (flv_segment_cut(seg, index->type_flags[n], index->timestamp[n]))
+        {
+            cut_offset->push_back(flv_index_offset(index, n));
+        }
+    }
+    cut_offset->push_back(UINT64_MAX);
+    return (uint32_t)cut_offset->size();
+}
+
+//flv_segment_write_playlist - an HLS style playlist of the segments so far, replaced in one rename;
+//complete closes it with EXT-X-ENDLIST, start time and size go in a comment ahead of each entry
+int flv_segment_write_playlist(const char *file_name, const char *segment_prefix, const char *segment_ext, uint32_t target,
+    const std::vector<flv_segment_entry_t> &entries, bool complete)
+{
+    char tmp_name[_MAX_PATH + _MAX_EXT + 8];
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", file_name);
+    flv_writer_t *writer = flv_writer_open(tmp_name);
+    if (NULL == writer)
+    {
+        return -1;
+    }
+
+    //EXTINF rounded to the nearest second may not exceed the target duration
+    uint32_t target_secs = (target + 999) / 1000;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        target_secs = std::max(target_secs, (entries[i].duration + 500) / 1000);
+    }
+
+    flv_writer_printf(writer, "#EXTM3U\n");
+    flv_writer_printf(writer, "#EXT-X-VERSION:3\n");
+    flv_writer_printf(writer, "#EXT-X-TARGETDURATION:%u\n", target_secs);
+    flv_writer_printf(writer, "#EXT-X-MEDIA-SEQUENCE:%u\n", entries.empty() ? 0 : entries[0].num);
+    if (complete)
+    {
+        flv_writer_printf(writer, "#EXT-X-PLAYLIST-TYPE:VOD\n");
+    }
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const flv_segment_entry_t &entry = entries[i];
+        flv_writer_printf(writer, "# start %u.%03u duration %u.%03u bytes %llu\n", entry.start / 1000, entry.start % 1000,
+            entry.duration / 1000, entry.duration % 1000, (unsigned long long)entry.bytes);
+        flv_writer_printf(writer, "#EXTINF:%u.%03u,\n", entry.duration / 1000, entry.duration % 1000);
+        flv_writer_printf(writer, "%s_%u.%s\n", segment_prefix, entry.num, segment_ext);
+    }
+    if (complete)
+    {
+        flv_writer_printf(writer, "#EXT-X-ENDLIST\n");
+    }
+    if (flv_writer_close(writer) != 0)
+    {
+        remove(tmp_name);
+        return -1;
+    }
+
+#ifdef _WIN32
+    remove(file_name);
+#endif
+    return (rename(tmp_name, file_name) == 0) ? 0 : -1;
+}
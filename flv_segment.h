@@ -0,0 +1,38 @@
+// flv_segment.h : fixed-duration segmenting and the playlist listing the segments.
+//
+// In place of cue points read from a file, a segment ends every duration ms:
+// the next one starts on the first sync point (video key frame, or any audio
+// tag in a file without video) at or after each interval. Intervals count from
+// the first tag, so late key frames don't make the following segments drift.
+// The decision only needs the tag in hand, so a stream is cut in one pass.
+//
+// Cuts come out as tag offsets, the form --keyframe gives its snapped cue
+// points, so planning and writing the slices works the same for both.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_index.h"
+
+#define FLV_SEGMENT_PLAYLIST_EXT    "m3u8"
+
+typedef struct __flv_segmenter {
+    uint32_t duration;      //target segment length, ms
+    uint32_t next_cut;      //earliest timestamp the next segment may start at
+    int started;            //next_cut counts from the first tag seen
+    int audio_only;         //no video, every audio tag is a sync point
+} flv_segmenter_t;
+
+typedef struct __flv_segment_entry {
+    uint32_t num;           //slice number, the _N in the file name
+    uint32_t start;         //source timestamp of the first tag, ms
+    uint32_t duration;      //ms
+    uint64_t bytes;
+} flv_segment_entry_t;
+
+//********** segmenter functions
+void flv_segment_init(flv_segmenter_t *seg, uint32_t duration, bool audio_only);
+bool flv_segment_cut(flv_segmenter_t *seg, uint8_t flags, uint32_t timestamp);
+uint32_t flv_segment_plan(flv_segmenter_t *seg, const flv_tag_index_t *index, std::vector<uint64_t> *cut_offset);
+int flv_segment_write_playlist(const char *file_name, const char *segment_prefix, const char *segment_ext, uint32_t target,
+    const std::vector<flv_segment_entry_t> &entries, bool complete);
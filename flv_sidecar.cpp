@@ -0,0 +1,297 @@
+// flv_sidecar.cpp : persistent seek index implementation.
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_sidecar.h"
+
+//source_stat - size and mtime the sidecar is validated against
+static bool source_stat(const char *source_name, uint64_t *size, int64_t *mtime)
+{
+    struct stat st;
+    if (stat(source_name, &st) != 0)
+    {
+        return false;
+    }
+    *size = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+//sync_points - video key frames, or a tag a second without video
+static void sync_points(const flv_tag_index_t *index, std::vector<flv_sidecar_entry_t> *entries)
+{
+    uint32_t tag_count = flv_index_count(index);
+    bool has_key = false;
+    for (uint32_t n = 0; n < tag_count && !has_key; ++n)
+    {
+        has_key = flv_index_is_keyframe(index, n) && !(index->type_flags[n] & FLV_INDEX_SEQ_HDR);
+    }
+    for (uint32_t n = 0; n < tag_count; ++n)
+    {
+        uint8_t flags = index->type_flags[n];
+        if (has_key)
+        {
+            if (!(flags & FLV_INDEX_KEYFRAME) || (flags & FLV_INDEX_SEQ_HDR))
+            {
+                continue;
+            }
+        }
+        else if ((flags & FLV_INDEX_TYPE_MASK) == TAG_TYPE_META || (flags & FLV_INDEX_SEQ_HDR)
+            || (!entries->empty() && index->timestamp[n] < entries->back().timestamp + FLV_SIDECAR_SYNC_GAP))
+        {
+            continue;
+        }
+        flv_sidecar_entry_t entry;
+        entry.offset = flv_index_offset(index, n);
+        entry.timestamp = index->timestamp[n];
+        entry.type_flags = flags;
+        entries->push_back(entry);
+    }
+}
+
+static void init_hdr(flv_sidecar_hdr_t *hdr, uint32_t data_offset)
+{
+    memset(hdr, 0, sizeof(*hdr));
+    memcpy(hdr->magic, FLV_SIDECAR_MAGIC, sizeof(hdr->magic));
+    hdr->version = FLV_SIDECAR_VERSION;
+    hdr->byte_order = FLV_SIDECAR_BYTE_ORDER;
+    hdr->data_offset = data_offset;
+}
+
+//in_memory - a sidecar that lives on the heap only, closed like a mapped one
+static flv_sidecar_t *in_memory(const flv_sidecar_hdr_t *src_hdr, const std::vector<flv_sidecar_entry_t> &entries)
+{
+    size_t size = sizeof(flv_sidecar_hdr_t) + entries.size() * sizeof(flv_sidecar_entry_t);
+    flv_sidecar_hdr_t *hdr = (flv_sidecar_hdr_t *)malloc(size);
+    if (NULL == hdr)
+    {
+        return NULL;
+    }
+    *hdr = *src_hdr;
+    hdr->entry_count = (uint32_t)entries.size();
+    if (!entries.empty())
+    {
+        memcpy(hdr + 1, &entries[0], entries.size() * sizeof(flv_sidecar_entry_t));
+    }
+
+    flv_sidecar_t *sidecar = new flv_sidecar_t();
+    sidecar->base = hdr;
+    sidecar->size = size;
+    sidecar->hdr = hdr;
+    sidecar->entries = (const flv_sidecar_entry_t *)(hdr + 1);
+    return sidecar;
+}
+
+int flv_sidecar_write(const char *file_name, const char *source_name, uint32_t data_offset, const flv_tag_index_t *index)
+{
+    flv_sidecar_hdr_t hdr;
+    init_hdr(&hdr, data_offset);
+    if (!source_stat(source_name, &hdr.source_size, &hdr.source_mtime))
+    {
+        return -1;
+    }
+    std::vector<flv_sidecar_entry_t> entries;
+    sync_points(index, &entries);
+    hdr.entry_count = (uint32_t)entries.size();
+
+    FILE *fh = fopen(file_name, "wb");
+    if (NULL == fh)
+    {
+        return -1;
+    }
+    int ret = 0;
+    if (fwrite(&hdr, sizeof(hdr), 1, fh) != 1)
+    {
+        ret = -1;
+    }
+    if (ret == 0 && !entries.empty() && fwrite(&entries[0], sizeof(flv_sidecar_entry_t), entries.size(), fh) != entries.size())
+    {
+        ret = -1;
+    }
+    if (fclose(fh) != 0)
+    {
+        ret = -1;
+    }
+    if (ret != 0)
+    {
+        remove(file_name);
+    }
+    return ret;
+}
+
+//flv_sidecar_build - the sidecar flv_sidecar_write() would save, kept in memory for when it can't be
+flv_sidecar_t *flv_sidecar_build(const char *source_name, uint32_t data_offset, const flv_tag_index_t *index)
+{
+    flv_sidecar_hdr_t hdr;
+    init_hdr(&hdr, data_offset);
+    if (!source_stat(source_name, &hdr.source_size, &hdr.source_mtime))
+    {
+        return NULL;
+    }
+    std::vector<flv_sidecar_entry_t> entries;
+    sync_points(index, &entries);
+    return in_memory(&hdr, entries);
+}
+
+//flv_sidecar_open - map a sidecar, NULL when it is missing, malformed or stale
+flv_sidecar_t *flv_sidecar_open(const char *file_name, const char *source_name)
+{
+    flv_sidecar_t *sidecar = new flv_sidecar_t();
+    sidecar->base = flv_map_file(file_name, &sidecar->size, &sidecar->mapped);
+    if (NULL == sidecar->base || sidecar->size < sizeof(flv_sidecar_hdr_t))
+    {
+        flv_sidecar_close(sidecar);
+        return NULL;
+    }
+
+    sidecar->hdr = (const flv_sidecar_hdr_t *)sidecar->base;
+    sidecar->entries = (const flv_sidecar_entry_t *)(sidecar->hdr + 1);
+
+    const flv_sidecar_hdr_t *hdr = sidecar->hdr;
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    if (memcmp(hdr->magic, FLV_SIDECAR_MAGIC, sizeof(hdr->magic)) != 0
+        || hdr->version != FLV_SIDECAR_VERSION
+        || hdr->byte_order != FLV_SIDECAR_BYTE_ORDER
+        || sidecar->size != sizeof(flv_sidecar_hdr_t) + (size_t)hdr->entry_count * sizeof(flv_sidecar_entry_t)
+        || !source_stat(source_name, &source_size, &source_mtime)
+        || hdr->source_size != source_size
+        || hdr->source_mtime != source_mtime)
+    {
+        flv_sidecar_close(sidecar);
+        return NULL;
+    }
+    return sidecar;
+}
+
+void flv_sidecar_close(flv_sidecar_t *sidecar)
+{
+    if (NULL == sidecar)
+    {
+        return;
+    }
+    if (sidecar->base != NULL)
+    {
+        flv_unmap_file(sidecar->base, sidecar->size, sidecar->mapped);
+    }
+    delete sidecar;
+}
+
+static bool entry_before(uint32_t timestamp, const flv_sidecar_entry_t &entry)
+{
+    return timestamp < entry.timestamp;
+}
+
+//flv_sidecar_find - last sync point at or before timestamp, NULL if there is none
+const flv_sidecar_entry_t *flv_sidecar_find(const flv_sidecar_t *sidecar, uint32_t timestamp)
+{
+    const flv_sidecar_entry_t *first = sidecar->entries;
+    const flv_sidecar_entry_t *last = first + sidecar->hdr->entry_count;
+    const flv_sidecar_entry_t *iter = std::upper_bound(first, last, timestamp, entry_before);
+    return (iter == first) ? NULL : iter - 1;
+}
+
+//flv_sidecar_check - the tag at offset is a video key frame (not a sequence header), its timestamp in *timestamp
+int flv_sidecar_check(flv_reader_t *reader, uint64_t offset, uint32_t *timestamp)
+{
+    if (flv_reader_seek(reader, (int64_t)offset) != 0)
+    {
+        return -1;
+    }
+    const uint8_t *p = flv_reader_peek(reader, sizeof(flv_tag_t) + 2);
+    if (NULL == p)
+    {
+        return -1;
+    }
+    const flv_tag_t *tag = (const flv_tag_t *)p;
+    const uint8_t *body = p + sizeof(flv_tag_t);
+    if (tag->tag_type != TAG_TYPE_VIDEO || flv_get_be24(tag->data_size) < 2
+        || (body[0] >> 4) != FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME
+        || ((body[0] & 0x0F) == FLV_VIDEO_TAG_CODEC_AVC && body[1] != 1))
+    {
+        return -1;
+    }
+    if (NULL != timestamp)
+    {
+        *timestamp = flv_get_be24(tag->timestamp) | ((uint32_t)tag->timestampex << 24);
+    }
+    return 0;
+}
+
+//flv_sidecar_from_meta - sync points from the first tag's keyframes table, NULL when absent or inconsistent
+flv_sidecar_t *flv_sidecar_from_meta(flv_reader_t *reader)
+{
+    flv_iter_t iter;
+    flv_tag_view_t view;
+    if (flv_iter_init(&iter, reader, FLV_ITER_BODY) != 0 || !flv_iter_next(&iter, &view) || view.tag_type != TAG_TYPE_META)
+    {
+        return NULL;
+    }
+
+    //a body larger than the reader block is read out whole
+    std::vector<uint8_t> copy;
+    const uint8_t *body = view.body;
+    if (view.body_len < view.data_size)
+    {
+        copy.resize(view.data_size);
+        if (flv_reader_read(reader, &copy[0], view.data_size) != view.data_size)
+        {
+            return NULL;
+        }
+        body = &copy[0];
+    }
+
+    amf_lazy_t lazy;
+    flv_arena_t arena;
+    flv_arena_init(&arena);
+    amf_data_value_t *p_times = NULL, *p_positions = NULL;
+    if (amf_lazy_open(&lazy, body, view.data_size) == 0)
+    {
+        p_times = amf_lazy_get(&lazy, "keyframes.times", &arena);
+        p_positions = amf_lazy_get(&lazy, "keyframes.filepositions", &arena);
+    }
+    if (NULL == p_times || NULL == p_positions || p_times->type != AMF_TYPE_STRICT_ARRAY || p_positions->type != AMF_TYPE_STRICT_ARRAY
+        || p_times->data_value.p_strict_array->amf_data_value_lst.count != p_positions->data_value.p_strict_array->amf_data_value_lst.count
+        || p_times->data_value.p_strict_array->amf_data_value_lst.count == 0)
+    {
+        flv_arena_free(&arena);
+        return NULL;
+    }
+
+    //times must not go back, positions must climb through the tag data
+    uint64_t file_size = flv_reader_size(reader);
+    std::vector<flv_sidecar_entry_t> entries;
+    const amf_data_value_t *p_time = p_times->data_value.p_strict_array->amf_data_value_lst.first;
+    const amf_data_value_t *p_position = p_positions->data_value.p_strict_array->amf_data_value_lst.first;
+    bool valid = true;
+    for (; p_time != NULL && p_position != NULL && valid; p_time = p_time->next, p_position = p_position->next)
+    {
+        amf_number_t time = p_time->data_value.number, position = p_position->data_value.number;
+        valid = p_time->type == AMF_TYPE_NUMBER && p_position->type == AMF_TYPE_NUMBER
+            && time >= 0 && time * 1000 < (amf_number_t)UINT32_MAX
+            && position >= iter.data_offset + 4 && position + sizeof(flv_tag_t) <= (amf_number_t)file_size;
+        if (!valid)
+        {
+            break;
+        }
+        flv_sidecar_entry_t entry;
+        entry.offset = (uint64_t)position;
+        entry.timestamp = (uint32_t)(time * 1000 + 0.5);
+        entry.type_flags = TAG_TYPE_VIDEO | FLV_INDEX_KEYFRAME;
+        valid = entries.empty() || (entry.timestamp >= entries.back().timestamp && entry.offset > entries.back().offset);
+        entries.push_back(entry);
+    }
+    flv_arena_free(&arena);
+
+    //the ends of the table must land on key frames
+    if (!valid || flv_sidecar_check(reader, entries.front().offset, NULL) != 0
+        || flv_sidecar_check(reader, entries.back().offset, NULL) != 0)
+    {
+        return NULL;
+    }
+
+    flv_sidecar_hdr_t hdr;
+    init_hdr(&hdr, iter.data_offset);
+    hdr.source_size = file_size;
+    return in_memory(&hdr, entries);
+}
@@ -0,0 +1,61 @@
+// flv_sidecar.h : persistent seek index stored next to the source (<project>.flvidx).
+//
+// A full parse pass writes one entry per sync point (video key frame, or one
+// tag a second for audio-only files). Later runs map the file, check it still
+// matches the source's size and mtime, and binary-search it to jump straight
+// to the tag a slice starts from. Where it can't be saved (a read-only
+// directory), flv_sidecar_build() gives the same entries in memory.
+//
+// Layout: flv_sidecar_hdr_t followed by entry_count flv_sidecar_entry_t, all
+// in host byte order (byte_order tells a foreign-endian file apart).
+//
+// Files whose onMetaData carries a keyframes table (times/filepositions) get
+// the same in-memory form from flv_sidecar_from_meta() without any pass over
+// the tags. Such a table is only as good as the muxer that wrote it, so every
+// entry should go through flv_sidecar_check() before it is relied on.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_index.h"
+#include "flv_amf.h"
+
+//************ sidecar constants
+#define FLV_SIDECAR_EXT         "flvidx"
+#define FLV_SIDECAR_MAGIC       "FLVIDX\0"
+#define FLV_SIDECAR_VERSION     1
+#define FLV_SIDECAR_BYTE_ORDER  0x01020304
+#define FLV_SIDECAR_SYNC_GAP    1000    //ms between sync points without video
+
+typedef struct __flv_sidecar_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint32_t data_offset;   //offset of PreviousTagSize0 in the source
+    uint32_t entry_count;
+} flv_sidecar_hdr_t;
+
+typedef struct __flv_sidecar_entry {
+    uint64_t offset;        //file offset of the tag header
+    uint32_t timestamp;
+    uint32_t type_flags;    //FLV_INDEX_* bits of the tag
+} flv_sidecar_entry_t;
+
+typedef struct __flv_sidecar {
+    const flv_sidecar_hdr_t *hdr;
+    const flv_sidecar_entry_t *entries;
+    void *base;
+    size_t size;
+    int mapped;
+} flv_sidecar_t;
+
+//********** sidecar functions
+int flv_sidecar_write(const char *file_name, const char *source_name, uint32_t data_offset, const flv_tag_index_t *index);
+flv_sidecar_t *flv_sidecar_build(const char *source_name, uint32_t data_offset, const flv_tag_index_t *index);
+flv_sidecar_t *flv_sidecar_open(const char *file_name, const char *source_name);
+void flv_sidecar_close(flv_sidecar_t *sidecar);
+const flv_sidecar_entry_t *flv_sidecar_find(const flv_sidecar_t *sidecar, uint32_t timestamp);
+flv_sidecar_t *flv_sidecar_from_meta(flv_reader_t *reader);
+int flv_sidecar_check(flv_reader_t *reader, uint64_t offset, uint32_t *timestamp);
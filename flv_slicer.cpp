@@ -0,0 +1,521 @@
+// flv_slicer.cpp : parallel slice writer implementation.
+
+#include "stdafx.h"
+#include "flv_io.h"
+#include "flv_slicer.h"
+
+#ifndef _WIN32
+#include <thread>
+#include <atomic>
+#endif
+
+//plan_tag - put tag n in its slice by processfile()'s cut rule, cur_num follows the cue points
+static void plan_tag(const flv_tag_index_t *index, uint32_t n, const uint32_t *cue, const std::vector<uint64_t> &cut_offset,
+    uint32_t *cur_num, std::vector<flv_slice_t> *slices)
+{
+    uint64_t offset = flv_index_offset(index, n);
+    uint32_t timestamp = index->timestamp[n];
+    if (!cut_offset.empty() ? offset >= cut_offset[*cur_num] : timestamp > cue[*cur_num])
+    {
+        ++*cur_num;
+        while (!cut_offset.empty() && offset >= cut_offset[*cur_num])
+        {
+            ++*cur_num;
+        }
+    }
+    if (slices->empty() || slices->back().num != *cur_num)
+    {
+        slices->push_back(flv_slice_t());
+        flv_slice_t &slice = slices->back();
+        slice.num = *cur_num;
+        slice.first_tag = n;
+        slice.begin = offset;
+        slice.ts_offset = timestamp;
+    }
+    flv_slice_t &slice = slices->back();
+    slice.end_tag = n + 1;
+    slice.end = offset + sizeof(flv_tag_t) + flv_index_data_size(index, n) + 4;
+}
+
+//flv_slice_plan - apply processfile()'s cut rule to the whole index in one go
+void flv_slice_plan(const flv_tag_index_t *index, const uint32_t *cue, const std::vector<uint64_t> &cut_offset,
+    std::vector<flv_slice_t> *slices)
+{
+    uint32_t cur_num = 0, tag_count = flv_index_count(index);
+    slices->clear();
+    for (uint32_t n = 0; n < tag_count; ++n)
+    {
+        plan_tag(index, n, cue, cut_offset, &cur_num, slices);
+    }
+}
+
+//flv_slice_scan - index and plan from the iterator's position, in slice cur_num, until slice last_num is complete
+uint32_t flv_slice_scan(flv_iter_t *iter, uint32_t cur_num, uint32_t last_num, const uint32_t *cue,
+    const std::vector<uint64_t> &cut_offset, flv_tag_index_t *index, std::vector<flv_slice_t> *slices)
+{
+    flv_tag_view_t view;
+    slices->clear();
+    while (flv_iter_next(iter, &view))
+    {
+        uint32_t n = flv_index_append(index, view.offset, view.pre_tag_size, view.tag_type, view.data_size,
+            view.timestamp, view.body, view.body_len);
+        plan_tag(index, n, cue, cut_offset, &cur_num, slices);
+        if (cur_num > last_num)
+        {
+            //that tag already belongs to the next slice
+            slices->pop_back();
+            break;
+        }
+    }
+    return (uint32_t)slices->size();
+}
+
+//flv_slice_meta_load - decode the first tag when it is an onMetaData script tag, -1 otherwise
+int flv_slice_meta_load(flv_reader_t *reader, flv_slice_meta_t *meta)
+{
+    flv_iter_t iter;
+    flv_tag_view_t view;
+    meta->script.first = meta->script.last = NULL;
+    meta->script.count = 0;
+    flv_arena_init(&meta->arena);
+    if (flv_iter_init(&iter, reader, 0) != 0 || !flv_iter_next(&iter, &view) || view.tag_type != TAG_TYPE_META)
+    {
+        return -1;
+    }
+    meta->offset = (uint64_t)view.offset;
+    meta->data_size = view.data_size;
+    meta->source_size = flv_reader_size(reader);
+    meta->body.resize(view.data_size);
+    if (view.data_size == 0 || flv_reader_read(reader, &meta->body[0], view.data_size) != view.data_size)
+    {
+        return -1;
+    }
+
+    //a name, then the properties
+    amf_decode_script(&meta->body[0], meta->body.size(), &meta->arena, &meta->script);
+    const amf_data_value_t *p_name = meta->script.first;
+    const amf_data_value_t *p_value = (p_name != NULL) ? p_name->next : NULL;
+    if (NULL == p_value || p_name->type != AMF_TYPE_STRING || p_name->data_value.string_value.size != 10
+        || memcmp(p_name->data_value.string_value.data, "onMetaData", 10) != 0
+        || (p_value->type != AMF_TYPE_ECMA_ARRAY && p_value->type != AMF_TYPE_OBJECT))
+    {
+        flv_slice_meta_free(meta);
+        return -1;
+    }
+    return 0;
+}
+
+void flv_slice_meta_free(flv_slice_meta_t *meta)
+{
+    meta->script.first = meta->script.last = NULL;
+    meta->script.count = 0;
+    std::vector<uint8_t>().swap(meta->body);
+    flv_arena_free(&meta->arena);
+}
+
+//************ properties the slice gets its own values for
+enum {
+    META_DURATION,
+    META_FILESIZE,
+    META_LASTTIMESTAMP,
+    META_LASTKEYFRAMETIMESTAMP,
+    META_LASTKEYFRAMELOCATION,
+    META_KEYFRAMES,
+    META_PATCHED_COUNT
+};
+
+static const char *meta_patched_names[META_PATCHED_COUNT] = {
+    "duration",
+    "filesize",
+    "lasttimestamp",
+    "lastkeyframetimestamp",
+    "lastkeyframelocation",
+    "keyframes"
+};
+
+static int meta_patched(const amf_string_t &name)
+{
+    for (int i = 0; i < META_PATCHED_COUNT; ++i)
+    {
+        if (strlen(meta_patched_names[i]) == name.size && memcmp(meta_patched_names[i], name.data, name.size) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void write_name(std::vector<uint8_t> *out, const char *name)
+{
+    amf_string_t value;
+    value.size = (uint16_t)strlen(name);
+    value.data = (const uint8_t *)name;
+    write_string(out, &value);
+}
+
+//write_numbers - a strict array of numbers, returns where the first one's 8 bytes start
+static size_t write_numbers(std::vector<uint8_t> *out, const std::vector<amf_number_t> &numbers)
+{
+    write_byte(out, AMF_TYPE_STRICT_ARRAY);
+    uint8_t count[4];
+    flv_put_be32(count, (uint32_t)numbers.size());
+    out->insert(out->end(), count, count + sizeof(count));
+    size_t at = out->size() + 1;
+    for (size_t i = 0; i < numbers.size(); ++i)
+    {
+        write_byte(out, AMF_TYPE_NUMBER);
+        write_number(out, numbers[i]);
+    }
+    return at;
+}
+
+//patch_number - overwrite the 8 bytes of a number already in out
+static void patch_number(std::vector<uint8_t> *out, size_t at, amf_number_t value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    flv_put_be64(&(*out)[at], bits);
+}
+
+//write_patched - name and a placeholder value of patched property i, returns where the numbers to patch start
+static size_t write_patched(std::vector<uint8_t> *out, int i, const std::vector<amf_number_t> &times,
+    const std::vector<amf_number_t> &positions)
+{
+    write_name(out, meta_patched_names[i]);
+    if (i == META_KEYFRAMES)
+    {
+        write_byte(out, AMF_TYPE_OBJECT);
+        write_name(out, "filepositions");
+        size_t at = write_numbers(out, positions);
+        write_name(out, "times");
+        write_numbers(out, times);
+        write_end_marker(out);
+        return at;
+    }
+    write_byte(out, AMF_TYPE_NUMBER);
+    size_t at = out->size();
+    write_number(out, 0);
+    return at;
+}
+
+//flv_slice_hdr - the header a slice starts with: the source's, with flags, and the tags right after it
+void flv_slice_hdr(flv_hdr_t *out, const flv_hdr_t *src, uint8_t flags)
+{
+    *out = *src;
+    out->flags = flags;
+    flv_put_be32((uint8_t *)&out->data_offset, FLV_SLICE_HDR_SIZE);
+}
+
+//flv_slice_meta_build - the slice's onMetaData tag into slice->meta_tag, the source one dropped from its range
+void flv_slice_meta_build(const flv_slice_meta_t *meta, const flv_tag_index_t *index, flv_slice_t *slice)
+{
+    uint32_t first_tag = slice->first_tag;
+    if (first_tag < slice->end_tag && flv_index_offset(index, first_tag) == meta->offset)
+    {
+        slice->begin += sizeof(flv_tag_t) + meta->data_size + 4;
+        ++first_tag;
+    }
+
+    //a last tag cut off by the end of the file isn't written
+    uint32_t end_tag = slice->end_tag;
+    if (first_tag < end_tag
+        && flv_index_offset(index, end_tag - 1) + sizeof(flv_tag_t) + flv_index_data_size(index, end_tag - 1) > meta->source_size)
+    {
+        --end_tag;
+    }
+
+    //the slice's tags as written, positions counted from the end of the new onMetaData tag
+    std::vector<amf_number_t> times, positions;
+    uint64_t data_bytes = 0;
+    uint32_t last_ts = 0;
+    for (uint32_t n = first_tag; n < end_tag; ++n)
+    {
+        uint32_t timestamp = index->timestamp[n];
+        uint32_t ts = (timestamp > slice->ts_offset) ? timestamp - slice->ts_offset : 0;
+        uint8_t flags = index->type_flags[n];
+        if ((flags & FLV_INDEX_TYPE_MASK) == TAG_TYPE_VIDEO && (flags & FLV_INDEX_KEYFRAME) && !(flags & FLV_INDEX_SEQ_HDR))
+        {
+            times.push_back(ts / 1000.0);
+            positions.push_back((amf_number_t)data_bytes);
+        }
+        last_ts = std::max(last_ts, ts);
+        data_bytes += sizeof(flv_tag_t) + flv_index_data_size(index, n) + 4;
+    }
+
+    //the name, then every property: the source's values except for the ones the slice changes
+    std::vector<uint8_t> &tag = slice->meta_tag;
+    tag.assign(sizeof(flv_tag_t), 0);
+    const amf_data_value_t *p_name = meta->script.first, *p_value = p_name->next;
+    write_amf_data(&tag, p_name);
+    write_byte(&tag, p_value->type);
+    size_t len_at = tag.size();
+    const amf_obj_property_list_t *lst = &p_value->data_value.p_object->object_property_lst;
+    if (p_value->type == AMF_TYPE_ECMA_ARRAY)
+    {
+        tag.resize(tag.size() + 4);
+        lst = &p_value->data_value.p_emca_array->object_property_lst;
+    }
+
+    //patched properties keep their place, duration, filesize and keyframes are added when missing
+    uint32_t count = 0;
+    size_t at[META_PATCHED_COUNT] = { 0 };
+    for (const amf_object_property_t *p_property = lst->first; p_property != NULL; p_property = p_property->next)
+    {
+        if (p_property->p_data_value->type == AMF_TYPE_OBJECT_END)
+        {
+            continue;
+        }
+        int i = meta_patched(p_property->property_name);
+        if (i < 0)
+        {
+            write_string(&tag, &p_property->property_name);
+            write_amf_data(&tag, p_property->p_data_value);
+        }
+        else if (at[i] == 0)
+        {
+            at[i] = write_patched(&tag, i, times, positions);
+        }
+        else
+        {
+            //a repeated name would only shadow the first one
+            continue;
+        }
+        ++count;
+    }
+    const int required[] = { META_DURATION, META_FILESIZE, META_KEYFRAMES };
+    for (size_t r = 0; r < sizeof(required) / sizeof(required[0]); ++r)
+    {
+        if (at[required[r]] == 0)
+        {
+            at[required[r]] = write_patched(&tag, required[r], times, positions);
+            ++count;
+        }
+    }
+    if (p_value->type == AMF_TYPE_ECMA_ARRAY)
+    {
+        flv_put_be32(&tag[len_at], count);
+    }
+    write_end_marker(&tag);
+
+    //the size is settled, fill in the numbers that depend on it
+    uint32_t body_size = (uint32_t)(tag.size() - sizeof(flv_tag_t));
+    uint64_t data_start = FLV_SLICE_HDR_SIZE + 4 + tag.size() + 4;
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        patch_number(&tag, at[META_KEYFRAMES] + i * 9, (amf_number_t)(data_start + positions[i]));
+    }
+    patch_number(&tag, at[META_DURATION], last_ts / 1000.0);
+    patch_number(&tag, at[META_FILESIZE], (amf_number_t)(data_start + data_bytes));
+    if (at[META_LASTTIMESTAMP] != 0)
+    {
+        patch_number(&tag, at[META_LASTTIMESTAMP], last_ts / 1000.0);
+    }
+    if (at[META_LASTKEYFRAMETIMESTAMP] != 0)
+    {
+        patch_number(&tag, at[META_LASTKEYFRAMETIMESTAMP], times.empty() ? 0 : times.back());
+    }
+    if (at[META_LASTKEYFRAMELOCATION] != 0)
+    {
+        patch_number(&tag, at[META_LASTKEYFRAMELOCATION], positions.empty() ? 0 : data_start + positions.back());
+    }
+
+    flv_tag_t *p_tag = (flv_tag_t *)&tag[0];
+    p_tag->tag_type = TAG_TYPE_META;
+    flv_put_be24(p_tag->data_size, body_size);
+    uint8_t pre_tag_size[4];
+    flv_put_be32(pre_tag_size, body_size + sizeof(flv_tag_t));
+    tag.insert(tag.end(), pre_tag_size, pre_tag_size + sizeof(pre_tag_size));
+}
+
+#ifndef _WIN32
+static int pwrite_all(int fd, const uint8_t *p, size_t n, int64_t offset)
+{
+    while (n > 0)
+    {
+        ssize_t done = pwrite(fd, p, n, offset);
+        if (done < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        p += done;
+        n -= done;
+        offset += done;
+    }
+    return 0;
+}
+
+static ssize_t pread_all(int fd, uint8_t *p, size_t n, int64_t offset)
+{
+    size_t got = 0;
+    while (got < n)
+    {
+        ssize_t done = pread(fd, p + got, n - got, offset + got);
+        if (done < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (done == 0)
+        {
+            break;
+        }
+        got += done;
+    }
+    return (ssize_t)got;
+}
+
+//rebase_tag - the tag's timestamp made relative to the slice's first tag
+static void rebase_tag(flv_tag_t *p_tag, uint32_t ts_offset)
+{
+    uint32_t timestamp = flv_get_be24(p_tag->timestamp) | ((uint32_t)p_tag->timestampex << 24);
+    uint32_t ts = (timestamp > ts_offset) ? timestamp - ts_offset : 0;
+    flv_put_be24(p_tag->timestamp, ts & 0x00FFFFFF);
+    p_tag->timestampex = (uint8_t)(ts >> 24);
+}
+
+//flv_slice_write - copy one slice a block at a time, rebasing each tag in place
+int flv_slice_write(int ifd, const flv_hdr_t *flv_hdr, flv_slice_t *slice, const char *out_name)
+{
+    int ofd = open(out_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (ofd < 0)
+    {
+        return slice->status = -1;
+    }
+
+    //the flv header (the original file's, tags right after it) and first pts
+    uint8_t head[FLV_SLICE_HDR_SIZE + 4] = { 0 };
+    flv_slice_hdr((flv_hdr_t *)head, flv_hdr, flv_hdr->flags);
+    int64_t out_pos = 0;
+    int ret = pwrite_all(ofd, head, sizeof(head), out_pos);
+    out_pos += sizeof(head);
+    if (ret == 0 && !slice->meta_tag.empty())
+    {
+        ret = pwrite_all(ofd, &slice->meta_tag[0], slice->meta_tag.size(), out_pos);
+        out_pos += slice->meta_tag.size();
+    }
+
+    size_t block_size = FLV_SLICE_BLOCK_SIZE;
+    uint8_t *block = (uint8_t *)flv_aligned_alloc(block_size);
+    uint64_t pos = slice->begin;
+    while (ret == 0 && block != NULL && pos < slice->end)
+    {
+        size_t want = (size_t)std::min((uint64_t)block_size, slice->end - pos);
+        ssize_t got = pread_all(ifd, block, want, (int64_t)pos);
+        if (got <= 0)
+        {
+            ret = -1;
+            break;
+        }
+
+        //patch every whole tag in the block, a partial one is read again with the next block
+        size_t used = 0;
+        while (used + sizeof(flv_tag_t) <= (size_t)got)
+        {
+            flv_tag_t *p_tag = (flv_tag_t *)(block + used);
+            uint32_t data_size = flv_get_be24(p_tag->data_size);
+            size_t tag_total = sizeof(flv_tag_t) + data_size + 4;
+            if (used + tag_total > (size_t)got)
+            {
+                break;
+            }
+            rebase_tag(p_tag, slice->ts_offset);
+            flv_put_be32(block + used + sizeof(flv_tag_t) + data_size, data_size + sizeof(flv_tag_t));
+            used += tag_total;
+        }
+        if ((size_t)got < want)
+        {
+            //the file ends inside the last tag: kept when only its PreviousTagSize is missing, else left out
+            uint8_t be_size[4];
+            size_t tail = 0;
+            flv_tag_t *p_tag = (flv_tag_t *)(block + used);
+            if ((size_t)got - used >= sizeof(flv_tag_t)
+                && (size_t)got - used - sizeof(flv_tag_t) >= flv_get_be24(p_tag->data_size))
+            {
+                rebase_tag(p_tag, slice->ts_offset);
+                used += sizeof(flv_tag_t) + flv_get_be24(p_tag->data_size);
+                flv_put_be32(be_size, flv_get_be24(p_tag->data_size) + sizeof(flv_tag_t));
+                tail = sizeof(be_size);
+            }
+            ret = pwrite_all(ofd, block, used, out_pos);
+            ret = (ret == 0 && tail != 0) ? pwrite_all(ofd, be_size, tail, out_pos + used) : ret;
+            out_pos += used + tail;
+            break;
+        }
+        if (used == 0)
+        {
+            //a single tag bigger than the block, grow it and try again
+            if (want < block_size)
+            {
+                ret = -1;
+                break;
+            }
+            flv_aligned_free(block);
+            block_size *= 2;
+            block = (uint8_t *)flv_aligned_alloc(block_size);
+            continue;
+        }
+        ret = pwrite_all(ofd, block, used, out_pos);
+        out_pos += used;
+        pos += used;
+    }
+    if (block == NULL)
+    {
+        ret = -1;
+    }
+    flv_aligned_free(block);
+    if (close(ofd) != 0)
+    {
+        ret = -1;
+    }
+    slice->bytes_written = (uint64_t)out_pos;
+    return slice->status = ret;
+}
+
+//flv_slices_write_parallel - hand the slices to *jobs* worker threads
+int flv_slices_write_parallel(const char *in_file, const flv_hdr_t *flv_hdr, std::vector<flv_slice_t> &slices,
+    const char *project_name, uint32_t jobs)
+{
+    int ifd = open(in_file, O_RDONLY);
+    if (ifd < 0)
+    {
+        return -1;
+    }
+    if (jobs == 0)
+    {
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+    jobs = std::min(jobs, (uint32_t)slices.size());
+
+    //workers pull the next unwritten slice until none are left
+    std::atomic<uint32_t> next(0);
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < jobs; ++i)
+    {
+        workers.push_back(std::thread([&]() {
+            uint32_t n;
+            while ((n = next.fetch_add(1)) < slices.size())
+            {
+                char out_name[_MAX_PATH + _MAX_FNAME];
+                snprintf(out_name, sizeof(out_name), "%s_%u.flv", project_name, slices[n].num);
+                flv_slice_write(ifd, flv_hdr, &slices[n], out_name);
+            }
+        }));
+    }
+    std::for_each(workers.begin(), workers.end(), std::mem_fn(&std::thread::join));
+    close(ifd);
+
+    int ret = 0;
+    for (size_t n = 0; n < slices.size(); ++n)
+    {
+        ret = (slices[n].status != 0) ? -1 : ret;
+    }
+    return ret;
+}
+#endif
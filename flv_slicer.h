@@ -0,0 +1,57 @@
+// flv_slicer.h : writes cue-point slices as independent byte ranges.
+//
+// Once the tag index is known, every slice is a contiguous run of input tags
+// with its own timestamp rebase. Slices are read with pread() and written with
+// pwrite(), so any number of them can be produced at once by worker threads.
+//
+// A source that opens with onMetaData gets a fresh one per slice: the tree is
+// decoded once, then flv_slice_meta_build() encodes it again with duration,
+// filesize and a keyframes table (times/filepositions) worked out from the
+// slice's tags. AMF numbers are fixed size, so the tag's length is known before
+// the file positions are patched into it. The source tag itself is left out.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_index.h"
+#include "flv_amf.h"
+
+#define FLV_SLICE_BLOCK_SIZE    (4 * 1024 * 1024)
+#define FLV_SLICE_HDR_SIZE      sizeof(flv_hdr_t)   //a slice's header has no extra bytes, whatever the source's data_offset
+
+typedef struct __flv_slice {
+    uint32_t num;           //slice number, the _N in the output name
+    uint32_t first_tag;     //tag index range [first_tag, end_tag)
+    uint32_t end_tag;
+    uint64_t begin;         //input byte range, first tag header ..
+    uint64_t end;           //.. past the last tag's PreviousTagSize
+    uint32_t ts_offset;     //timestamp of the slice's first tag
+    uint64_t bytes_written;
+    int status;
+    std::vector<uint8_t> meta_tag;  //the slice's own onMetaData tag and its PreviousTagSize, if any
+} flv_slice_t;
+
+typedef struct __flv_slice_meta {
+    uint64_t offset;                //the source's onMetaData tag
+    uint32_t data_size;
+    uint64_t source_size;           //a last tag whose body runs past it is left out of the slices
+    std::vector<uint8_t> body;      //its body, the tree's strings point into it
+    amf_script_data_list_t script;  //name, then the ECMA array or object of properties
+    flv_arena_t arena;
+} flv_slice_meta_t;
+
+//********** slicer functions
+void flv_slice_plan(const flv_tag_index_t *index, const uint32_t *cue, const std::vector<uint64_t> &cut_offset,
+    std::vector<flv_slice_t> *slices);
+uint32_t flv_slice_scan(flv_iter_t *iter, uint32_t cur_num, uint32_t last_num, const uint32_t *cue,
+    const std::vector<uint64_t> &cut_offset, flv_tag_index_t *index, std::vector<flv_slice_t> *slices);
+int flv_slice_meta_load(flv_reader_t *reader, flv_slice_meta_t *meta);
+void flv_slice_meta_free(flv_slice_meta_t *meta);
+void flv_slice_hdr(flv_hdr_t *out, const flv_hdr_t *src, uint8_t flags);
+void flv_slice_meta_build(const flv_slice_meta_t *meta, const flv_tag_index_t *index, flv_slice_t *slice);
+#ifndef _WIN32
+int flv_slice_write(int ifd, const flv_hdr_t *flv_hdr, flv_slice_t *slice, const char *out_name);
+int flv_slices_write_parallel(const char *in_file, const flv_hdr_t *flv_hdr, std::vector<flv_slice_t> &slices,
+    const char *project_name, uint32_t jobs);
+#endif
@@ -0,0 +1,282 @@
+// flv_stats.cpp : stream statistics implementation.
+
+#include "stdafx.h"
+#include "flv_json.h"
+#include "flv_stats.h"
+
+static void init_track(flv_stats_track_t *track)
+{
+    memset(track, 0, sizeof(*track));
+    track->rate_min = UINT32_MAX;
+}
+
+void flv_stats_init(flv_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    init_track(&stats->audio);
+    init_track(&stats->video);
+    stats->gop_min_frames = stats->gop_min_ms = UINT32_MAX;
+    stats->drift_min = INT32_MAX;
+    stats->drift_max = INT32_MIN;
+}
+
+//rate_bin - histogram bin of a rate in kbit/s
+static uint32_t rate_bin(uint32_t kbps)
+{
+    uint32_t bin = 0;
+    for (; kbps != 0 && bin < FLV_STATS_RATE_BINS - 1; kbps >>= 1)
+    {
+        ++bin;
+    }
+    return bin;
+}
+
+//close_second - count the second being summed, and the empty ones up to next_second
+static void close_second(flv_stats_track_t *track, uint64_t next_second)
+{
+    uint32_t kbps = (uint32_t)std::min(track->second_bytes * 8 / 1000, (uint64_t)UINT32_MAX);
+    ++track->rate_bins[rate_bin(kbps)];
+    track->rate_min = std::min(track->rate_min, kbps);
+    track->rate_max = std::max(track->rate_max, kbps);
+    ++track->seconds;
+    if (next_second > track->second + 1)
+    {
+        track->rate_bins[0] += (uint32_t)(next_second - track->second - 1);
+        track->seconds += next_second - track->second - 1;
+        track->rate_min = 0;
+    }
+    track->second = next_second;
+    track->second_bytes = 0;
+}
+
+static void add_event(flv_stats_t *stats, int64_t offset, uint8_t tag_type, uint32_t from, uint32_t to)
+{
+    if (stats->events < FLV_STATS_EVENTS)
+    {
+        flv_stats_event_t &event = stats->event[stats->events];
+        event.offset = offset;
+        event.tag_type = tag_type;
+        event.from = from;
+        event.to = to;
+    }
+    ++stats->events;
+}
+
+//add_track - timestamp continuity and bitrate of one audio or video tag
+static void add_track(flv_stats_t *stats, flv_stats_track_t *track, int64_t offset, uint8_t tag_type, uint32_t data_size,
+    uint32_t timestamp)
+{
+    ++track->tags;
+    track->bytes += data_size;
+    if (!track->started)
+    {
+        track->started = 1;
+        track->first_ts = track->last_ts = timestamp;
+        track->second_bytes = data_size;
+        return;
+    }
+
+    //regular steps advance media time, jumps are counted instead
+    if (timestamp >= track->last_ts)
+    {
+        uint32_t delta = timestamp - track->last_ts;
+        if (delta > FLV_STATS_GAP_MS)
+        {
+            ++track->gaps;
+            track->max_gap = std::max(track->max_gap, delta);
+            add_event(stats, offset, tag_type, track->last_ts, timestamp);
+        }
+        else
+        {
+            track->media_ms += delta;
+        }
+    }
+    else
+    {
+        ++track->backwards;
+        track->max_backward = std::max(track->max_backward, track->last_ts - timestamp);
+        add_event(stats, offset, tag_type, track->last_ts, timestamp);
+    }
+    track->last_ts = timestamp;
+
+    uint64_t second = track->media_ms / 1000;
+    if (second > track->second)
+    {
+        close_second(track, second);
+    }
+    track->second_bytes += data_size;
+}
+
+static void close_gop(flv_stats_t *stats, uint32_t end_ts)
+{
+    uint32_t ms = (end_ts > stats->gop_start) ? end_ts - stats->gop_start : 0;
+    ++stats->gop_bins[std::min(stats->gop_frames, (uint32_t)FLV_STATS_GOP_BINS - 1)];
+    ++stats->gops;
+    stats->gop_min_frames = std::min(stats->gop_min_frames, stats->gop_frames);
+    stats->gop_max_frames = std::max(stats->gop_max_frames, stats->gop_frames);
+    stats->gop_min_ms = std::min(stats->gop_min_ms, ms);
+    stats->gop_max_ms = std::max(stats->gop_max_ms, ms);
+    stats->gop_total_frames += stats->gop_frames;
+    stats->gop_total_ms += ms;
+}
+
+//flv_stats_add - account for one tag, body holds its first body_len bytes
+void flv_stats_add(flv_stats_t *stats, int64_t offset, uint8_t tag_type, uint32_t data_size, uint32_t timestamp,
+    const uint8_t *body, uint32_t body_len)
+{
+    ++stats->tags;
+    if (tag_type == TAG_TYPE_AUDIO)
+    {
+        add_track(stats, &stats->audio, offset, tag_type, data_size, timestamp);
+    }
+    else if (tag_type == TAG_TYPE_VIDEO)
+    {
+        add_track(stats, &stats->video, offset, tag_type, data_size, timestamp);
+
+        //GOPs count coded frames: no sequence headers, end of sequence or info frames
+        uint8_t frame_type = (body_len > 0) ? (body[0] >> 4) & 0x0F : 0;
+        bool avc = body_len > 0 && (body[0] & 0x0F) == FLV_VIDEO_TAG_CODEC_AVC;
+        bool coded = (frame_type >= 1 && frame_type <= 3) && (!avc || (body_len > 1 && body[1] == 1));
+        if (coded && frame_type == FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME)
+        {
+            if (stats->in_gop)
+            {
+                close_gop(stats, timestamp);
+            }
+            stats->in_gop = 1;
+            stats->gop_frames = 0;
+            stats->gop_start = timestamp;
+        }
+        if (coded && stats->in_gop)
+        {
+            ++stats->gop_frames;
+            stats->gop_last = timestamp;
+        }
+    }
+    else
+    {
+        ++stats->meta_tags;
+        return;
+    }
+
+    //how far audio runs ahead of video (negative: behind) at this point of the file
+    if (stats->audio.started && stats->video.started)
+    {
+        int64_t drift = (int64_t)stats->audio.last_ts - (int64_t)stats->video.last_ts;
+        int32_t ms = (int32_t)std::max((int64_t)INT32_MIN, std::min((int64_t)INT32_MAX, drift));
+        ++stats->drift_samples;
+        stats->drift_sum += ms;
+        stats->drift_min = std::min(stats->drift_min, ms);
+        stats->drift_max = std::max(stats->drift_max, ms);
+        stats->drift_last = ms;
+    }
+}
+
+//flv_stats_finish - close the last second of each track and the last GOP, which runs to its last frame
+void flv_stats_finish(flv_stats_t *stats)
+{
+    flv_stats_track_t *tracks[2] = { &stats->audio, &stats->video };
+    for (int i = 0; i < 2; ++i)
+    {
+        if (tracks[i]->started)
+        {
+            close_second(tracks[i], tracks[i]->second + 1);
+        }
+    }
+    if (stats->in_gop)
+    {
+        close_gop(stats, stats->gop_last);
+        stats->in_gop = 0;
+    }
+}
+
+//********** JSON output
+static void json_track(std::vector<char> *out, const char *name, const flv_stats_track_t *track)
+{
+    flv_json_printf(out, ",\"%s\":", name);
+    if (!track->started)
+    {
+        flv_json_printf(out, "null");
+        return;
+    }
+    uint64_t span_ms = track->media_ms;
+    flv_json_printf(out, "{\"tags\":%llu,\"bytes\":%llu,\"first_timestamp\":%u,\"last_timestamp\":%u,\"media_ms\":%llu",
+        (unsigned long long)track->tags, (unsigned long long)track->bytes, track->first_ts, track->last_ts,
+        (unsigned long long)span_ms);
+    flv_json_printf(out, ",\"bitrate\":{\"seconds\":%llu,\"min_kbps\":%u,\"max_kbps\":%u,\"mean_kbps\":",
+        (unsigned long long)track->seconds, track->rate_min, track->rate_max);
+    flv_json_number(out, (span_ms > 0) ? (double)(track->bytes * 8) / span_ms : 0.0);
+    flv_json_printf(out, ",\"histogram\":[");
+    const char *sep = "";
+    for (uint32_t bin = 0; bin < FLV_STATS_RATE_BINS; ++bin)
+    {
+        if (track->rate_bins[bin] != 0)
+        {
+            flv_json_printf(out, "%s{\"kbps_from\":%u,\"kbps_to\":%u,\"seconds\":%u}", sep,
+                (bin == 0) ? 0 : 1u << (bin - 1), 1u << bin, track->rate_bins[bin]);
+            sep = ",";
+        }
+    }
+    flv_json_printf(out, "]},\"discontinuities\":%u,\"max_gap_ms\":%u,\"backward_jumps\":%u,\"max_backward_ms\":%u}",
+        track->gaps, track->max_gap, track->backwards, track->max_backward);
+}
+
+//flv_stats_json - the statistics as one line of JSON, appended to out
+void flv_stats_json(const flv_stats_t *stats, const char *file_name, std::vector<char> *out)
+{
+    flv_json_printf(out, "{\"file\":");
+    flv_json_cstring(out, file_name);
+    flv_json_printf(out, ",\"tags\":%llu,\"script_tags\":%llu", (unsigned long long)stats->tags,
+        (unsigned long long)stats->meta_tags);
+    json_track(out, "video", &stats->video);
+    json_track(out, "audio", &stats->audio);
+
+    flv_json_printf(out, ",\"gop\":");
+    if (stats->gops == 0)
+    {
+        flv_json_printf(out, "null");
+    }
+    else
+    {
+        flv_json_printf(out, "{\"count\":%u,\"min_frames\":%u,\"max_frames\":%u,\"mean_frames\":", stats->gops,
+            stats->gop_min_frames, stats->gop_max_frames);
+        flv_json_number(out, (double)stats->gop_total_frames / stats->gops);
+        flv_json_printf(out, ",\"min_ms\":%u,\"max_ms\":%u,\"mean_ms\":", stats->gop_min_ms, stats->gop_max_ms);
+        flv_json_number(out, (double)stats->gop_total_ms / stats->gops);
+        flv_json_printf(out, ",\"histogram\":[");
+        const char *sep = "";
+        for (uint32_t bin = 0; bin < FLV_STATS_GOP_BINS; ++bin)
+        {
+            if (stats->gop_bins[bin] != 0)
+            {
+                flv_json_printf(out, "%s{\"%s\":%u,\"count\":%u}", sep, (bin < FLV_STATS_GOP_BINS - 1) ? "frames" : "frames_min",
+                    bin, stats->gop_bins[bin]);
+                sep = ",";
+            }
+        }
+        flv_json_printf(out, "]}");
+    }
+
+    flv_json_printf(out, ",\"drift\":");
+    if (stats->drift_samples == 0)
+    {
+        flv_json_printf(out, "null");
+    }
+    else
+    {
+        flv_json_printf(out, "{\"samples\":%llu,\"min_ms\":%d,\"max_ms\":%d,\"mean_ms\":", (unsigned long long)stats->drift_samples,
+            stats->drift_min, stats->drift_max);
+        flv_json_number(out, (double)stats->drift_sum / stats->drift_samples);
+        flv_json_printf(out, ",\"last_ms\":%d}", stats->drift_last);
+    }
+
+    flv_json_printf(out, ",\"resyncs\":%u,\"damaged_bytes\":%llu", stats->resyncs, (unsigned long long)stats->damaged_bytes);
+    flv_json_printf(out, ",\"events\":%u,\"first_events\":[", stats->events);
+    for (uint32_t i = 0; i < stats->events && i < FLV_STATS_EVENTS; ++i)
+    {
+        const flv_stats_event_t &event = stats->event[i];
+        flv_json_printf(out, "%s{\"offset\":%lld,\"type\":\"%s\",\"from\":%u,\"to\":%u}", (i == 0) ? "" : ",",
+            (long long)event.offset, (event.tag_type == TAG_TYPE_AUDIO) ? "audio" : "video", event.from, event.to);
+    }
+    flv_json_printf(out, "]}\n");
+}
@@ -0,0 +1,79 @@
+// flv_stats.h : single-pass stream statistics for QC.
+//
+// Every tag is added to fixed-size accumulators as it goes by, from its
+// header and first body bytes only, so a file of any length is analysed in
+// constant memory at the speed the iterator reads it:
+//
+//   - bitrate per second of media time for audio and video, as a histogram
+//     with power-of-two kbit/s bins plus the lowest, highest and mean rates
+//   - GOP lengths from key frame to key frame, in frames (histogram) and ms
+//   - timestamp discontinuities (forward jumps over FLV_STATS_GAP_MS) and
+//     backward jumps per track; the first FLV_STATS_EVENTS are kept with
+//     their offsets
+//   - A/V drift: the latest audio timestamp minus the latest video one,
+//     sampled at every tag once both have started, which shows how far the
+//     muxer let one track run ahead of the other
+//
+// Media time only advances by regular steps, so the second a tag is counted
+// in stays right across the discontinuities and backward jumps.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_format.h"
+
+//************ stats constants
+#define FLV_STATS_RATE_BINS     24      //bin 0: below 1 kbit/s, bin i: 2^(i-1) to 2^i kbit/s
+#define FLV_STATS_GOP_BINS      512     //GOP length in frames, the last bin holds the longer ones
+#define FLV_STATS_GAP_MS        1000    //a forward jump this large is a discontinuity
+#define FLV_STATS_EVENTS        16      //discontinuities and backward jumps kept in full
+
+typedef struct __flv_stats_event {
+    int64_t offset;         //tag that jumped
+    uint8_t tag_type;
+    uint32_t from;          //timestamp of the track's previous tag
+    uint32_t to;
+} flv_stats_event_t;
+
+typedef struct __flv_stats_track {
+    uint64_t tags;
+    uint64_t bytes;                 //tag data, headers not included
+    int started;
+    uint32_t first_ts, last_ts;
+    uint64_t media_ms;              //time covered by regular steps
+    uint64_t second;                //second of media time being summed
+    uint64_t second_bytes;
+    uint64_t seconds;               //closed seconds
+    uint32_t rate_bins[FLV_STATS_RATE_BINS];
+    uint32_t rate_min, rate_max;    //kbit/s
+    uint32_t gaps, backwards;
+    uint32_t max_gap, max_backward; //ms
+} flv_stats_track_t;
+
+typedef struct __flv_stats {
+    uint64_t tags;
+    uint64_t meta_tags;
+    flv_stats_track_t audio;
+    flv_stats_track_t video;
+    int in_gop;
+    uint32_t gop_frames, gop_start, gop_last;
+    uint32_t gops;
+    uint32_t gop_bins[FLV_STATS_GOP_BINS];
+    uint32_t gop_min_frames, gop_max_frames;
+    uint32_t gop_min_ms, gop_max_ms;
+    uint64_t gop_total_frames, gop_total_ms;
+    uint64_t drift_samples;
+    int64_t drift_sum;
+    int32_t drift_min, drift_max, drift_last;   //ms, audio minus video
+    uint32_t events;                //seen, only FLV_STATS_EVENTS are kept
+    flv_stats_event_t event[FLV_STATS_EVENTS];
+    uint32_t resyncs;               //damaged ranges the iterator skipped, filled in by the caller
+    uint64_t damaged_bytes;
+} flv_stats_t;
+
+//********** stats functions
+void flv_stats_init(flv_stats_t *stats);
+void flv_stats_add(flv_stats_t *stats, int64_t offset, uint8_t tag_type, uint32_t data_size, uint32_t timestamp,
+    const uint8_t *body, uint32_t body_len);
+void flv_stats_finish(flv_stats_t *stats);
+void flv_stats_json(const flv_stats_t *stats, const char *file_name, std::vector<char> *out);
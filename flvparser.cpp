@@ -1,1196 +1,1924 @@
-// This app splits an FLV file based on cue points located in a data file.   
-// It also separates the video from the audio.   
-// All the reverse_bytes action stems from the file format being big-endian   
-// and needing an integer to hold a little-endian version (for proper calculation).   
-
-#include "stdafx.h"
-
-#pragma pack(1)
-
-#define FLV_HEADER_SIGNATURE "FLV"
-#define FLV_OBJECT_END_MARKER "009"
-
-//************ dump type
-#define DUMP_TYPE_DEFAULT 0
-#define DUMP_TYPE_XML 1
-
-//************ Constants
-#define TAG_TYPE_AUDIO 8
-#define TAG_TYPE_VIDEO 9
-#define TAG_TYPE_META 18
-#define CUE_BLOCK_SIZE 32
-#define FLAG_SEPARATE_AV 1
-
-//*********** amf type define
-#define AMF_TYPE_NUMBER          0
-#define AMF_TYPE_BOOLEAN         1
-#define AMF_TYPE_STRING          2
-#define AMF_TYPE_OBJECT          3
-#define AMF_TYPE_MOVIECLIP       4
-#define AMF_TYPE_NULL            5
-#define AMF_TYPE_UNDEFINED       6
-#define AMF_TYPE_REFERENCE       7
-#define AMF_TYPE_ECMA_ARRAY      8
-#define AMF_TYPE_OBJECT_END      9
-#define AMF_TYPE_STRICT_ARRAY   10
-#define AMF_TYPE_DATE           11
-#define AMF_TYPE_LONG_STRING    12
-
-//*********** sound format define
-#define FLV_AUDIO_TAG_SOUND_FORMAT_LINEAR_PCM          0
-#define FLV_AUDIO_TAG_SOUND_FORMAT_ADPCM               1
-#define FLV_AUDIO_TAG_SOUND_FORMAT_MP3                 2
-#define FLV_AUDIO_TAG_SOUND_FORMAT_LINEAR_PCM_LE       3
-#define FLV_AUDIO_TAG_SOUND_FORMAT_NELLYMOSER_16_MONO  4
-#define FLV_AUDIO_TAG_SOUND_FORMAT_NELLYMOSER_8_MONO   5
-#define FLV_AUDIO_TAG_SOUND_FORMAT_NELLYMOSER          6
-#define FLV_AUDIO_TAG_SOUND_FORMAT_G711_A              7
-#define FLV_AUDIO_TAG_SOUND_FORMAT_G711_MU             8
-#define FLV_AUDIO_TAG_SOUND_FORMAT_RESERVED            9
-#define FLV_AUDIO_TAG_SOUND_FORMAT_AAC                 10
-#define FLV_AUDIO_TAG_SOUND_FORMAT_SPEEX               11
-#define FLV_AUDIO_TAG_SOUND_FORMAT_MP3_8               14
-#define FLV_AUDIO_TAG_SOUND_FORMAT_DEVICE_SPECIFIC     15
-
-//*********** sound rate define
-#define FLV_AUDIO_TAG_SOUND_RATE_5_5     0
-#define FLV_AUDIO_TAG_SOUND_RATE_11      1
-#define FLV_AUDIO_TAG_SOUND_RATE_22      2
-#define FLV_AUDIO_TAG_SOUND_RATE_44      3
-
-//*********** mono or sterno sound define
-#define FLV_AUDIO_TAG_SOUND_TYPE_MONO    0
-#define FLV_AUDIO_TAG_SOUND_TYPE_STEREO  1
-
-//*********** sound sample size define
-#define FLV_AUDIO_TAG_SOUND_SIZE_8       0
-#define FLV_AUDIO_TAG_SOUND_SIZE_16      1
-
-//*********** video's codec define
-#define FLV_VIDEO_TAG_CODEC_JPEG            1
-#define FLV_VIDEO_TAG_CODEC_SORENSEN_H263   2
-#define FLV_VIDEO_TAG_CODEC_SCREEN_VIDEO    3
-#define FLV_VIDEO_TAG_CODEC_ON2_VP6         4
-#define FLV_VIDEO_TAG_CODEC_ON2_VP6_ALPHA   5
-#define FLV_VIDEO_TAG_CODEC_SCREEN_VIDEO_V2 6
-#define FLV_VIDEO_TAG_CODEC_AVC             7
-
-//*********** video's frame type define
-#define FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME               1
-#define FLV_VIDEO_TAG_FRAME_TYPE_INTERFRAME             2
-#define FLV_VIDEO_TAG_FRAME_TYPE_DISPOSABLE_INTERFRAME  3
-#define FLV_VIDEO_TAG_FRAME_TYPE_GENERATED_KEYFRAME     4
-#define FLV_VIDEO_TAG_FRAME_TYPE_COMMAND_FRAME          5
-
-//*********** TYPEDEFs
-typedef uint8_t uint24_t[3];
-typedef double amf_number_t;
-typedef struct __amf_data_value amf_data_value_t;
-typedef std::list<amf_data_value_t *> amf_script_data_list_t;
-typedef struct __amf_object_property amf_object_property_t;
-typedef std::list<amf_object_property_t *> amf_obj_property_list_t;
-
-typedef struct __flv_hdr {
-    uint8_t signature[3];
-    uint8_t version;
-    uint8_t flags;
-    uint32_t data_offset;
-} flv_hdr_t;
-
-typedef struct __flv_tag {
-    uint8_t tag_type;
-    uint24_t data_size;
-    uint24_t timestamp;
-    uint8_t timestampex;
-    uint24_t reserved;
-} flv_tag_t;
-
-typedef struct __amf_string {
-    uint16_t size;
-    uint8_t *data;
-} amf_string_t;
-
-typedef struct __amf_long_string {
-    uint32_t size;
-    uint8_t *data;
-} amf_long_string_t;
-
-typedef struct __amf_date {
-    amf_number_t date_time;
-    int16_t offset;
-} amf_date_t;
-
-typedef struct __amf_object_property {
-    amf_string_t property_name;
-    amf_data_value_t *p_data_value;
-} amf_object_property_t;
-
-typedef struct __amf_object_end_marker {
-    uint24_t end_mark;
-} amf_object_end_marker_t;
-
-typedef struct __amf_emca_array {
-    uint32_t arr_len;
-    amf_obj_property_list_t object_property_lst;
-    amf_object_end_marker_t object_end_marker;
-} amf_emca_array_t;
-
-typedef struct __amf_object {
-    amf_obj_property_list_t object_property_lst;
-    amf_object_end_marker_t object_end_marker;
-} amf_object_t;
-
-typedef struct __amf_strict_array {
-    uint32_t arr_len;
-    amf_script_data_list_t amf_data_value_lst;
-} amf_strict_array_t;
-
-typedef struct __amf_data_value {
-    uint8_t type;
-    typedef struct __data_value {
-        amf_number_t number;
-        uint8_t boolean_vaule;
-        uint16_t reference_number;
-        amf_emca_array_t *p_emca_array;
-        amf_strict_array_t *p_strict_array;
-        amf_object_t *p_object;
-        amf_date_t date_value;
-        amf_string_t string_value;
-        amf_long_string_t long_string_value;
-    } data_value_t;
-    data_value_t data_value;
-} amf_data_value_t;
-
-typedef struct __flv_body {
-    uint32_t pre_tag_size;
-    flv_tag_t flv_tag;
-    typedef struct __flv_body_data {
-        uint8_t audio_video_hdr;
-        amf_script_data_list_t amf_script_data_lst;
-    } flv_body_data_t;
-    flv_body_data_t flv_body_data;
-} flv_body_t;
-
-typedef struct __flv_file {
-    flv_hdr_t flv_hdr;
-    std::list<flv_body_t> flv_body_lst;
-} flv_file_t;
-
-//********* global variables
-uint32_t g_cur_num = 0, g_flags = 0;
-char g_project_name[_MAX_PATH];
-flv_file_t g_flv_file;
-
-//********* audio's info define
-static const char *audio_format_info[] = {
-    "Linear PCM, platform endian",
-    "ADPCM",
-    "MP3",
-    "Linear PCM, little endian",
-    "Nellymoser 16 kHz mono",
-    "Nellymoser 8 kHz mono",
-    "Nellymoser",
-    "G.711 A-law logarithmic PCM",
-    "G.711 mu-law logarithmic PCM",
-    "reserved",
-    "AAC",
-    "Speex",
-    "MP3 8 kHz",
-    "Device-specific sound"
-};
-
-static const char *audio_rate_info[] = {
-    "5.5 kHz",
-    "11 kHz",
-    "22 kHz",
-    "44 kHz"
-};
-
-static const char *audio_mono_streno_info[] = {
-    "Mono sound",
-    "Stereo sound"
-};
-
-static const char *audio_sample_size_info[] = {
-    "8-bit samples",
-    "16-bit samples"
-};
-
-//********* video's info define
-static const char *video_codec_info[] = {
-    "JPEG",
-    "Sorenson H.263",
-    "Screen video",
-    "On2 VP6",
-    "On2 VP6 with alpha channel",
-    "Screen video version 2",
-    "AVC"
-};
-
-static const char *video_frame_type[] = {
-    "key frame (for AVC, a seekable frame)",
-    "inter frame (for AVC, a non-seekable frame)",
-    "disposable inter frame (H.263 only)",
-    "generated key frame (reserved for server use only)",
-    "video info/command frame"
-};
-
-//********** local function prototypes
-uint32_t copymem(char *destination, char *source, uint32_t byte_count);
-uint32_t fget(FILE *filehandle, char *buffer, uint32_t buffer_size);
-uint32_t fput(FILE *filehandle, char *buffer, uint32_t buffer_size);
-FILE *open_output_file(uint8_t tag_type);
-void processfile(char *flv_filename, char *cue_file);
-uint32_t *read_cue_file(char *cue_file_name);
-uint32_t xfer(FILE *input_file_handle, FILE *output_file_handle, uint32_t byte_count);
-
-//********** functions for amf's object
-amf_number_t read_number(FILE *ifh, amf_number_t **pp_amf_number);
-uint8_t read_byte(FILE *ifh, uint8_t *pp_amf_byte);
-const uint8_t *read_string(FILE *ifh, amf_string_t *pp_amf_string);
-const uint8_t *read_long_string(FILE *ifh, amf_long_string_t *pp_amf_long_string);
-const uint8_t *read_datadate(FILE *ifh, amf_date_t *pp_amf_datadate);
-uint32_t read_object(FILE *ifh, FILE *parse_file, amf_object_t **pp_amf_object);
-uint32_t read_emca_array(FILE *ifh, FILE *parse_file, amf_emca_array_t **pp_amf_emca_array);
-uint32_t read_strict_array(FILE *ifh, FILE *parse_file, amf_strict_array_t **pp_amf_strict_array);
-const uint8_t *read_end_marker(FILE *ifh, amf_data_value_t *p_amf_marker);
-uint8_t read_amf_data(FILE *ifh, FILE *parse_file, amf_data_value_t **pp_amf_data);
-
-//********** free functions for amf's object
-void free_amf_obj_property(amf_object_property_t *p_obj_property);
-void free_amf_data(amf_data_value_t *p_data_value);
-
-//********** dump functions for amf's object
-void dump_flv_file();
-void dump_meta_data(amf_data_value_t *p_data_value, FILE *xml_file);
-
-//Defines the entry point for the console application.
-#ifdef _WIN32
-int _tmain(int argc, _TCHAR* argv[])
-#else
-int main(int argc, char* argv[])
-#endif
-{
-    if (argc < 3) {
-        printf("usage: %s flv_file cue [ --split ]\n", argv[0]);
-        printf("  cue_file - a file store some cue time point.\n");
-        printf("             e.g. : \n");
-        printf("             00:11:14:00\n");
-        printf("             02:05:04:38\n");
-        printf("             03:12:14:21\n");
-        printf("             03:04:14:13\n");
-        printf("             04:13:15:23\n");
-        printf("  split    - split audio and video into a stand-alone file\n");
-        exit(EXIT_FAILURE);
-    }
-    else {
-        if ((argc==4) && (strstr(argv[3],"--split")!=NULL)) {
-            g_flags |= FLAG_SEPARATE_AV;
-        }
-        //printf("sizeof(flv_hdr_t) = %d\n", sizeof(flv_hdr_t));
-        //printf("sizeof(flv_tag_t) = %d\n", sizeof(flv_tag_t));
-        processfile(argv[1], argv[2]);
-    }
-    //getchar();
-
-    return 0;
-}
-
-//processfile is the central function   
-void processfile(char *in_file, char *cue_file){   
-
-    FILE *ifh=NULL, *vfh=NULL, *afh = NULL, *parse_file = NULL;
-    flv_hdr_t &flv_hdr = g_flv_file.flv_hdr;
-    flv_body_t flv_body;
-    flv_tag_t &flv_tag = flv_body.flv_tag;
-    uint32_t &pre_tag_size = flv_body.pre_tag_size, pts_z=0;
-    uint32_t *cue, ts = 0, ts_new = 0, ts_offset = 0;
-    uint32_t ptag = DUMP_TYPE_DEFAULT, timestamp = 0, datasize = 0;
-
-    //set project name
-    strncpy(g_project_name, in_file, strstr(in_file, ".flv") - in_file);
-
-    //open the input file   
-    if ((ifh = fopen(in_file, "rb")) == NULL) {   
-        fprintf(parse_file, "Failed to open %s", in_file);   
-        return;   
-    }
-    if ((parse_file = open_output_file(ptag)) == NULL) {
-        return;
-    }
-
-    fprintf(parse_file, "Processing [%s] with cue file [%s]\n", in_file, cue_file);
-
-    //build cue array   
-    cue = read_cue_file(cue_file);   
-
-    //capture the FLV file header   
-    fget(ifh, (char *)&flv_hdr, sizeof(flv_hdr_t));
-
-    //move the file pointer to the end of the header
-    std::reverse((uint8_t *)&flv_hdr.data_offset, (uint8_t *)&flv_hdr.data_offset + sizeof(flv_hdr.data_offset));
-    datasize = flv_hdr.data_offset;
-    fseek(ifh, datasize, SEEK_SET);
-
-    fprintf(parse_file, "================= flv.header(: %lu) =====================\n", sizeof(flv_hdr_t));
-    fprintf(parse_file, "flv.header.signature[3] = '%c' '%c' '%c'\n", flv_hdr.signature[0], flv_hdr.signature[1], flv_hdr.signature[2]);
-    fprintf(parse_file, "flv.header.version = 0x%X\n", flv_hdr.version);
-    fprintf(parse_file, "flv.header.flags = 0x%X\n", flv_hdr.flags);
-    fprintf(parse_file, "flv.header.flags.has_audio = %d\n", (flv_hdr.flags & 0x04) != 0);
-    fprintf(parse_file, "flv.header.flags.has_video = %d\n", (flv_hdr.flags & 0x01) != 0);
-    fprintf(parse_file, "flv.header.dataoffset = %u\n", datasize);
-
-    fprintf(parse_file, "\n================= flv.tag =====================\n");
-    //process each tag in the file   
-    do {   
-
-        //capture the PreviousTagSize integer   
-#ifdef _WIN32
-        pre_tag_size = _getw(ifh);
-#else
-	pre_tag_size = getw(ifh);
-#endif
-        std::reverse((uint8_t *)&pre_tag_size, (uint8_t *)&pre_tag_size + sizeof(pre_tag_size));
-        fprintf(parse_file, "pre_tag_size:   %d\n", pre_tag_size);
-
-        //extract the tag from the input file   
-        fget(ifh, (char *)&flv_tag, sizeof(flv_tag_t));   
-
-        //set the tag value to select on   
-        ptag = flv_tag.tag_type;   
-
-        //if we are not separating AV, process the audio like video   
-        if (!(g_flags && FLAG_SEPARATE_AV)) {
-            ptag = TAG_TYPE_VIDEO;
-        }
-
-        //if we are not past the end of file, process the tag   
-        if (!feof(ifh)) {
-
-            //if we've exceed the cuepoint then close output files and select next cuepoint
-            std::reverse((uint8_t *)&flv_tag.timestamp, (uint8_t *)&flv_tag.timestamp + sizeof(flv_tag.timestamp));
-            memcpy(&timestamp, flv_tag.timestamp, sizeof(flv_tag.timestamp));
-            timestamp += flv_tag.timestampex << 24;
-            std::reverse((uint8_t *)&flv_tag.data_size, (uint8_t *)&flv_tag.data_size + sizeof(flv_tag.data_size));
-            memcpy(&datasize, flv_tag.data_size, sizeof(flv_tag.data_size));
-
-            fprintf(parse_file, "\n================= flv.tag.head(: %lu) =====================\n", sizeof(flv_tag_t));
-            fprintf(parse_file, "flv.tag.tagType     = %d\n", ptag);
-            fprintf(parse_file, "flv.tag.datasize    = %d\n", datasize);
-            fprintf(parse_file, "flv.tag.Timestamp   = %d\n", timestamp);
-            fprintf(parse_file, "flv.tag.TimestampEx = %d", flv_tag.timestampex);
-
-            if (timestamp > cue[g_cur_num]) {
-
-                //close any audio file and designated closed with NULL   
-                if (afh != NULL) {
-                    fclose(afh);
-                    afh = NULL;
-                }
-
-                //close any video file and designated closed with NULL   
-                if (vfh != NULL) {
-                    fclose(vfh);
-                    vfh = NULL;
-                }
-
-                //increment the current slide   
-                g_cur_num++;   
-
-                //provide feedback to the user   
-                fprintf(parse_file, "Processing slide %i...\n", g_cur_num);   
-            }   
-
-            //process tag by type   
-            switch (ptag) {   
-
-            case TAG_TYPE_AUDIO:  //we only process like this if we are separating audio into an mp3 file   
-                {
-                    fprintf(parse_file, "\n================= flv.tag.body.audio.header =====================\n");
-                    //if the output file hasn't been opened, open it.   
-                    if (afh == NULL) {
-                        if ((afh = open_output_file(ptag)) == NULL)
-                        {
-                            fprintf(parse_file, "open file fail, err = %s\n",
-				strerror(errno));
-                            break;
-                        }
-                    }
-#if 0
-                    //jump past audio tag header uint8_t
-                    fseek(ifh, 1, SEEK_CUR);
-#endif
-                    uint8_t &flv_audio_header = flv_body.flv_body_data.audio_video_hdr;
-                    fget(ifh, (char *)&flv_audio_header, sizeof(flv_audio_header));
-                    // decoce audio tag header.
-                    short sound_format = (flv_audio_header >> 4) & 0x0F;
-                    short sample_rate = (flv_audio_header >> 2) & 0x03;
-                    short sample_size = (flv_audio_header >> 1) & 0x01;
-                    short sound_type = (flv_audio_header >> 0) & 0x01;
-                    fprintf(parse_file, "sound format: %2d - %s\n", sound_format, audio_format_info[sound_format]);
-                    fprintf(parse_file, "sound rate:   %2d - %s\n", sample_rate, audio_rate_info[sample_rate]);
-                    fprintf(parse_file, "sample size:  %2d - %s\n", sample_size, audio_sample_size_info[sample_size]);
-                    fprintf(parse_file, "sound type:   %2d - %s\n", sound_type, audio_mono_streno_info[sound_type]);
-                    fprintf(parse_file, "datasize:     %d\n", datasize);
-#if 0
-                    if (sound_format == FLV_AUDIO_TAG_SOUND_FORMAT_AAC)
-                    {
-                        uint8_t aac_pkt_type = 0x0;
-                        fget(ifh, (char *)&aac_pkt_type, sizeof(aac_pkt_type));
-                        aac_pkt_type = reverse_bytes(&aac_pkt_type, sizeof(aac_pkt_type));
-                        fprintf(parse_file, "AAC Packet Type: %d - %s\n", aac_pkt_type, aac_pkt_type ? "AAC raw" : "AAC sequence header");
-                    }
-#endif
-
-                    //dump the audio data to the output file
-                    xfer(ifh, afh, datasize - 1);
-                }
-
-                break;   
-
-            case TAG_TYPE_VIDEO:
-                {
-                    fprintf(parse_file, "\n================= flv.tag.body.video.header =====================\n");
-                    //if the output file hasn't been opened, open it.   
-                    if (vfh == NULL) {   
-
-                        //get the new video output file pointer   
-                        vfh = open_output_file(ptag);   
-
-                        //record the timestamp offset for this slice
-                        std::reverse((uint8_t *)&flv_tag.timestamp, (uint8_t *)&flv_tag.timestamp + sizeof(flv_tag.timestamp));
-                        memcpy(&ts_offset, flv_tag.timestamp, sizeof(flv_tag.timestamp));
-
-                        //write the flv header (reuse the original file's hdr) and first pts   
-                        fput(vfh, (char *)&flv_hdr, sizeof(flv_hdr));   
-                        fput(vfh, (char *)&pts_z, sizeof(pts_z));   
-                    }   
-
-                    //offset the timestamp in the tag   
-                    std::reverse((uint8_t *)&flv_tag.timestamp, (uint8_t *)&flv_tag.timestamp + sizeof(flv_tag.timestamp));
-                    memcpy(&timestamp, flv_tag.timestamp, sizeof(flv_tag.timestamp));
-                    ts = timestamp - ts_offset;
-
-                    //reverse the timestamp bytes back into BigEndian
-                    std::reverse((uint8_t *)&ts, (uint8_t *)&ts + sizeof(ts));
-                    ts_new = ts;
-
-                    //overwrite the highest 3 bytes of the integer into the timestamp   
-                    copymem((char *)&flv_tag.timestamp, (char *)(((char *)&ts_new) + 1), sizeof(flv_tag.timestamp));   
-
-                    //write tag to output file   
-                    fput(vfh, (char *)&flv_tag, sizeof(flv_tag));
-
-                    // decode video's header
-                    uint8_t &flv_video_header = flv_body.flv_body_data.audio_video_hdr;
-                    fget(ifh, (char *)&flv_video_header, sizeof(flv_video_header));
-                    short frame_type = (flv_video_header >> 4) & 0x0F;
-                    short codec_id = (flv_video_header >> 0) & 0x0F;
-                    fprintf(parse_file, "frame type: %3d - %s\n", frame_type, video_frame_type[frame_type - 1]);
-                    fprintf(parse_file, "codec id:   %3d - %s\n", codec_id, video_codec_info[codec_id - 1]);
-                    fprintf(parse_file, "datasize:     %d\n", datasize);
-                    fseek(ifh, -1, SEEK_CUR);
-
-                    //dump the video data to the output file, including the PTS field
-                    xfer(ifh, vfh, datasize + 4);
-
-                    //rewind 4 bytes, because we need to read the PTS again for the loop's sake   
-                    fseek(ifh, -4, SEEK_CUR);
-                }
-
-                break;
-
-            case TAG_TYPE_META:
-                fprintf(parse_file, "\n================= flv.tag.event(onMetaData).header =====================");
-                {
-                    long fpos = ftell(ifh);
-                    {
-                        amf_data_value_t *p_amf_data = new amf_data_value_t();
-                        assert(read_byte(ifh, &p_amf_data->type) == AMF_TYPE_STRING);
-                        read_string(ifh, &p_amf_data->data_value.string_value);
-                        flv_body.flv_body_data.amf_script_data_lst.push_back(p_amf_data);
-
-                        p_amf_data = new amf_data_value_t();
-                        read_amf_data(ifh, parse_file, &p_amf_data);
-                        flv_body.flv_body_data.amf_script_data_lst.push_back(p_amf_data);
-                    }
-                    fseek(ifh, fpos, SEEK_SET);
-                }
-            default:
-                //skip the data of this tag
-                fseek(ifh, datasize, SEEK_CUR);
-            }
-        }
-
-        g_flv_file.flv_body_lst.push_back(flv_body);
-
-    } while (!feof(ifh));
-
-    dump_flv_file();
-
-    std::for_each(flv_body.flv_body_data.amf_script_data_lst.begin(), flv_body.flv_body_data.amf_script_data_lst.end(), &free_amf_data);
-
-#ifdef _WIN32
-    //finished...close all file pointers   
-    _fcloseall();
-#else
-	fcloseall();
-#endif
-
-    //feedback to user   
-    fprintf(parse_file, "Program complete.");
-}
-
-uint8_t read_byte(FILE *ifh, uint8_t *p_amf_byte)
-{
-    if (NULL == p_amf_byte)
-    {
-        p_amf_byte = new uint8_t();
-    }
-    uint8_t &cn = *p_amf_byte;
-    fget(ifh, (char*)&cn, sizeof(cn));
-    std::reverse((uint8_t *)&cn, (uint8_t *)&cn + sizeof(cn));
-
-    return cn;
-}
-
-amf_number_t read_number(FILE *ifh, amf_number_t *p_amf_number)
-{
-    if (NULL == p_amf_number)
-    {
-        p_amf_number = new amf_number_t();
-    }
-    amf_number_t &dn = *p_amf_number;
-    fget(ifh, (char*)&dn, sizeof(dn));
-    std::reverse((uint8_t *)&dn, (uint8_t *)&dn + sizeof(dn));
-
-    return dn;
-}
-
-const uint8_t *read_string(FILE *ifh, amf_string_t *p_amf_string)
-{
-    if (NULL == p_amf_string)
-    {
-        p_amf_string = new amf_string_t();
-    }
-    uint16_t &usn = p_amf_string->size;
-    uint8_t *&data = p_amf_string->data;
-    fget(ifh, (char*)&usn, sizeof(usn));
-    std::reverse((uint8_t *)&usn, (uint8_t *)&usn + sizeof(usn));
-    data = new uint8_t[usn + 1];
-    data[usn] = '\0';
-    fget(ifh, (char*)data, usn);
-
-    return data;
-}
-
-const uint8_t *read_long_string(FILE *ifh, amf_long_string_t *p_amf_long_string)
-{
-    if (NULL == p_amf_long_string)
-    {
-        p_amf_long_string = new amf_long_string_t();
-    }
-    uint32_t &usn = p_amf_long_string->size;
-    uint8_t *&data = p_amf_long_string->data;
-    fget(ifh, (char*)&usn, sizeof(usn));
-    std::reverse((uint8_t *)&usn, (uint8_t *)&usn + sizeof(usn));
-    data = new uint8_t[usn + 1];
-    data[usn] = '\0';
-    fget(ifh, (char*)data, usn);
-
-    return data;
-}
-
-const uint8_t *read_datadate(FILE *ifh, amf_date_t *p_amf_datetime)
-{
-    if (NULL == p_amf_datetime)
-    {
-        p_amf_datetime = new amf_date_t();
-    }
-    amf_number_t &date_time = p_amf_datetime->date_time;
-    int16_t &offset = p_amf_datetime->offset;
-    read_number(ifh, &date_time);
-    fget(ifh, (char *)&offset, sizeof(offset));
-    std::reverse((uint8_t *)&offset, (uint8_t *)&offset + sizeof(offset));
-
-    static uint8_t local_time[] = { 0 };
-    return local_time;
-}
-
-uint32_t read_object(FILE *ifh, FILE *parse_file, amf_object_t **pp_amf_object)
-{
-    if (NULL == *pp_amf_object)
-    {
-        *pp_amf_object = new amf_object_t();
-    }
-    amf_object_t *p_amf_object = *pp_amf_object;
-    uint32_t arr_size = 0;
-    fprintf(parse_file, "object:\n");
-    while (true)
-    {
-        amf_object_property_t *p_object_property = new amf_object_property_t();
-        amf_string_t *p_amf_string = &p_object_property->property_name;
-        const uint8_t *name = read_string(ifh, p_amf_string);
-        if (strlen((const char *)name))
-        {
-            fprintf(parse_file, "\t%s: ", name);
-        }
-
-        uint8_t type = read_amf_data(ifh, parse_file, &p_object_property->p_data_value);
-        p_amf_object->object_property_lst.push_back(p_object_property);
-        if (type == AMF_TYPE_OBJECT_END)
-        {
-            break;
-        }
-        ++arr_size;
-    }
-
-    return arr_size;
-}
-
-uint32_t read_emca_array(FILE *ifh, FILE *parse_file, amf_emca_array_t **pp_amf_emca_array)
-{
-    if (NULL == *pp_amf_emca_array)
-    {
-        *pp_amf_emca_array = new amf_emca_array_t();
-    }
-    amf_emca_array_t *p_amf_emca_array = *pp_amf_emca_array;
-    uint32_t &arr_size = p_amf_emca_array->arr_len;
-    fget(ifh, (char*)&arr_size, sizeof(arr_size));
-    std::reverse((uint8_t *)&arr_size, (uint8_t *)&arr_size + sizeof(arr_size));
-    
-    fprintf(parse_file, "emca_array:\n");
-    for (uint32_t i = 0; i < arr_size; ++i)
-    {
-        amf_object_property_t *p_amf_obj_property = new amf_object_property_t();
-        p_amf_obj_property->p_data_value = new amf_data_value_t();
-        amf_string_t *p_amf_string = &p_amf_obj_property->property_name;
-        fprintf(parse_file, "\t%s: ", read_string(ifh, p_amf_string));
-
-        uint8_t type = read_amf_data(ifh, parse_file, &p_amf_obj_property->p_data_value);
-        p_amf_emca_array->object_property_lst.push_back(p_amf_obj_property);
-        if (type == AMF_TYPE_OBJECT_END)
-        {
-            break;
-        }
-    }
-    return arr_size;
-}
-
-uint32_t read_strict_array(FILE *ifh, FILE *parse_file, amf_strict_array_t **pp_amf_strict_array)
-{
-    if (NULL == *pp_amf_strict_array)
-    {
-        *pp_amf_strict_array = new amf_strict_array_t();
-    }
-    amf_strict_array_t *p_amf_strict_array = *pp_amf_strict_array;
-    uint32_t &arr_size = p_amf_strict_array->arr_len;
-    fget(ifh, (char*)&arr_size, sizeof(arr_size));
-    std::reverse((uint8_t *)&arr_size, (uint8_t *)&arr_size + sizeof(arr_size));
-    fprintf(parse_file, "strict_array:\n");
-    for (uint32_t i = 0; i < arr_size; ++i)
-    {
-        fprintf(parse_file, "\tvalue%u: ", i);
-        amf_data_value_t *p_amf_data = new amf_data_value_t();
-        read_amf_data(ifh, parse_file, &p_amf_data);
-        p_amf_strict_array->amf_data_value_lst.push_back(p_amf_data);
-    }
-    return arr_size;
-}
-
-const uint8_t *read_end_marker(FILE *ifh, amf_data_value_t *p_amf_marker)
-{
-    if (NULL == p_amf_marker)
-    {
-        return NULL;
-    }
-    amf_object_end_marker_t *p_end_marker = NULL;
-    switch (p_amf_marker->type)
-    {
-    case AMF_TYPE_OBJECT:
-        if (NULL == p_amf_marker->data_value.p_object)
-        {
-            p_amf_marker->data_value.p_object = new amf_object_t();
-        }
-        p_end_marker = &p_amf_marker->data_value.p_object->object_end_marker;
-        break;
-    case AMF_TYPE_ECMA_ARRAY:
-        if (NULL == p_amf_marker->data_value.p_emca_array)
-        {
-            p_amf_marker->data_value.p_emca_array = new amf_emca_array_t();
-        }
-        p_end_marker = &p_amf_marker->data_value.p_emca_array->object_end_marker;
-        break;
-    default:
-        break;
-    }
-    if (NULL != p_end_marker)
-    {
-        uint24_t &end_marker = p_end_marker->end_mark;
-        fget(ifh, (char *)end_marker, sizeof(end_marker));
-        assert(end_marker[0] = FLV_OBJECT_END_MARKER[0]);
-        assert(end_marker[1] = FLV_OBJECT_END_MARKER[0]);
-        assert(end_marker[2] = FLV_OBJECT_END_MARKER[2]);
-        return end_marker;
-    }
-    return NULL;
-}
-
-uint8_t read_amf_data(FILE *ifh, FILE *parse_file, amf_data_value_t **pp_amf_data)
-{
-    if (NULL == *pp_amf_data)
-    {
-        *pp_amf_data = new amf_data_value_t();
-    }
-    uint8_t type = read_byte(ifh, &(*pp_amf_data)->type);
-    switch (type)
-    {
-    case AMF_TYPE_NUMBER:
-        {
-            amf_number_t dfn = read_number(ifh, &(*pp_amf_data)->data_value.number);
-            fprintf(parse_file, "%0.2lf\n", dfn);
-        }
-        break;
-    case AMF_TYPE_BOOLEAN:
-        {
-            uint8_t cn = read_byte(ifh, &(*pp_amf_data)->data_value.boolean_vaule);
-            fprintf(parse_file, "%d\n", cn);
-        }
-        break;
-    case AMF_TYPE_STRING:
-        {
-            const uint8_t *value= read_string(ifh, &(*pp_amf_data)->data_value.string_value);
-            fprintf(parse_file, "%s\n", value);
-        }
-        break;
-    case AMF_TYPE_OBJECT:
-        {
-            fprintf(parse_file, "\n");
-            uint32_t nobject = read_object(ifh, parse_file, &(*pp_amf_data)->data_value.p_object);
-            fprintf(parse_file, "object's num = %d\n", nobject);
-        }
-        break;
-    case AMF_TYPE_REFERENCE:
-        {
-            unsigned short reference = 0;
-            fget(ifh, (char *)&reference, sizeof(reference));
-            fprintf(parse_file, "%u\n", reference);
-        }
-        break;
-    case AMF_TYPE_ECMA_ARRAY:
-        {
-            fprintf(parse_file, "\n");
-            uint32_t narr = read_emca_array(ifh, parse_file, &(*pp_amf_data)->data_value.p_emca_array);
-            fprintf(parse_file, "emca_array's num = %d\n", narr);
-        }
-        break;
-    case AMF_TYPE_OBJECT_END:
-        {
-            read_end_marker(ifh, *pp_amf_data);
-        }
-        break;
-    case AMF_TYPE_STRICT_ARRAY:
-        {
-            fprintf(parse_file, "\n");
-            uint32_t nsarr = read_strict_array(ifh, parse_file, &(*pp_amf_data)->data_value.p_strict_array);
-            fprintf(parse_file, "strict_array's num = %d\n", nsarr);
-        }
-        break;
-    case AMF_TYPE_LONG_STRING:
-        {
-            const uint8_t *value= read_long_string(ifh, &(*pp_amf_data)->data_value.long_string_value);
-            fprintf(parse_file, "%s\n", value);
-        }
-        break;
-    default:
-        break;
-    }
-    return type;
-}
-
-void free_amf_obj_property(amf_object_property_t *p_obj_property)
-{
-    if (NULL == p_obj_property)
-    {
-        return;
-    }
-    if (NULL != p_obj_property->property_name.data)
-    {
-        delete[] p_obj_property->property_name.data;
-        p_obj_property->property_name.data = NULL;
-    }
-    if (NULL != p_obj_property->p_data_value)
-    {
-        free_amf_data(p_obj_property->p_data_value);
-    }
-}
-
-void free_amf_data(amf_data_value_t *p_data_value)
-{
-    if (NULL == p_data_value)
-    {
-        return;
-    }
-    switch (p_data_value->type)
-    {
-    case AMF_TYPE_STRING:
-        if (NULL != p_data_value->data_value.string_value.data)
-        {
-            delete[] p_data_value->data_value.string_value.data;
-            p_data_value->data_value.string_value.data = NULL;
-        }
-        break;
-    case AMF_TYPE_LONG_STRING:
-        if (NULL != p_data_value->data_value.long_string_value.data)
-        {
-            delete[] p_data_value->data_value.long_string_value.data;
-            p_data_value->data_value.long_string_value.data = NULL;
-        }
-        break;
-    case AMF_TYPE_ECMA_ARRAY:
-        if (NULL != p_data_value->data_value.p_emca_array)
-        {
-            amf_obj_property_list_t &object_property_lst = p_data_value->data_value.p_emca_array->object_property_lst;
-            std::for_each(object_property_lst.begin(), object_property_lst.end(), &free_amf_obj_property);
-            delete p_data_value->data_value.p_emca_array; p_data_value->data_value.p_emca_array = NULL;
-        }
-        break;
-    case AMF_TYPE_STRICT_ARRAY:
-        if (NULL != p_data_value->data_value.p_strict_array)
-        {
-            amf_script_data_list_t &amf_data_lst = p_data_value->data_value.p_strict_array->amf_data_value_lst;
-            std::for_each(amf_data_lst.begin(), amf_data_lst.end(), &free_amf_data);
-            delete p_data_value->data_value.p_strict_array; p_data_value->data_value.p_strict_array = NULL;
-        }
-        break;
-    case AMF_TYPE_OBJECT:
-        break;
-    default:
-        break;
-    }
-}
-
-void dump_flv_file()
-{
-    FILE *xml_file = NULL;
-    if ((xml_file = open_output_file(DUMP_TYPE_XML)) == NULL)
-    {
-        return;
-    }
-    fprintf(xml_file, "<?xml version='1.0' encoding='UTF-8'?>\n");
-    fprintf(xml_file, "<fileset>\n");
-    fprintf(xml_file, "<flv name=\"%s\">\n", g_project_name);
-
-    const flv_hdr_t &flv_hdr = g_flv_file.flv_hdr;
-    fprintf(xml_file, "<header len=\"%lu\">\n", sizeof(flv_hdr_t));
-    fprintf(xml_file, "<signature>%c%c%c</signature>\n", flv_hdr.signature[0], flv_hdr.signature[1], flv_hdr.signature[2]);
-    fprintf(xml_file, "<version>0x%X</version>\n", flv_hdr.version);
-    fprintf(xml_file, "<flags has_audio=\"%d\" has_video=\"%d\">0x%X</flags>\n",
-        (flv_hdr.flags & 0x04) != 0, (flv_hdr.flags & 0x01) != 0, flv_hdr.flags);
-    fprintf(xml_file, "<data_offset>%u</data_offset>\n", flv_hdr.data_offset);
-    fprintf(xml_file, "</header>\n");
-
-    fprintf(xml_file, "<tags len=\"%lu\">\n", g_flv_file.flv_body_lst.size());
-
-    for (std::list<flv_body_t>::const_iterator citer = g_flv_file.flv_body_lst.begin();
-        citer != g_flv_file.flv_body_lst.end(); ++citer)
-    {
-        uint32_t datasize = 0, timestamp = 0;
-        memcpy(&datasize, citer->flv_tag.data_size, sizeof(citer->flv_tag.data_size));
-        memcpy(&timestamp, citer->flv_tag.timestamp, sizeof(citer->flv_tag.timestamp));
-        fprintf(xml_file, "<pre_tag_size>%d</pre_tag_size>\n", citer->pre_tag_size);
-        fprintf(xml_file, "<tag type=\"%s\">\n", (citer->flv_tag.tag_type == TAG_TYPE_AUDIO) ? 
-            "audio" : ((citer->flv_tag.tag_type == TAG_TYPE_VIDEO) ? "video" : "script_data"));
-        fprintf(xml_file, "<head len=\"%lu\">\n", sizeof(flv_tag_t));
-        fprintf(xml_file, "<tagType>%d</tagType>\n", citer->flv_tag.tag_type);
-        fprintf(xml_file, "<datasize>%d</datasize>\n", datasize);
-        fprintf(xml_file, "<timestamp>%d</timestamp>\n", timestamp);
-        fprintf(xml_file, "<timestampex>%d</timestampex>", citer->flv_tag.timestampex);
-        fprintf(xml_file, "</head>\n");
-
-        fprintf(xml_file, "<body>\n");
-        switch (citer->flv_tag.tag_type)
-        {
-        case TAG_TYPE_AUDIO:
-            {
-                fprintf(xml_file, "<audio_header>\n");
-                uint16_t sound_format = (citer->flv_body_data.audio_video_hdr >> 4) & 0x0F;
-                uint16_t sample_rate = (citer->flv_body_data.audio_video_hdr >> 2) & 0x03;
-                uint16_t sample_size = (citer->flv_body_data.audio_video_hdr >> 1) & 0x01;
-                uint16_t sound_type = (citer->flv_body_data.audio_video_hdr >> 0) & 0x01;
-                fprintf(xml_file, "<sound_format value=\"%2d\">%s</sound_format>\n", sound_format, audio_format_info[sound_format]);
-                fprintf(xml_file, "<sound_rate value=\"%2d\">%s</sound_rate>\n", sample_rate, audio_rate_info[sample_rate]);
-                fprintf(xml_file, "<sample_size value=\"%2d\">%s</sample_size>\n", sample_size, audio_sample_size_info[sample_size]);
-                fprintf(xml_file, "<sound_type value=\"%2d\">%s</sound_type>\n", sound_type, audio_mono_streno_info[sound_type]);
-                fprintf(xml_file, "<datasize>%d</datasize>\n", datasize);
-                fprintf(xml_file, "</audio_header>\n");
-            }
-            break;
-        case TAG_TYPE_VIDEO:
-            {
-                fprintf(xml_file, "<video_header>\n");
-                uint16_t frame_type = (citer->flv_body_data.audio_video_hdr >> 4) & 0x0F;
-                uint16_t codec_id = (citer->flv_body_data.audio_video_hdr >> 0) & 0x0F;
-                fprintf(xml_file, "<frame_type value=\"%3d\">%s</frame_type>\n",
-                    frame_type, video_frame_type[frame_type - 1]);
-                fprintf(xml_file, "<codec_id value=\"%3d\">%s</codec_id>\n", codec_id, video_codec_info[codec_id - 1]);
-                fprintf(xml_file, "<datasize>%d</datasize>\n", datasize);
-                fprintf(xml_file, "</video_header>\n");
-            }
-            break;
-        case TAG_TYPE_META:
-            {
-                //assert(citer->flv_body_data.amf_script_data_lst.size() == 2);
-                for (amf_script_data_list_t::const_iterator ci = citer->flv_body_data.amf_script_data_lst.begin();
-                    ci != citer->flv_body_data.amf_script_data_lst.end(); )
-                {
-                    fprintf(xml_file, "<name value=\"%s\"/>\n", (*ci)->data_value.string_value.data);
-                    fprintf(xml_file, "<value>\n");
-                    std::advance(ci, 1);
-                    dump_meta_data(*ci, xml_file);
-                    fprintf(xml_file, "</value>\n");
-                    //std::for_each(amf_list.begin(), amf_list.end(), std::bind2nd(std::ptr_fun(dump_meta_data), xml_file));
-                    std::advance(ci, 1);
-                }
-            }
-            break;
-        default:
-            break;
-        }
-
-        fprintf(xml_file, "</body>\n");
-        fprintf(xml_file, "</tag>\n");
-    }
-
-    fprintf(xml_file, "</tags>\n");
-
-    fprintf(xml_file, "</flv>\n");
-    fprintf(xml_file, "</fileset>\n");
-}
-
-void dump_meta_data(amf_data_value_t *p_data_value, FILE *xml_file)
-{
-    if (NULL == p_data_value)
-    {
-        return;
-    }
-    //fprintf(xml_file, "<type>%d</type>\n", p_data_value->type);
-    switch (p_data_value->type)
-    {
-    case AMF_TYPE_NUMBER:
-        {
-            fprintf(xml_file, "<number value=\"%.2f\"/>\n", p_data_value->data_value.number);
-        }
-        break;
-    case AMF_TYPE_BOOLEAN:
-        {
-            fprintf(xml_file, "<boolean value=\"%d\"/>\n", p_data_value->data_value.boolean_vaule);
-        }
-        break;
-    case AMF_TYPE_STRING:
-        {
-            fprintf(xml_file, "<string value=\"%s\"/>\n", p_data_value->data_value.string_value.data);
-        }
-        break;
-    case AMF_TYPE_OBJECT:
-        {
-            amf_object_t *p_amf_obj = p_data_value->data_value.p_object;
-            if (NULL == p_amf_obj)
-            {
-                break;
-            }
-            fprintf(xml_file, "<object>\n");
-            for (amf_obj_property_list_t::const_iterator citer = p_amf_obj->object_property_lst.begin();
-                citer != p_amf_obj->object_property_lst.end(); ++citer)
-            {
-                fprintf(xml_file, "<name value=\"%s\">\n", (*citer)->property_name.data);
-                dump_meta_data((*citer)->p_data_value, xml_file);
-                fprintf(xml_file, "</name>\n");
-            }
-            fprintf(xml_file, "</object>\n");
-        }
-        break;
-    case AMF_TYPE_REFERENCE:
-        {
-        }
-        break;
-    case AMF_TYPE_ECMA_ARRAY:
-        {
-            amf_emca_array_t *p_emca_array = p_data_value->data_value.p_emca_array;
-            if (NULL == p_emca_array)
-            {
-                break;
-            }
-            fprintf(xml_file, "<ecma_array>\n");
-            for (amf_obj_property_list_t::const_iterator citer = p_emca_array->object_property_lst.begin();
-                citer != p_emca_array->object_property_lst.end(); ++citer)
-            {
-                fprintf(xml_file, "<name value=\"%s\">\n", (*citer)->property_name.data);
-                dump_meta_data((*citer)->p_data_value, xml_file);
-                fprintf(xml_file, "</name>\n");
-            }
-            fprintf(xml_file, "</ecma_array>\n");
-        }
-        break;
-    case AMF_TYPE_OBJECT_END:
-        {
-            fprintf(xml_file, "<obj_end>%d</obj_end>\n", AMF_TYPE_OBJECT_END);
-        }
-        break;
-    case AMF_TYPE_STRICT_ARRAY:
-        {
-            amf_strict_array_t *p_strict_arr = p_data_value->data_value.p_strict_array;
-            if (NULL == p_strict_arr)
-            {
-                break;
-            }
-            fprintf(xml_file, "<strict_array>\n");
-            std::for_each(p_strict_arr->amf_data_value_lst.begin(), p_strict_arr->amf_data_value_lst.end(),
-                std::bind2nd(std::ptr_fun(dump_meta_data), xml_file));
-            fprintf(xml_file, "</strict_array>\n");
-        }
-        break;
-    case AMF_TYPE_LONG_STRING:
-        {
-            fprintf(xml_file, "<str>%s</str>\n", p_data_value->data_value.long_string_value.data);
-        }
-        break;
-    default:
-        break;
-    }
-}
-
-//fget - fill a buffer or structure with bytes from a file   
-uint32_t fget(FILE *fh, char *p, uint32_t s) {
-    uint32_t i = 0;
-    for (; i<s; i++)   
-        *(p+i) = (char)fgetc(fh);   
-    return i;   
-}   
-
-//fput - write a buffer or structure to file   
-uint32_t fput(FILE *fh, char *p, uint32_t s) {
-    uint32_t i = 0;   
-    for (; i<s; i++)   
-        fputc(*(p+i), fh);   
-    return i;   
-}   
-
-//utility function to overwrite memory   
-uint32_t copymem(char *d, char *s, uint32_t c) {
-    uint32_t i = 0;
-    for (; i<c; i++)   
-        *(d+i) = *(s+i);   
-    return i;   
-}
-
-//xfer - transfers *count* bytes from an input file to an output file   
-uint32_t xfer(FILE *ifh, FILE *ofh, uint32_t c) {
-    uint32_t i = 0;
-    for (; i<c; i++)   
-        fputc(fgetc(ifh),ofh);   
-    return i;   
-}   
-
-//This function handles iterative file naming and opening   
-FILE* open_output_file(uint8_t tag) {   
-
-    //instantiate two buffers   
-    char file_name[_MAX_FNAME] = { 0 }, ext[_MAX_EXT] = { 0 };
-    switch (tag)
-    {
-    case DUMP_TYPE_DEFAULT:
-        //determine the file extension   
-        strcpy(ext, "txt\0");
-        break;
-    case DUMP_TYPE_XML:
-        //determine the file extension   
-        strcpy(ext, "xml\0");
-        break;
-    case TAG_TYPE_AUDIO:
-        //determine the file extension   
-        strcpy(ext, "mp3\0");
-        break;
-    case TAG_TYPE_VIDEO:
-        //determine the file extension   
-        strcpy(ext, "flv\0");
-        break;
-    default:
-        //determine the file extension   
-        strcpy(ext, "txt\0");
-        break;
-    }
-
-    //build the file name   
-    sprintf(file_name, "%s_%i.%s", g_project_name, g_cur_num, ext);   
-
-    //return the file pointer   
-    return fopen(file_name, "wb");   
-}   
-
-//read in the cue points from file in a list format   
-uint32_t * read_cue_file(char *fn) {   
-    FILE * cfh;   
-    uint32_t ms, n, count = 0;   
-    char sLine[13];   
-    unsigned int ts[5];   
-    float ts_f = 0;   
-
-    //instantiate the heap pointer   
-    uint32_t * p = (uint32_t *) malloc((uint32_t) 4);    
-
-    //try opening the cue file   
-    if ( (cfh = fopen(fn, "r")) != NULL) {   
-
-        //grab the first string   
-        n = fscanf(cfh, "%12s", sLine);   
-
-        //loop until there are no more strings   
-        while (n==1) {     
-
-            //reset milliseconds   
-            ms = 0;   
-
-            //check to see if in timestamp format   
-            if ((sLine[2]==':') && (sLine[5]==':') && (sLine[8]==':')) {   
-
-                //replace the colons with tabs   
-                sLine[2]='\t'; sLine[5]='\t'; sLine[8]='\t';   
-
-                //extract the timestamp values
-				sscanf(sLine, "%u %u %u %u", &ts[0], &ts[1], &ts[2], &ts[3]);
-
-                //calculate the timestamp as milliseconds   
-                ms = (ts[0]*3600 + ts[1]*60 + ts[2])*1000 + ts[3];   
-
-            } else {   
-
-                //just see if there is a decimal notation of milliseconds   
-                sscanf(sLine, "%f", &ts_f);   
-                ms = (uint32_t) ts_f * 1000;   
-
-            }   
-
-            //if a cuepoint was found on this line   
-            if (ms > 0) {   
-
-                //dynamically reallocate memory space as necessary   
-                if (count % CUE_BLOCK_SIZE == 0)   
-                    p = (uint32_t *) realloc(p, (uint32_t) ((count + CUE_BLOCK_SIZE)*sizeof(int)));   
-
-                //set the cue value   
-                *(p + count++) = ms;   
-
-            }   
-
-            //grab the next string   
-            n = fscanf(cfh, "%12s", sLine);   
-        }   
-    }   
-
-    //set the last cue point to max int   
-    *(p+count) = 0xFFFFFFFF;   
-
-    //return the pointer to the heap allocation   
-    return p;   
-}
+// This app splits an FLV file based on cue points located in a data file.   
+// It also separates the video from the audio.   
+// All the reverse_bytes action stems from the file format being big-endian   
+// and needing an integer to hold a little-endian version (for proper calculation).   
+
+#include "stdafx.h"
+#include "flvparser.h"
+#include <set>
+#include <string>
+
+//************ dump type
+#define DUMP_TYPE_DEFAULT 0
+#define DUMP_TYPE_XML 1
+#define DUMP_TYPE_AAC 2
+#define DUMP_TYPE_H264 3
+#define DUMP_TYPE_MP4 4
+
+//************ Constants
+#define CUE_BLOCK_SIZE 32
+#define FLAG_SEPARATE_AV 1
+#define FLAG_MMAP_INPUT 2
+#define FLAG_USE_INDEX 4
+#define FLAG_KEYFRAME_PREV 8
+#define FLAG_KEYFRAME_NEXT 16
+#define FLAG_KEYFRAME_ALIGN (FLAG_KEYFRAME_PREV | FLAG_KEYFRAME_NEXT)
+#define FLAG_ANNEXB 32
+#define FLAG_FMP4 64
+#define FLAG_PROBE 128
+#define FLAG_STATS 256
+#define FLAG_QUIET 512
+#define FLAG_BINDUMP 1024
+#define SLICE_ALL 0xFFFFFFFF
+#define META_SYNC_NAME "onMetaData keyframes table"
+
+//************ log record kinds, see format_log and format_xml
+#define LOG_TAG_HEAD 0
+#define LOG_AUDIO_HEADER 1
+#define LOG_VIDEO_HEADER 2
+#define LOG_VIDEO_FRAME 3
+#define LOG_META_HEADER 4
+#define LOG_XML_TAG 5
+#define LOG_XML_TAG_OPEN 6      //up to the body, a script tag's values follow from the producer
+
+//the parse loop's per-tag records and messages, compiled out below their FLV_LOG_LEVEL
+#if FLV_LOG_LEVEL >= 2
+#define LOG_TAG(log, ...) log_tag(log, __VA_ARGS__)
+#else
+#define LOG_TAG(log, ...) ((void)0)
+#endif
+#if FLV_LOG_LEVEL >= 1
+#define LOG_MESSAGE(log, ...) flv_writer_printf(flv_log_sync(log), __VA_ARGS__)
+#else
+#define LOG_MESSAGE(log, ...) ((void)0)
+#endif
+
+typedef struct __flv_script_data {
+    uint32_t tag_num;   //position of the script tag in the tag index
+    amf_script_data_list_t amf_script_data_lst;
+    const uint8_t *body;    //the AMF it was decoded from, mapped or in the arena
+    uint32_t body_len;
+} flv_script_data_t;
+
+typedef struct __flv_file {
+    flv_hdr_t flv_hdr;
+    flv_tag_index_t tag_index;
+    std::list<flv_script_data_t> script_data_lst;
+    flv_arena_t amf_arena;  //every script data tree of the file, freed in one go
+} flv_file_t;
+
+//********* per-job context, one for every file being cut
+typedef struct __flv_job {
+    char in_file[_MAX_PATH];
+    char cue_file[_MAX_PATH];
+    char project_name[_MAX_PATH];
+    uint32_t cur_num, flags, slice_num, jobs;
+    uint32_t segment;       //--segment length in ms, 0 cuts at the cue file's points
+    uint8_t audio_dump;     //output type of the split audio, TAG_TYPE_AUDIO or DUMP_TYPE_AAC
+    uint8_t video_dump;     //output type of the split video, TAG_TYPE_VIDEO, DUMP_TYPE_H264 or DUMP_TYPE_MP4
+    flv_filter_t filter;    //--filter, only the tags it keeps are written
+    flv_file_t flv_file;
+    uint64_t bytes_in;
+    double secs;
+    int status;
+} flv_job_t;
+
+//INFO_TEXT - entry i of one of the description tables below, "unknown" for a value past its end
+#define INFO_TEXT(table, i) (((size_t)(i) < sizeof(table) / sizeof(table[0])) ? table[i] : "unknown")
+
+//********* audio's info define
+static const char *audio_format_info[] = {
+    "Linear PCM, platform endian",
+    "ADPCM",
+    "MP3",
+    "Linear PCM, little endian",
+    "Nellymoser 16 kHz mono",
+    "Nellymoser 8 kHz mono",
+    "Nellymoser",
+    "G.711 A-law logarithmic PCM",
+    "G.711 mu-law logarithmic PCM",
+    "reserved",
+    "AAC",
+    "Speex",
+    "MP3 8 kHz",
+    "Device-specific sound"
+};
+
+static const char *audio_rate_info[] = {
+    "5.5 kHz",
+    "11 kHz",
+    "22 kHz",
+    "44 kHz"
+};
+
+static const char *audio_mono_streno_info[] = {
+    "Mono sound",
+    "Stereo sound"
+};
+
+static const char *audio_sample_size_info[] = {
+    "8-bit samples",
+    "16-bit samples"
+};
+
+//********* video's info define
+static const char *video_codec_info[] = {
+    "JPEG",
+    "Sorenson H.263",
+    "Screen video",
+    "On2 VP6",
+    "On2 VP6 with alpha channel",
+    "Screen video version 2",
+    "AVC"
+};
+
+static const char *video_frame_type[] = {
+    "key frame (for AVC, a seekable frame)",
+    "inter frame (for AVC, a non-seekable frame)",
+    "disposable inter frame (H.263 only)",
+    "generated key frame (reserved for server use only)",
+    "video info/command frame"
+};
+
+//********** local function prototypes
+flv_job_t *new_job(char *in_file, char *cue_file);
+int parse_options(flv_job_t *job, int argc, char *argv[]);
+void run_job(void *arg);
+int run_batch(char *manifest_file, uint32_t threads);
+flv_writer_t *open_output_file(flv_job_t *job, uint8_t tag_type);
+flv_sidecar_t *load_sidecar(flv_job_t *job, char *idx_name, uint32_t data_offset, flv_writer_t *parse_file);
+void snap_cues(flv_job_t *job, const flv_sidecar_t *sidecar, const uint32_t *cue, uint32_t cue_count,
+    std::vector<uint64_t> *cut_offset, flv_writer_t *parse_file);
+void add_segment(flv_job_t *job, flv_writer_t *parse_file, std::vector<flv_segment_entry_t> *segments,
+    flv_writer_t *fh, uint32_t start, uint32_t end, bool live);
+void write_playlist(flv_job_t *job, flv_writer_t *parse_file, const std::vector<flv_segment_entry_t> &segments, bool complete);
+void processfile(flv_job_t *job);
+void probefile(flv_job_t *job);
+void statsfile(flv_job_t *job);
+int undump_file(const char *dump_name, bool text);
+uint32_t *read_cue_file(char *cue_file_name);
+
+//********** log formatting
+void log_tag(flv_log_t *log, uint8_t kind, uint8_t tag_type, uint8_t av_hdr, uint32_t data_size, uint32_t timestamp,
+    uint8_t timestampex, uint32_t pre_tag_size);
+void format_log(flv_writer_t *parse_file, const flv_log_rec_t *rec);
+void format_xml(flv_writer_t *xml_file, const flv_log_rec_t *rec);
+
+//********** dump functions for amf's object
+void dump_flv_file(flv_job_t *job);
+void write_bin_dump(flv_job_t *job, flv_writer_t *parse_file);
+void xml_begin(flv_writer_t *xml_file, const char *name, const flv_hdr_t &flv_hdr, uint32_t tag_count);
+void xml_values(flv_writer_t *xml_file, const amf_script_data_list_t &amf_script_data_lst);
+void xml_end(flv_writer_t *xml_file);
+void dump_meta_data(amf_data_value_t *p_data_value, flv_writer_t *xml_file);
+
+//Defines the entry point for the console application.
+#ifdef _WIN32
+int _tmain(int argc, _TCHAR* argv[])
+#else
+int main(int argc, char* argv[])
+#endif
+{
+    if (argc < 3) {
+        printf("usage: %s flv_file cue|--segment=S [ --split ] [ --h264 ] [ --fmp4 ] [ --filter=F ] [ --quiet | --bindump ] [ --mmap ] [ --index ] [ --slice=N ] [ --keyframe=prev|next ] [ --jobs=N ]\n", argv[0]);
+        printf("       %s flv_file --probe|--stats [ --mmap ]\n", argv[0]);
+        printf("       %s --batch manifest [ --threads=N ]\n", argv[0]);
+        printf("       %s --undump dump_file [ --text ]\n", argv[0]);
+        printf("  cue_file - a file store some cue time point.\n");
+        printf("             e.g. : \n");
+        printf("             00:11:14:00\n");
+        printf("             02:05:04:38\n");
+        printf("             03:12:14:21\n");
+        printf("             03:04:14:13\n");
+        printf("             04:13:15:23\n");
+        printf("  segment  - no cue file, cut every S seconds on the next key frame and list the slices in flv_file.%s\n",
+            FLV_SEGMENT_PLAYLIST_EXT);
+        printf("  flv_file - a file, or a stream cut as it arrives: - (stdin), a named pipe or tcp://host:port\n");
+        printf("  split    - split audio and video into a stand-alone file, AAC as ADTS .aac, MP3 and others raw in .mp3\n");
+        printf("  h264     - split, with AVC video as an Annex-B .h264 stream (SPS/PPS ahead of every IDR)\n");
+        printf("             without it every slice gets its own onMetaData (duration, filesize, keyframes)\n");
+        printf("  fmp4     - remux AVC/AAC into fragmented .mp4 slices, one fragment per GOP, instead of .flv\n");
+        printf("  filter   - only write the tags matching every term of F, e.g. key for video key frames only:\n");
+        printf("             video, audio, meta (tag types), key, frame=N, codec=N, sound=N, from=S, to=S\n");
+        printf("  quiet    - leave every tag out of the log and skip the XML dump, messages are still logged\n");
+        printf("  bindump  - write the tags to a binary .%s instead of the log and the XML dump\n", FLV_DUMP_EXT);
+        printf("  mmap     - map the input file and write slices straight from the mapping\n");
+        printf("  index    - seek with the flv_file's .%s sidecar, writing it first if missing or stale\n", FLV_SIDECAR_EXT);
+        printf("  slice    - only write slice N (0 is the part before the first cue point)\n");
+        printf("             slice and keyframe seek with the onMetaData keyframes table when it checks out\n");
+        printf("  keyframe - start every slice on the key frame before (prev) or after (next) its cue point\n");
+        printf("  jobs     - write up to N slices at once (0 = one per core), not with --split\n");
+        printf("  probe    - print the codecs, picture size, duration and onMetaData as one JSON object, from the\n");
+        printf("             first tags and the last one only\n");
+        printf("  stats    - one pass over the tags, printing per-second bitrates, GOP lengths, timestamp jumps and\n");
+        printf("             A/V drift as one JSON object\n");
+        printf("  undump   - print a .%s as the XML dump, or with --text as the log's tag lines\n", FLV_DUMP_EXT);
+        printf("  batch    - run every \"flv_file cue|--segment=S [ options ]\" line of manifest on N threads (0 = one per core)\n");
+        exit(EXIT_FAILURE);
+    }
+    else if (strcmp(argv[1], "--batch") == 0) {
+        uint32_t threads = 0;
+        if (argc > 3 && strncmp(argv[3], "--threads=", 10) == 0) {
+            threads = (uint32_t)strtoul(argv[3] + 10, NULL, 10);
+        }
+        return (run_batch(argv[2], threads) == 0) ? 0 : EXIT_FAILURE;
+    }
+    else if (strcmp(argv[1], "--undump") == 0) {
+        return (undump_file(argv[2], argc > 3 && strcmp(argv[3], "--text") == 0) == 0) ? 0 : EXIT_FAILURE;
+    }
+    else {
+        //--segment=S stands in for the cue file
+        bool no_cue = (strncmp(argv[2], "--", 2) == 0);
+        flv_job_t *job = new_job(argv[1], no_cue ? (char *)"" : argv[2]);
+        if (parse_options(job, argc - (no_cue ? 2 : 3), argv + (no_cue ? 2 : 3)) != 0) {
+            delete job;
+            return EXIT_FAILURE;
+        }
+        //printf("sizeof(flv_hdr_t) = %d\n", sizeof(flv_hdr_t));
+        //printf("sizeof(flv_tag_t) = %d\n", sizeof(flv_tag_t));
+        processfile(job);
+        int status = job->status;
+        delete job;
+        return (status == 0) ? 0 : EXIT_FAILURE;
+    }
+    //getchar();
+}
+
+//new_job - a zeroed context for one input file
+flv_job_t *new_job(char *in_file, char *cue_file) {
+    flv_job_t *job = new flv_job_t();
+    strncpy(job->in_file, in_file, sizeof(job->in_file) - 1);
+    strncpy(job->cue_file, cue_file, sizeof(job->cue_file) - 1);
+    job->slice_num = SLICE_ALL;
+    job->jobs = 1;
+    job->audio_dump = TAG_TYPE_AUDIO;
+    job->video_dump = TAG_TYPE_VIDEO;
+    flv_filter_init(&job->filter);
+    flv_arena_init(&job->flv_file.amf_arena);
+
+    //project name, streams without a file name get one after their source
+    const char *ext = strstr(in_file, ".flv");
+    if (strcmp(in_file, FLV_IO_STDIN_NAME) == 0) {
+        strcpy(job->project_name, "stdin");
+    }
+    else if (strncmp(in_file, FLV_IO_TCP_PREFIX, strlen(FLV_IO_TCP_PREFIX)) == 0) {
+        snprintf(job->project_name, sizeof(job->project_name), "tcp_%s", in_file + strlen(FLV_IO_TCP_PREFIX));
+        std::replace(job->project_name, job->project_name + strlen(job->project_name), ':', '_');
+    }
+    else {
+        strncpy(job->project_name, in_file, (ext != NULL) ? (size_t)(ext - in_file) : sizeof(job->project_name) - 1);
+    }
+    return job;
+}
+
+//parse_options - apply the command line switches that follow flv_file and cue
+int parse_options(flv_job_t *job, int argc, char *argv[]) {
+    int unknown = 0;
+    for (int i = 0; i < argc; ++i) {
+        if (strstr(argv[i],"--split")!=NULL) {
+            job->flags |= FLAG_SEPARATE_AV;
+        }
+        else if (strstr(argv[i],"--mmap")!=NULL) {
+            job->flags |= FLAG_MMAP_INPUT;
+        }
+        else if (strstr(argv[i],"--index")!=NULL) {
+            job->flags |= FLAG_USE_INDEX;
+        }
+        else if (strncmp(argv[i],"--slice=",8)==0) {
+            job->slice_num = (uint32_t)strtoul(argv[i] + 8, NULL, 10);
+        }
+        else if (strcmp(argv[i],"--h264")==0) {
+            job->flags |= FLAG_SEPARATE_AV | FLAG_ANNEXB;
+        }
+        else if (strcmp(argv[i],"--probe")==0) {
+            job->flags |= FLAG_PROBE;
+        }
+        else if (strcmp(argv[i],"--quiet")==0) {
+            job->flags |= FLAG_QUIET;
+        }
+        else if (strcmp(argv[i],"--bindump")==0) {
+            job->flags |= FLAG_BINDUMP;
+        }
+        else if (strcmp(argv[i],"--stats")==0) {
+            job->flags |= FLAG_STATS;
+        }
+        else if (strcmp(argv[i],"--fmp4")==0) {
+            job->flags |= FLAG_FMP4;
+        }
+        else if (strcmp(argv[i],"--keyframe=prev")==0) {
+            job->flags |= FLAG_KEYFRAME_PREV;
+        }
+        else if (strcmp(argv[i],"--keyframe=next")==0) {
+            job->flags |= FLAG_KEYFRAME_NEXT;
+        }
+        else if (strncmp(argv[i],"--jobs=",7)==0) {
+            job->jobs = (uint32_t)strtoul(argv[i] + 7, NULL, 10);
+        }
+        else if (strncmp(argv[i],"--filter=",9)==0) {
+            if (flv_filter_parse(&job->filter, argv[i] + 9) != 0) {
+                fprintf(stderr, "Bad filter %s\n", argv[i] + 9);
+                ++unknown;
+            }
+        }
+        else if (strncmp(argv[i],"--segment=",10)==0) {
+            double secs = strtod(argv[i] + 10, NULL);
+            job->segment = (secs > 0) ? (uint32_t)(secs * 1000 + 0.5) : 0;
+        }
+        else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            ++unknown;
+        }
+    }
+    return unknown;
+}
+
+//run_job - pool task: cut one file and record how long it took
+void run_job(void *arg) {
+    flv_job_t *job = (flv_job_t *)arg;
+    struct stat st;
+    if (stat(job->in_file, &st) == 0) {
+        job->bytes_in = (uint64_t)st.st_size;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    processfile(job);
+    job->secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//run_batch - read "flv_file cue|--segment=S [ options ]" lines and cut them all on a work-stealing pool
+int run_batch(char *manifest_file, uint32_t threads) {
+    FILE *mfh = fopen(manifest_file, "r");
+    if (mfh == NULL) {
+        fprintf(stderr, "Failed to open %s\n", manifest_file);
+        return -1;
+    }
+
+    std::vector<flv_job_t *> jobs;
+    std::set<std::string> projects;
+    int rejected = 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), mfh) != NULL) {
+        //whitespace separated tokens, blank lines and # comments are skipped
+        std::vector<char *> tokens;
+        for (char *tok = strtok(line, " \t\r\n"); tok != NULL && tok[0] != '#'; tok = strtok(NULL, " \t\r\n")) {
+            tokens.push_back(tok);
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+        if (tokens.size() < 2) {
+            fprintf(stderr, "%s: skipping \"%s\", no cue file\n", manifest_file, tokens[0]);
+            continue;
+        }
+        size_t first_option = (strncmp(tokens[1], "--", 2) == 0) ? 1 : 2;
+        flv_job_t *job = new_job(tokens[0], (first_option == 1) ? (char *)"" : tokens[1]);
+        if (parse_options(job, (int)(tokens.size() - first_option), &tokens[first_option]) != 0) {
+            fprintf(stderr, "%s: skipping %s, unknown option\n", manifest_file, tokens[0]);
+            delete job;
+            ++rejected;
+            continue;
+        }
+
+        //jobs writing the same <project>_N files would overwrite each other's slices, logs and dumps
+        bool writes_files = !(job->flags & (FLAG_PROBE | FLAG_STATS));
+        if (writes_files && !projects.insert(job->project_name).second) {
+            fprintf(stderr, "%s: skipping %s, another job already writes %s_N files\n", manifest_file, tokens[0],
+                job->project_name);
+            delete job;
+            ++rejected;
+            continue;
+        }
+        jobs.push_back(job);
+    }
+    fclose(mfh);
+    if (jobs.empty()) {
+        return (rejected == 0) ? 0 : -1;
+    }
+
+    if (threads == 0) {
+        threads = flv_pool_default_threads();
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    flv_pool_run((void **)&jobs[0], jobs.size(), run_job, threads);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    //per-job and aggregate throughput
+    uint64_t total = 0;
+    int failed = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        flv_job_t *job = jobs[i];
+        double mb = job->bytes_in / (1024.0 * 1024.0);
+        printf("job %u: %s %.1f MB in %.3f s (%.1f MB/s)%s\n", (uint32_t)i, job->in_file, mb, job->secs,
+            (job->secs > 0) ? mb / job->secs : 0.0, (job->status == 0) ? "" : " FAILED");
+        total += job->bytes_in;
+        failed += (job->status != 0);
+        delete job;
+    }
+    printf("batch: %u jobs, %.1f MB in %.3f s on %u threads (%.1f MB/s), %d failed, %d skipped\n", (uint32_t)jobs.size(),
+        total / (1024.0 * 1024.0), wall, threads, (wall > 0) ? total / (1024.0 * 1024.0) / wall : 0.0, failed, rejected);
+    return (failed == 0 && rejected == 0) ? 0 : -1;
+}
+
+//processfile is the central function   
+void processfile(flv_job_t *job){   
+
+    if (job->flags & FLAG_PROBE) {
+        probefile(job);
+        return;
+    }
+    if (job->flags & FLAG_STATS) {
+        statsfile(job);
+        return;
+    }
+
+    char *in_file = job->in_file, *cue_file = job->cue_file;
+
+    flv_reader_t *ifh = NULL;
+    flv_iter_t iter;
+    flv_tag_view_t view;
+    flv_writer_t *vfh = NULL, *afh = NULL, *parse_file = NULL;
+    flv_hdr_t &flv_hdr = job->flv_file.flv_hdr;
+    flv_tag_index_t &tag_index = job->flv_file.tag_index;
+    flv_tag_t flv_tag;
+    uint32_t pre_tag_size = 0, tag_num = 0;
+    int64_t tag_offset = 0;
+    uint32_t *cue, cue_count = 0, ts = 0, ts_offset = 0;
+    uint32_t ptag = DUMP_TYPE_DEFAULT, timestamp = 0, datasize = 0, data_offset = 0;
+    uint8_t be_size[4];
+    char idx_name[_MAX_PATH + _MAX_EXT] = { 0 };
+    flv_sidecar_t *sidecar = NULL;
+    const char *sync_name = idx_name;
+    bool write_sidecar = false, from_meta = false, rewrite_meta = false;
+    std::vector<uint64_t> cut_offset;
+    flv_slice_meta_t slice_meta = flv_slice_meta_t();
+    flv_tag_index_t plan_index;
+    std::vector<flv_slice_t> plan;
+    size_t plan_pos = 0;
+    flv_segmenter_t segmenter;
+    std::vector<flv_segment_entry_t> segments;
+    uint32_t segment_start = 0;
+    bool segment_walk = false, segment_audio = false;
+    flv_aac_config_t aac_config = flv_aac_config_t();
+    flv_avc_config_t avc_config = flv_avc_config_t();
+    uint32_t aac_dropped = 0, avc_dropped = 0, mp4_skipped = 0, filtered = 0;
+    bool keep = true, tag_log = !(job->flags & (FLAG_QUIET | FLAG_BINDUMP));
+    flv_log_t log;
+    flv_tag_index_t kept_index;
+    flv_mp4_t mp4;
+    flv_mp4_init(&mp4);
+
+    //open the input file   
+    if ((ifh = flv_reader_open(in_file, (job->flags & FLAG_MMAP_INPUT) ? FLV_IO_MODE_MMAP : FLV_IO_MODE_BUFFERED)) == NULL) {   
+        fprintf(stderr, "Failed to open %s\n", in_file);   
+        job->status = -1;
+        return;   
+    }
+    if ((parse_file = open_output_file(job, ptag)) == NULL) {
+        flv_reader_close(ifh);
+        job->status = -1;
+        return;
+    }
+    flv_log_init(&log, parse_file, format_log);
+
+    if (job->segment) {
+        flv_writer_printf(parse_file, "Processing [%s] in %u.%03u s segments\n", in_file, job->segment / 1000, job->segment % 1000);
+    }
+    else {
+        flv_writer_printf(parse_file, "Processing [%s] with cue file [%s]\n", in_file, cue_file);
+    }
+
+    //a stream is cut as it arrives, nothing may look ahead or go back
+    if (ifh->stream) {
+        if ((job->flags & (FLAG_USE_INDEX | FLAG_KEYFRAME_ALIGN)) || job->jobs != 1) {
+            flv_writer_printf(parse_file, "%s is a stream, --index, --keyframe and --jobs are ignored\n", in_file);
+        }
+        job->flags &= ~(FLAG_USE_INDEX | FLAG_KEYFRAME_ALIGN);
+        job->jobs = 1;
+    }
+
+    //segments are cut on key frames already and only known once the tags go by
+    if (job->segment && (job->flags & (FLAG_USE_INDEX | FLAG_KEYFRAME_ALIGN))) {
+        flv_writer_printf(parse_file, "Cutting segments, --index and --keyframe are ignored\n");
+        job->flags &= ~(FLAG_USE_INDEX | FLAG_KEYFRAME_ALIGN);
+    }
+
+    //fragmented MP4 slices hold audio and video together
+    if ((job->flags & FLAG_FMP4) && (job->flags & (FLAG_SEPARATE_AV | FLAG_ANNEXB))) {
+        flv_writer_printf(parse_file, "Writing fragmented MP4, --split and --h264 are ignored\n");
+        job->flags &= ~(FLAG_SEPARATE_AV | FLAG_ANNEXB);
+    }
+
+    //a filtered slice is no longer one byte range of the input
+    if (job->filter.active && job->jobs != 1) {
+        flv_writer_printf(parse_file, "Filtering tags, --jobs is ignored\n");
+        job->jobs = 1;
+    }
+
+    //build cue array, segments leave it empty
+    if (job->segment) {
+        cue = (uint32_t *)malloc(sizeof(uint32_t));
+        cue[0] = 0xFFFFFFFF;
+    }
+    else {
+        cue = read_cue_file(cue_file);
+    }
+    while (cue[cue_count] != 0xFFFFFFFF) {
+        ++cue_count;
+    }
+    if (!job->segment && job->slice_num != SLICE_ALL && job->slice_num > cue_count) {
+        flv_writer_printf(parse_file, "No slice %u, the cue file only makes %u\n", job->slice_num, cue_count + 1);
+        job->slice_num = cue_count + 1;
+    }
+
+    //capture the FLV file header, the iterator then stands before the first tag
+    if (flv_iter_init(&iter, ifh, 0) != 0) {
+        fprintf(stderr, "%s is not an FLV file\n", in_file);
+        flv_writer_close(parse_file);
+        flv_reader_close(ifh);
+        free(cue);
+        job->status = -1;
+        return;
+    }
+    flv_hdr = iter.flv_hdr;
+    datasize = data_offset = iter.data_offset;
+    flv_segment_init(&segmenter, job->segment, (flv_hdr.flags & 0x01) == 0);
+    segment_audio = (job->flags & FLAG_SEPARATE_AV) && segmenter.audio_only;
+
+    //whole slices carry their own onMetaData in place of the source's, filtered or not
+    rewrite_meta = !(job->flags & (FLAG_SEPARATE_AV | FLAG_FMP4)) && !ifh->stream && flv_slice_meta_load(ifh, &slice_meta) == 0;
+
+    if (job->flags & (FLAG_USE_INDEX | FLAG_KEYFRAME_ALIGN)) {
+        sprintf(idx_name, "%s.%s", job->project_name, FLV_SIDECAR_EXT);
+        sidecar = flv_sidecar_open(idx_name, in_file);
+    }
+
+    //short of a sidecar file, an onMetaData keyframes table seeks without indexing anything
+    if (sidecar == NULL && !(job->flags & FLAG_USE_INDEX) && !ifh->stream && !job->segment
+        && ((job->flags & FLAG_KEYFRAME_ALIGN) || (job->slice_num != SLICE_ALL && job->slice_num > 0))) {
+        sidecar = flv_sidecar_from_meta(ifh);
+        if (sidecar != NULL) {
+            from_meta = true;
+            sync_name = META_SYNC_NAME;
+            flv_writer_printf(parse_file, "Using the %s, %u entries\n", sync_name, sidecar->hdr->entry_count);
+        }
+    }
+
+    if (job->flags & FLAG_KEYFRAME_ALIGN) {
+        //snap every cue point to a key frame, the slice then starts at that tag's offset
+        if (sidecar == NULL) {
+            sidecar = load_sidecar(job, idx_name, data_offset, parse_file);
+        }
+        if (sidecar != NULL && from_meta) {
+            //every key frame a slice starts on has to be one, else the file gets indexed after all
+            snap_cues(job, sidecar, cue, cue_count, &cut_offset, NULL);
+            for (size_t i = 0; i < cut_offset.size() && from_meta; ++i) {
+                from_meta = (cut_offset[i] == UINT64_MAX || flv_sidecar_check(ifh, cut_offset[i], NULL) == 0);
+            }
+            if (!from_meta) {
+                flv_writer_printf(parse_file, "The %s doesn't match the file, indexing it\n", sync_name);
+                flv_sidecar_close(sidecar);
+                sidecar = load_sidecar(job, idx_name, data_offset, parse_file);
+                sync_name = idx_name;
+            }
+        }
+        if (sidecar == NULL) {
+            //without key frame positions every cut would be dropped and the file written whole
+            fprintf(stderr, "Failed to index %s, --keyframe can't place the cue points\n", in_file);
+            flv_writer_printf(parse_file, "Failed to index %s, --keyframe can't place the cue points\n", in_file);
+            flv_slice_meta_free(&slice_meta);
+            flv_writer_close(parse_file);
+            flv_reader_close(ifh);
+            free(cue);
+            job->status = -1;
+            return;
+        }
+        snap_cues(job, sidecar, cue, cue_count, &cut_offset, parse_file);
+
+        //the requested slice starts exactly on its key frame
+        if (job->slice_num != SLICE_ALL && job->slice_num > 0 && cut_offset[job->slice_num - 1] != UINT64_MAX
+            && flv_iter_seek(&iter, cut_offset[job->slice_num - 1]) == 0) {
+            job->cur_num = job->slice_num - 1;
+            flv_writer_printf(parse_file, "Seeking to %llu with %s\n",
+                (unsigned long long)cut_offset[job->slice_num - 1], sync_name);
+        }
+    }
+    else if (job->flags & FLAG_USE_INDEX) {
+        //with a valid sidecar, jump to the sync point the requested slice starts from
+        write_sidecar = (sidecar == NULL);
+        if (sidecar != NULL && job->slice_num != SLICE_ALL && job->slice_num > 0) {
+            const flv_sidecar_entry_t *entry = flv_sidecar_find(sidecar, cue[job->slice_num - 1]);
+            if (entry != NULL && flv_iter_seek(&iter, entry->offset) == 0) {
+                job->cur_num = job->slice_num - 1;
+                flv_writer_printf(parse_file, "Seeking to %llu (ts %u) with %s\n",
+                    (unsigned long long)entry->offset, entry->timestamp, idx_name);
+            }
+        }
+    }
+    else if (from_meta && job->slice_num != SLICE_ALL && job->slice_num > 0) {
+        //the table's key frame must really be one and not start after the cue, else walk from the top
+        const flv_sidecar_entry_t *entry = flv_sidecar_find(sidecar, cue[job->slice_num - 1]);
+        uint32_t key_ts = 0;
+        if (entry != NULL && flv_sidecar_check(ifh, entry->offset, &key_ts) == 0 && key_ts <= cue[job->slice_num - 1]
+            && flv_iter_seek(&iter, entry->offset) == 0) {
+            job->cur_num = job->slice_num - 1;
+            flv_writer_printf(parse_file, "Seeking to %llu (ts %u) with %s\n",
+                (unsigned long long)entry->offset, key_ts, sync_name);
+        }
+        else if (entry != NULL) {
+            flv_writer_printf(parse_file, "The %s doesn't match the file, walking it\n", sync_name);
+        }
+    }
+
+    flv_writer_printf(parse_file, "================= flv.header(: %lu) =====================\n", sizeof(flv_hdr_t));
+    flv_writer_printf(parse_file, "flv.header.signature[3] = '%c' '%c' '%c'\n", flv_hdr.signature[0], flv_hdr.signature[1], flv_hdr.signature[2]);
+    flv_writer_printf(parse_file, "flv.header.version = 0x%X\n", flv_hdr.version);
+    flv_writer_printf(parse_file, "flv.header.flags = 0x%X\n", flv_hdr.flags);
+    flv_writer_printf(parse_file, "flv.header.flags.has_audio = %d\n", (flv_hdr.flags & 0x04) != 0);
+    flv_writer_printf(parse_file, "flv.header.flags.has_video = %d\n", (flv_hdr.flags & 0x01) != 0);
+    flv_writer_printf(parse_file, "flv.header.dataoffset = %u\n", datasize);
+
+#ifndef _WIN32
+    bool parallel = (job->jobs != 1) && !(job->flags & (FLAG_SEPARATE_AV | FLAG_FMP4));
+#else
+    bool parallel = false;
+#endif
+    if (parallel) {
+        //index the tag headers, then every slice is an independent byte range for the workers
+        flv_iter_rewind(&iter);
+        flv_index_scan(&iter, &tag_index);
+        if (iter.resyncs != 0) {
+            //damaged ranges have to be dropped tag by tag
+            flv_writer_printf(parse_file, "%s is damaged, writing the slices one tag at a time\n", in_file);
+            flv_index_clear(&tag_index);
+            flv_iter_rewind(&iter);
+            parallel = false;
+        }
+    }
+    if (parallel) {
+        std::vector<flv_slice_t> slices, wanted;
+        if (job->segment) {
+            flv_segment_plan(&segmenter, &tag_index, &cut_offset);
+        }
+        flv_slice_plan(&tag_index, cue, cut_offset, &slices);
+        for (size_t i = 0; i < slices.size(); ++i) {
+            if (job->slice_num == SLICE_ALL || slices[i].num == job->slice_num) {
+                wanted.push_back(slices[i]);
+                if (rewrite_meta) {
+                    flv_slice_meta_build(&slice_meta, &tag_index, &wanted.back());
+                }
+            }
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int ret = flv_slices_write_parallel(in_file, &flv_hdr, wanted, job->project_name, job->jobs);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t total = 0;
+        for (size_t i = 0; i < wanted.size(); ++i) {
+            flv_writer_printf(parse_file, "slice %u: tags %u-%u, bytes %llu-%llu, %s\n", wanted[i].num,
+                wanted[i].first_tag, wanted[i].end_tag - 1, (unsigned long long)wanted[i].begin,
+                (unsigned long long)wanted[i].end, (wanted[i].status == 0) ? "ok" : "failed");
+            total += wanted[i].bytes_written;
+            if (job->segment) {
+                //a segment lasts until the next one starts, the last one until its last tag
+                flv_segment_entry_t entry;
+                entry.num = wanted[i].num;
+                entry.start = tag_index.timestamp[wanted[i].first_tag];
+                entry.duration = ((wanted[i].end_tag < flv_index_count(&tag_index)) ? tag_index.timestamp[wanted[i].end_tag]
+                    : tag_index.timestamp[wanted[i].end_tag - 1]) - entry.start;
+                entry.bytes = wanted[i].bytes_written;
+                segments.push_back(entry);
+            }
+        }
+        flv_writer_printf(parse_file, "wrote %u slices, %llu bytes in %.3f s (%.1f MB/s)%s\n",
+            (uint32_t)wanted.size(), (unsigned long long)total, secs,
+            (secs > 0) ? total / secs / (1024 * 1024) : 0.0, (ret == 0) ? "" : ", with errors");
+        job->cur_num = slices.empty() ? 0 : slices.back().num;
+        if (ret != 0) {
+            job->status = -1;
+        }
+    }
+    else if (rewrite_meta) {
+        //the slices' tags have to be known up front to size and fill in their onMetaData
+        flv_iter_t plan_iter = iter;
+        if (job->segment) {
+            flv_index_scan(&plan_iter, &plan_index);
+            flv_segment_plan(&segmenter, &plan_index, &cut_offset);
+            flv_slice_plan(&plan_index, cue, cut_offset, &plan);
+        }
+        else {
+            flv_slice_scan(&plan_iter, job->cur_num, job->slice_num, cue, cut_offset, &plan_index, &plan);
+        }
+    }
+    else if (job->segment) {
+        //nothing planned ahead, every tag is looked at for a cut as it goes by
+        segment_walk = true;
+        cut_offset.push_back(UINT64_MAX);
+    }
+    if (rewrite_meta) {
+        flv_writer_printf(parse_file, "Rewriting onMetaData for every slice\n");
+    }
+
+    flv_writer_printf(parse_file, "\n================= flv.tag =====================\n");
+
+    //the tags are described by a formatter thread while this one cuts
+    if (!parallel && FLV_LOG_LEVEL >= 2 && tag_log) {
+        flv_log_start(&log);
+    }
+
+    //process each tag in the file, unless the workers already wrote the slices
+    while (!parallel) {
+
+        //pull the next tag with its PreviousTagSize, stop at the end of file
+        if (!flv_iter_next(&iter, &view)) {
+            break;
+        }
+        if (view.skipped != 0) {
+            LOG_MESSAGE(&log, "Lost sync, skipped %llu damaged bytes to the tag at %lld\n",
+                (unsigned long long)view.skipped, (long long)view.offset);
+        }
+        pre_tag_size = view.pre_tag_size;
+
+        //tags the filter drops are stepped over without copying their body and left out of the log
+        keep = !job->filter.active || flv_filter_match(&job->filter, view.tag_type, (view.body_len > 0) ? view.body[0] : 0, view.timestamp);
+        tag_offset = view.offset;
+        flv_tag = *view.tag;
+
+        //set the tag value to select on   
+        ptag = view.tag_type;   
+
+        //if we are not separating AV, process the audio like video   
+        if (!(job->flags & FLAG_SEPARATE_AV)) {
+            ptag = TAG_TYPE_VIDEO;
+        }
+
+        //if we've exceed the cuepoint then close output files and select next cuepoint
+        timestamp = view.timestamp;
+        datasize = view.data_size;
+
+        //index the tag from its first body bytes (audio/video header, AVC/AAC packet type), a stream keeps no index
+        if (!ifh->stream) {
+            tag_num = flv_index_append(&tag_index, tag_offset, pre_tag_size, view.tag_type,
+                datasize, timestamp, view.body, view.body_len);
+        }
+
+        if (keep && tag_log) {
+            LOG_TAG(&log, LOG_TAG_HEAD, view.tag_type, 0, datasize, timestamp, flv_tag.timestampex, pre_tag_size);
+        }
+
+        //a segment cut becomes the offset the next slice starts at
+        if (segment_walk && flv_segment_cut(&segmenter, flv_index_flags(view.tag_type, view.body, view.body_len), timestamp)) {
+            cut_offset.back() = (uint64_t)tag_offset;
+            cut_offset.push_back(UINT64_MAX);
+        }
+        if (iter.count == 1) {
+            segment_start = timestamp;
+        }
+
+        if (!cut_offset.empty() ? (uint64_t)tag_offset >= cut_offset[job->cur_num] : timestamp > cue[job->cur_num]) {
+
+            //the slice's last fragment lasts until this tag
+            flv_mp4_close(&mp4, timestamp);
+
+            //list the segment that ends here, by its audio file when there is no video one
+            if (job->segment && (segment_audio ? afh : vfh) != NULL) {
+                add_segment(job, flv_log_sync(&log), &segments, segment_audio ? afh : vfh, segment_start, timestamp, ifh->stream);
+            }
+            segment_start = timestamp;
+
+            //close any audio file and designated closed with NULL   
+            if (afh != NULL) {
+                flv_writer_close(afh);
+                afh = NULL;
+            }
+
+            //close any video file and designated closed with NULL   
+            if (vfh != NULL) {
+                flv_writer_close(vfh);
+                vfh = NULL;
+            }
+
+            //increment the current slide   
+            job->cur_num++;   
+
+            //cue points snapped onto the same key frame leave their slice empty
+            while (!cut_offset.empty() && (uint64_t)tag_offset >= cut_offset[job->cur_num]) {
+                job->cur_num++;
+            }
+
+            //provide feedback to the user   
+            LOG_MESSAGE(&log, "Processing slide %i...\n", job->cur_num);
+        }   
+
+        //only the requested slice is written, stop once it is complete unless the sidecar needs the rest
+        if (job->slice_num != SLICE_ALL && job->cur_num != job->slice_num) {
+            if (job->cur_num > job->slice_num && !write_sidecar) {
+                break;
+            }
+            //the iterator steps over the body
+            continue;
+        }
+        if (!keep) {
+            ++filtered;
+            continue;
+        }
+
+        //a tag the end of the file cuts short isn't written, as the parallel writer leaves it out
+        if (view.cut_off) {
+            LOG_MESSAGE(&log, "The file ends inside the tag at %lld, it is left out\n", (long long)tag_offset);
+            continue;
+        }
+
+        //process tag by type   
+        switch (ptag) {   
+
+        case TAG_TYPE_AUDIO:  //we only process like this if we are separating audio into an elementary stream file
+            {
+                uint8_t flv_audio_header = 0;
+                flv_reader_read(ifh, &flv_audio_header, sizeof(flv_audio_header));
+                if (tag_log) {
+                    LOG_TAG(&log, LOG_AUDIO_HEADER, TAG_TYPE_AUDIO, flv_audio_header, datasize, timestamp, flv_tag.timestampex, pre_tag_size);
+                }
+                // decoce audio tag header.
+                short sound_format = (flv_audio_header >> 4) & 0x0F;
+
+                //if the output file hasn't been opened, open it: ADTS .aac for AAC, the raw payload in .mp3 otherwise
+                if (afh == NULL) {
+                    job->audio_dump = (sound_format == FLV_AUDIO_TAG_SOUND_FORMAT_AAC) ? DUMP_TYPE_AAC : TAG_TYPE_AUDIO;
+                    if ((afh = open_output_file(job, job->audio_dump)) == NULL)
+                    {
+                        LOG_MESSAGE(&log, "open file fail, err = %s\n",
+                            strerror(errno));
+                        break;
+                    }
+                }
+
+                if (sound_format == FLV_AUDIO_TAG_SOUND_FORMAT_AAC && datasize >= 2) {
+                    uint8_t aac_packet_type = 0;
+                    flv_reader_read(ifh, &aac_packet_type, sizeof(aac_packet_type));
+                    uint32_t payload_len = datasize - 2;
+                    if (aac_packet_type == 0) {
+                        //the sequence header sets up every frame's ADTS header
+                        const uint8_t *asc = flv_reader_peek(ifh, payload_len);
+                        if (asc != NULL && flv_aac_parse_config(asc, payload_len, &aac_config) == 0) {
+                            LOG_MESSAGE(&log, "AudioSpecificConfig: object type %u, frequency index %u, channels %u\n",
+                                aac_config.object_type, aac_config.freq_index, aac_config.channels);
+                        }
+                        else {
+                            LOG_MESSAGE(&log, "AudioSpecificConfig not supported by ADTS, AAC frames are dropped\n");
+                        }
+                    }
+                    else if (aac_config.valid && payload_len + FLV_ADTS_HEADER_SIZE <= FLV_ADTS_MAX_FRAME) {
+                        //the header goes into the writer's block, then the frame in one block copy
+                        flv_adts_header(&aac_config, payload_len, flv_writer_reserve(afh, FLV_ADTS_HEADER_SIZE));
+                        flv_copy(ifh, afh, payload_len);
+                    }
+                    else {
+                        ++aac_dropped;
+                    }
+                }
+                else {
+                    //dump the audio data to the output file in one block copy
+                    flv_copy(ifh, afh, datasize - 1);
+                }
+                if (ifh->stream) {
+                    flv_writer_flush(afh);
+                }
+            }
+
+            break;   
+
+        case TAG_TYPE_VIDEO:
+            {
+                //audio and script data come this way too unless split, each described as what it is
+                if (tag_log && view.tag_type == TAG_TYPE_AUDIO) {
+                    LOG_TAG(&log, LOG_AUDIO_HEADER, TAG_TYPE_AUDIO, (view.body_len > 0) ? view.body[0] : 0, datasize, timestamp,
+                        flv_tag.timestampex, pre_tag_size);
+                }
+                else if (tag_log) {
+                    LOG_TAG(&log, (view.tag_type == TAG_TYPE_VIDEO) ? LOG_VIDEO_HEADER : LOG_META_HEADER, view.tag_type, 0, datasize,
+                        timestamp, flv_tag.timestampex, pre_tag_size);
+                }
+
+                //with --fmp4 every tag goes to the slice's .mp4, AVC and AAC become samples of its two tracks
+                if (job->flags & FLAG_FMP4) {
+                    if (vfh == NULL) {
+                        job->video_dump = DUMP_TYPE_MP4;
+                        if ((vfh = open_output_file(job, job->video_dump)) == NULL) {
+                            LOG_MESSAGE(&log, "open file fail, err = %s\n",
+                                strerror(errno));
+                            break;
+                        }
+                        ts_offset = timestamp;
+                        flv_mp4_open(&mp4, vfh, ts_offset);
+                    }
+
+                    //the codec headers: 5 bytes ahead of AVC data, 2 ahead of AAC
+                    uint8_t codec_hdr[5];
+                    uint32_t hdr_len = 0;
+                    if (view.tag_type == TAG_TYPE_VIDEO && datasize >= 5 && view.body_len > 0
+                        && (view.body[0] & 0x0F) == FLV_VIDEO_TAG_CODEC_AVC) {
+                        hdr_len = 5;
+                    }
+                    else if (view.tag_type == TAG_TYPE_AUDIO && datasize >= 2 && view.body_len > 0
+                        && ((view.body[0] >> 4) & 0x0F) == FLV_AUDIO_TAG_SOUND_FORMAT_AAC) {
+                        hdr_len = 2;
+                    }
+                    else {
+                        //script data has no place in the tracks, other codecs aren't remuxed
+                        if (view.tag_type != TAG_TYPE_META) {
+                            ++mp4_skipped;
+                        }
+                        break;
+                    }
+                    flv_reader_read(ifh, codec_hdr, hdr_len);
+                    uint32_t payload_len = datasize - hdr_len;
+                    if (codec_hdr[1] == 0) {
+                        //a sequence header becomes the track's sample description
+                        const uint8_t *config = flv_reader_peek(ifh, payload_len);
+                        if (hdr_len == 5 && flv_mp4_set_avc_config(&mp4, config, payload_len) == 0) {
+                            LOG_MESSAGE(&log, "Video track: AVC %ux%u\n", mp4.video.width, mp4.video.height);
+                        }
+                        else if (hdr_len == 2 && flv_mp4_set_aac_config(&mp4, config, payload_len) == 0) {
+                            LOG_MESSAGE(&log, "Audio track: AAC %u Hz, %u channels\n", mp4.audio.sample_rate, mp4.audio.channels);
+                        }
+                        else {
+                            LOG_MESSAGE(&log, "Bad %s sequence header, its frames are dropped\n", (hdr_len == 5) ? "AVC" : "AAC");
+                        }
+                    }
+                    else if (codec_hdr[1] == 1) {
+                        //AVC's composition time is a signed 24 bit offset, AAC frames are all sync samples
+                        int32_t cts = 0;
+                        bool key = true;
+                        if (hdr_len == 5) {
+                            cts = (int32_t)(flv_get_be24(codec_hdr + 2) << 8) >> 8;
+                            key = ((codec_hdr[0] >> 4) & 0x0F) == 1;
+                        }
+                        if (flv_mp4_add_sample(&mp4, ifh, view.tag_type, timestamp, cts, key, payload_len) != 0) {
+                            LOG_MESSAGE(&log, "Failed to write a fragment of %s_%u.mp4\n", job->project_name, job->cur_num);
+                        }
+                    }
+                    break;
+                }
+
+                //AVC goes into an Annex-B .h264 file with --h264, unless the slice's file is an .flv already
+                if ((job->flags & FLAG_ANNEXB) && datasize >= 5 && view.body_len > 0
+                    && (view.body[0] & 0x0F) == FLV_VIDEO_TAG_CODEC_AVC && (vfh == NULL || job->video_dump == DUMP_TYPE_H264)) {
+                    if (vfh == NULL) {
+                        job->video_dump = DUMP_TYPE_H264;
+                        if ((vfh = open_output_file(job, job->video_dump)) == NULL) {
+                            LOG_MESSAGE(&log, "open file fail, err = %s\n",
+                                strerror(errno));
+                            break;
+                        }
+                        ts_offset = timestamp;
+                    }
+
+                    //frame type and codec, AVCPacketType, composition time, then the payload
+                    uint8_t avc_hdr[5];
+                    flv_reader_read(ifh, avc_hdr, sizeof(avc_hdr));
+                    uint32_t payload_len = datasize - sizeof(avc_hdr);
+                    if (avc_hdr[1] == 0) {
+                        //the sequence header holds the SPS and PPS to put ahead of the IDR pictures
+                        const uint8_t *record = flv_reader_peek(ifh, payload_len);
+                        if (record != NULL && flv_avc_parse_config(record, payload_len, &avc_config) == 0) {
+                            LOG_MESSAGE(&log, "AVCDecoderConfigurationRecord: profile %u, level %u, %u byte NALU lengths, %u SPS, %u PPS\n",
+                                avc_config.profile, avc_config.level, avc_config.length_size, avc_config.sps_count, avc_config.pps_count);
+                        }
+                        else {
+                            LOG_MESSAGE(&log, "Bad AVCDecoderConfigurationRecord, AVC frames are dropped\n");
+                        }
+                    }
+                    else if (avc_hdr[1] == 1 && avc_config.valid) {
+                        if (flv_avc_write_annexb(ifh, vfh, &avc_config, payload_len) != 0) {
+                            LOG_MESSAGE(&log, "Damaged NAL unit lengths in the frame at %lld\n", (long long)tag_offset);
+                        }
+                    }
+                    else if (avc_hdr[1] == 1) {
+                        ++avc_dropped;
+                    }
+                    if (ifh->stream) {
+                        flv_writer_flush(vfh);
+                    }
+                    break;
+                }
+
+                //if the output file hasn't been opened, open it.   
+                if (vfh == NULL) {   
+
+                    //get the new video output file pointer   
+                    if ((vfh = open_output_file(job, ptag)) == NULL) {
+                        LOG_MESSAGE(&log, "open file fail, err = %s\n",
+                            strerror(errno));
+                        break;
+                    }
+
+                    //record the timestamp offset for this slice
+                    ts_offset = timestamp;
+
+                    //write the flv header (reuse the original file's hdr, less the dropped types) and first pts   
+                    flv_hdr_t out_hdr;
+                    flv_slice_hdr(&out_hdr, &flv_hdr, flv_filter_hdr_flags(&job->filter, flv_hdr.flags));
+                    flv_writer_write(vfh, &out_hdr, sizeof(out_hdr));   
+                    flv_put_be32(be_size, 0);
+                    flv_writer_write(vfh, be_size, sizeof(be_size));   
+
+                    //then the slice's own onMetaData, planned ahead of the walk
+                    while (plan_pos < plan.size() && plan[plan_pos].num < job->cur_num) {
+                        ++plan_pos;
+                    }
+                    if (plan_pos < plan.size() && plan[plan_pos].num == job->cur_num && job->filter.active) {
+                        //described by the tags the filter keeps, the slice starts at the first of them
+                        flv_slice_t kept = plan[plan_pos];
+                        kept.first_tag = 0;
+                        kept.end_tag = flv_filter_index(&job->filter, &plan_index, plan[plan_pos].first_tag, plan[plan_pos].end_tag, &kept_index);
+                        kept.ts_offset = ts_offset;
+                        flv_slice_meta_build(&slice_meta, &kept_index, &kept);
+                        flv_writer_write(vfh, &kept.meta_tag[0], (uint32_t)kept.meta_tag.size());
+                    }
+                    else if (plan_pos < plan.size() && plan[plan_pos].num == job->cur_num) {
+                        flv_slice_meta_build(&slice_meta, &plan_index, &plan[plan_pos]);
+                        flv_writer_write(vfh, &plan[plan_pos].meta_tag[0], (uint32_t)plan[plan_pos].meta_tag.size());
+                        std::vector<uint8_t>().swap(plan[plan_pos].meta_tag);
+                    }
+                }   
+
+                //the source's onMetaData has been replaced
+                if (rewrite_meta && (uint64_t)tag_offset == slice_meta.offset) {
+                    break;
+                }
+
+                //offset the timestamp in a copy of the tag   
+                flv_tag_t out_tag = flv_tag;
+                ts = (timestamp > ts_offset) ? timestamp - ts_offset : 0;
+                flv_put_be24(out_tag.timestamp, ts & 0x00FFFFFF);
+                out_tag.timestampex = (uint8_t)(ts >> 24);
+
+                //write tag to output file   
+                flv_writer_write(vfh, &out_tag, sizeof(out_tag));
+
+                //describe the video's header
+                if (tag_log && view.tag_type == TAG_TYPE_VIDEO) {
+                    LOG_TAG(&log, LOG_VIDEO_FRAME, view.tag_type, (view.body_len > 0) ? view.body[0] : 0, datasize, timestamp,
+                        flv_tag.timestampex, pre_tag_size);
+                }
+
+                //dump the whole video tag body to the output file in one block copy
+                if (flv_copy(ifh, vfh, datasize) != datasize) {
+                    LOG_MESSAGE(&log, "Failed to read the tag at %lld, its slice is damaged\n", (long long)tag_offset);
+                    job->status = -1;
+                }
+
+                //terminate the tag with its own PreviousTagSize
+                flv_put_be32(be_size, datasize + sizeof(flv_tag_t));
+                flv_writer_write(vfh, be_size, sizeof(be_size));
+
+                //a live slice is on disk up to its latest tag
+                if (ifh->stream) {
+                    flv_writer_flush(vfh);
+                }
+            }
+
+            break;
+
+        case TAG_TYPE_META:
+            if (tag_log) {
+                LOG_TAG(&log, LOG_META_HEADER, TAG_TYPE_META, 0, datasize, timestamp, flv_tag.timestampex, pre_tag_size);
+            }
+            {
+                job->flv_file.script_data_lst.push_back(flv_script_data_t());
+                flv_script_data_t &script_data = job->flv_file.script_data_lst.back();
+                script_data.tag_num = tag_num;
+
+                //decode from memory, in place when mapped, else after one read of the body into the arena
+                flv_arena_t *arena = &job->flv_file.amf_arena;
+                const uint8_t *body = ifh->mapped ? flv_reader_peek(ifh, datasize) : NULL;
+                uint32_t body_len = datasize;
+                if (body == NULL) {
+                    uint8_t *copy = (uint8_t *)flv_arena_alloc(arena, datasize);
+                    body_len = (copy != NULL) ? flv_reader_read(ifh, copy, datasize) : 0;
+                    body = copy;
+                }
+                amf_decode_script(body, body_len, arena, &script_data.amf_script_data_lst);
+                script_data.body = body;
+                script_data.body_len = (body != NULL) ? body_len : 0;
+
+                //log the values once the formatter has caught up, the leading name is only in the XML dump
+#if FLV_LOG_LEVEL >= 2
+                const amf_data_value_t *p_name = script_data.amf_script_data_lst.first;
+                for (const amf_data_value_t *p_value = (p_name != NULL && tag_log) ? p_name->next : NULL; p_value != NULL; p_value = p_value->next) {
+                    amf_log_data(flv_log_sync(&log), p_value);
+                }
+#endif
+
+                //a stream has no end to keep them all until, they are only logged
+                if (ifh->stream) {
+                    job->flv_file.script_data_lst.pop_back();
+                    flv_arena_reset(arena);
+                }
+            }
+            break;
+
+        default:
+            //the iterator skips the data of this tag
+            break;
+        }
+
+    }
+
+    //the log is this thread's again
+    flv_log_stop(&log);
+
+    //the last fragment ends with its last tag
+    flv_mp4_close(&mp4, 0);
+    if (job->flags & FLAG_FMP4) {
+        flv_writer_printf(parse_file, "Wrote %u MP4 fragments, %u samples without a track dropped, %u tags of other codecs skipped\n",
+            mp4.fragments, mp4.dropped, mp4_skipped);
+    }
+
+    //the last segment ends with its last tag, then the playlist is complete
+    if (job->segment) {
+        if ((segment_audio ? afh : vfh) != NULL) {
+            add_segment(job, parse_file, &segments, segment_audio ? afh : vfh, segment_start, timestamp, false);
+        }
+        write_playlist(job, parse_file, segments, true);
+    }
+
+    if (job->filter.active) {
+        flv_writer_printf(parse_file, "Filter dropped %u tags\n", filtered);
+    }
+    if (aac_dropped != 0) {
+        flv_writer_printf(parse_file, "Dropped %u AAC frames without a usable AudioSpecificConfig\n", aac_dropped);
+    }
+    if (avc_dropped != 0) {
+        flv_writer_printf(parse_file, "Dropped %u AVC frames without a usable AVCDecoderConfigurationRecord\n", avc_dropped);
+    }
+
+    if (iter.resyncs != 0) {
+        flv_writer_printf(parse_file, "Recovered from %u damaged ranges, %llu bytes dropped\n",
+            iter.resyncs, (unsigned long long)iter.skipped);
+    }
+
+    //a full pass leaves a sidecar behind for the next run
+    if (write_sidecar) {
+        if (flv_sidecar_write(idx_name, in_file, data_offset, &tag_index) == 0) {
+            flv_writer_printf(parse_file, "Wrote seek index %s\n", idx_name);
+        }
+        else {
+            flv_writer_printf(parse_file, "Failed to write seek index %s\n", idx_name);
+        }
+    }
+    flv_sidecar_close(sidecar);
+
+    //the tags go to the binary dump, or to the XML one along with the log
+    if (job->flags & FLAG_BINDUMP) {
+        write_bin_dump(job, parse_file);
+    }
+#if FLV_LOG_LEVEL >= 2
+    if (tag_log) {
+        dump_flv_file(job);
+    }
+#endif
+
+    job->flv_file.script_data_lst.clear();
+    flv_arena_free(&job->flv_file.amf_arena);
+    flv_index_clear(&tag_index);
+    flv_index_clear(&plan_index);
+    flv_index_clear(&kept_index);
+    flv_slice_meta_free(&slice_meta);
+
+    //feedback to user   
+    flv_writer_printf(parse_file, "Program complete.");
+
+    //finished...close all file pointers   
+    flv_writer_close(afh);
+    flv_writer_close(vfh);
+    flv_writer_close(parse_file);
+    flv_reader_close(ifh);
+    free(cue);
+}
+
+//probefile - the JSON description of the file on stdout, written in one go so batch jobs don't interleave
+void probefile(flv_job_t *job) {
+    flv_reader_t *reader = flv_reader_open(job->in_file, (job->flags & FLAG_MMAP_INPUT) ? FLV_IO_MODE_MMAP : FLV_IO_MODE_BUFFERED);
+    if (reader == NULL) {
+        fprintf(stderr, "Failed to open %s\n", job->in_file);
+        job->status = -1;
+        return;
+    }
+    flv_probe_t probe;
+    if (flv_probe(reader, &probe) != 0) {
+        fprintf(stderr, "%s is not an FLV file\n", job->in_file);
+        job->status = -1;
+    }
+    else {
+        std::vector<char> json;
+        flv_probe_json(&probe, job->in_file, &json);
+        fwrite(&json[0], 1, json.size(), stdout);
+        fflush(stdout);
+    }
+    flv_reader_close(reader);
+}
+
+//statsfile - analyse every tag from its header and first body bytes, then the JSON report on stdout
+void statsfile(flv_job_t *job) {
+    flv_reader_t *reader = flv_reader_open(job->in_file, (job->flags & FLAG_MMAP_INPUT) ? FLV_IO_MODE_MMAP : FLV_IO_MODE_BUFFERED);
+    if (reader == NULL) {
+        fprintf(stderr, "Failed to open %s\n", job->in_file);
+        job->status = -1;
+        return;
+    }
+    flv_iter_t iter;
+    flv_tag_view_t view;
+    if (flv_iter_init(&iter, reader, 0) != 0) {
+        fprintf(stderr, "%s is not an FLV file\n", job->in_file);
+        flv_reader_close(reader);
+        job->status = -1;
+        return;
+    }
+    flv_stats_t *stats = new flv_stats_t;
+    flv_stats_init(stats);
+    while (flv_iter_next(&iter, &view)) {
+        flv_stats_add(stats, view.offset, view.tag_type, view.data_size, view.timestamp, view.body, view.body_len);
+    }
+    flv_stats_finish(stats);
+    stats->resyncs = iter.resyncs;
+    stats->damaged_bytes = iter.skipped;
+
+    std::vector<char> json;
+    flv_stats_json(stats, job->in_file, &json);
+    fwrite(&json[0], 1, json.size(), stdout);
+    fflush(stdout);
+    delete stats;
+    flv_reader_close(reader);
+}
+
+//log_tag - a record of the tag being parsed for the formatter thread
+void log_tag(flv_log_t *log, uint8_t kind, uint8_t tag_type, uint8_t av_hdr, uint32_t data_size, uint32_t timestamp,
+    uint8_t timestampex, uint32_t pre_tag_size)
+{
+    flv_log_rec_t rec;
+    rec.kind = kind;
+    rec.tag_type = tag_type;
+    rec.av_hdr = av_hdr;
+    rec.timestampex = timestampex;
+    rec.data_size = data_size;
+    rec.timestamp = timestamp;
+    rec.pre_tag_size = pre_tag_size;
+    flv_log_push(log, &rec);
+}
+
+//format_log - the text log's lines for one record of the parse loop
+void format_log(flv_writer_t *parse_file, const flv_log_rec_t *rec)
+{
+    switch (rec->kind)
+    {
+    case LOG_TAG_HEAD:
+        flv_writer_printf(parse_file, "pre_tag_size:   %d\n"
+            "\n================= flv.tag.head(: %lu) =====================\n"
+            "flv.tag.tagType     = %d\n"
+            "flv.tag.datasize    = %d\n"
+            "flv.tag.Timestamp   = %d\n"
+            "flv.tag.TimestampEx = %d",
+            rec->pre_tag_size, sizeof(flv_tag_t), rec->tag_type, rec->data_size, rec->timestamp, rec->timestampex);
+        break;
+    case LOG_AUDIO_HEADER:
+        {
+            short sound_format = (rec->av_hdr >> 4) & 0x0F;
+            short sample_rate = (rec->av_hdr >> 2) & 0x03;
+            short sample_size = (rec->av_hdr >> 1) & 0x01;
+            short sound_type = (rec->av_hdr >> 0) & 0x01;
+            flv_writer_printf(parse_file, "\n================= flv.tag.body.audio.header =====================\n"
+                "sound format: %2d - %s\n"
+                "sound rate:   %2d - %s\n"
+                "sample size:  %2d - %s\n"
+                "sound type:   %2d - %s\n"
+                "datasize:     %d\n",
+                sound_format, INFO_TEXT(audio_format_info, sound_format), sample_rate, INFO_TEXT(audio_rate_info, sample_rate),
+                sample_size, INFO_TEXT(audio_sample_size_info, sample_size), sound_type, INFO_TEXT(audio_mono_streno_info, sound_type),
+                rec->data_size);
+        }
+        break;
+    case LOG_VIDEO_HEADER:
+        flv_writer_printf(parse_file, "\n================= flv.tag.body.video.header =====================\n");
+        break;
+    case LOG_VIDEO_FRAME:
+        {
+            short frame_type = (rec->av_hdr >> 4) & 0x0F;
+            short codec_id = (rec->av_hdr >> 0) & 0x0F;
+            flv_writer_printf(parse_file, "frame type: %3d - %s\n"
+                "codec id:   %3d - %s\n"
+                "datasize:     %d\n",
+                frame_type, INFO_TEXT(video_frame_type, frame_type - 1), codec_id, INFO_TEXT(video_codec_info, codec_id - 1),
+                rec->data_size);
+        }
+        break;
+    case LOG_META_HEADER:
+        flv_writer_printf(parse_file, "\n================= flv.tag.event(onMetaData).header =====================");
+        break;
+    default:
+        break;
+    }
+}
+
+//format_xml - one tag of the XML dump, without the values of a script tag
+void format_xml(flv_writer_t *xml_file, const flv_log_rec_t *rec)
+{
+    flv_writer_printf(xml_file, "<pre_tag_size>%d</pre_tag_size>\n"
+        "<tag type=\"%s\">\n"
+        "<head len=\"%lu\">\n"
+        "<tagType>%d</tagType>\n"
+        "<datasize>%d</datasize>\n"
+        "<timestamp>%d</timestamp>\n"
+        "<timestampex>%d</timestampex>"
+        "</head>\n"
+        "<body>\n",
+        rec->pre_tag_size, (rec->tag_type == TAG_TYPE_AUDIO) ? "audio" : ((rec->tag_type == TAG_TYPE_VIDEO) ? "video" : "script_data"),
+        sizeof(flv_tag_t), rec->tag_type, rec->data_size, rec->timestamp, rec->timestampex);
+
+    switch (rec->tag_type)
+    {
+    case TAG_TYPE_AUDIO:
+        {
+            uint16_t sound_format = (rec->av_hdr >> 4) & 0x0F;
+            uint16_t sample_rate = (rec->av_hdr >> 2) & 0x03;
+            uint16_t sample_size = (rec->av_hdr >> 1) & 0x01;
+            uint16_t sound_type = (rec->av_hdr >> 0) & 0x01;
+            flv_writer_printf(xml_file, "<audio_header>\n"
+                "<sound_format value=\"%2d\">%s</sound_format>\n"
+                "<sound_rate value=\"%2d\">%s</sound_rate>\n"
+                "<sample_size value=\"%2d\">%s</sample_size>\n"
+                "<sound_type value=\"%2d\">%s</sound_type>\n"
+                "<datasize>%d</datasize>\n"
+                "</audio_header>\n",
+                sound_format, INFO_TEXT(audio_format_info, sound_format), sample_rate, INFO_TEXT(audio_rate_info, sample_rate),
+                sample_size, INFO_TEXT(audio_sample_size_info, sample_size), sound_type, INFO_TEXT(audio_mono_streno_info, sound_type),
+                rec->data_size);
+        }
+        break;
+    case TAG_TYPE_VIDEO:
+        {
+            uint16_t frame_type = (rec->av_hdr >> 4) & 0x0F;
+            uint16_t codec_id = (rec->av_hdr >> 0) & 0x0F;
+            flv_writer_printf(xml_file, "<video_header>\n"
+                "<frame_type value=\"%3d\">%s</frame_type>\n"
+                "<codec_id value=\"%3d\">%s</codec_id>\n"
+                "<datasize>%d</datasize>\n"
+                "</video_header>\n",
+                frame_type, INFO_TEXT(video_frame_type, frame_type - 1), codec_id, INFO_TEXT(video_codec_info, codec_id - 1),
+                rec->data_size);
+        }
+        break;
+    default:
+        break;
+    }
+
+    //the producer writes a script tag's values and closes it
+    if (rec->kind == LOG_XML_TAG)
+    {
+        flv_writer_printf(xml_file, "</body>\n</tag>\n");
+    }
+}
+
+void dump_flv_file(flv_job_t *job)
+{
+    flv_writer_t *xml_file = NULL;
+    if ((xml_file = open_output_file(job, DUMP_TYPE_XML)) == NULL)
+    {
+        return;
+    }
+    const flv_tag_index_t &tag_index = job->flv_file.tag_index;
+    uint32_t tag_count = flv_index_count(&tag_index), listed = tag_count;
+    std::list<flv_script_data_t>::const_iterator script_iter = job->flv_file.script_data_lst.begin();
+
+    //the tags --filter dropped aren't listed
+    std::vector<bool> dropped;
+    if (job->filter.active)
+    {
+        dropped.resize(tag_count);
+        for (uint32_t n = 0; n < tag_count; ++n)
+        {
+            dropped[n] = !flv_filter_match(&job->filter, flv_index_tag_type(&tag_index, n), flv_index_av_hdr(&tag_index, n),
+                tag_index.timestamp[n]);
+            listed -= dropped[n];
+        }
+    }
+    xml_begin(xml_file, job->project_name, job->flv_file.flv_hdr, listed);
+
+    //the formatter thread writes the tags as the list is walked
+    flv_log_t log;
+    flv_log_init(&log, xml_file, format_xml);
+    flv_log_start(&log);
+
+    for (uint32_t n = 0; n < tag_count; ++n)
+    {
+        if (!dropped.empty() && dropped[n])
+        {
+            continue;
+        }
+        //script tags only have decoded data when they went through the meta branch
+        uint8_t tag_type = flv_index_tag_type(&tag_index, n);
+        bool has_values = tag_type == TAG_TYPE_META && script_iter != job->flv_file.script_data_lst.end() && script_iter->tag_num == n;
+        flv_log_rec_t rec;
+        rec.kind = has_values ? LOG_XML_TAG_OPEN : LOG_XML_TAG;
+        rec.tag_type = tag_type;
+        rec.av_hdr = flv_index_av_hdr(&tag_index, n);
+        rec.timestampex = (uint8_t)(tag_index.timestamp[n] >> 24);
+        rec.data_size = flv_index_data_size(&tag_index, n);
+        rec.timestamp = tag_index.timestamp[n] & 0x00FFFFFF;
+        rec.pre_tag_size = flv_index_pre_tag_size(&tag_index, n);
+        flv_log_push(&log, &rec);
+        if (!has_values)
+        {
+            continue;
+        }
+
+        //written once the formatter has caught up
+        xml_values(flv_log_sync(&log), script_iter->amf_script_data_lst);
+        ++script_iter;
+    }
+    flv_log_stop(&log);
+
+    xml_end(xml_file);
+    flv_writer_close(xml_file);
+}
+
+//xml_begin - the XML dump up to its list of tag_count tags
+void xml_begin(flv_writer_t *xml_file, const char *name, const flv_hdr_t &flv_hdr, uint32_t tag_count)
+{
+    flv_writer_printf(xml_file, "<?xml version='1.0' encoding='UTF-8'?>\n");
+    flv_writer_printf(xml_file, "<fileset>\n");
+    flv_writer_printf(xml_file, "<flv name=\"%s\">\n", name);
+
+    flv_writer_printf(xml_file, "<header len=\"%lu\">\n", sizeof(flv_hdr_t));
+    flv_writer_printf(xml_file, "<signature>%c%c%c</signature>\n", flv_hdr.signature[0], flv_hdr.signature[1], flv_hdr.signature[2]);
+    flv_writer_printf(xml_file, "<version>0x%X</version>\n", flv_hdr.version);
+    flv_writer_printf(xml_file, "<flags has_audio=\"%d\" has_video=\"%d\">0x%X</flags>\n",
+        (flv_hdr.flags & 0x04) != 0, (flv_hdr.flags & 0x01) != 0, flv_hdr.flags);
+    flv_writer_printf(xml_file, "<data_offset>%u</data_offset>\n", flv_get_be32((const uint8_t *)&flv_hdr.data_offset));
+    flv_writer_printf(xml_file, "</header>\n");
+    flv_writer_printf(xml_file, "<tags len=\"%u\">\n", tag_count);
+}
+
+//xml_values - a script tag's name, value pairs, then the end of the tag
+void xml_values(flv_writer_t *xml_file, const amf_script_data_list_t &amf_script_data_lst)
+{
+    for (const amf_data_value_t *p_name = amf_script_data_lst.first; p_name != NULL; )
+    {
+        const amf_string_t &name = p_name->data_value.string_value;
+        flv_writer_printf(xml_file, "<name value=\"%.*s\"/>\n", (int)name.size, name.data);
+        flv_writer_printf(xml_file, "<value>\n");
+        dump_meta_data(p_name->next, xml_file);
+        flv_writer_printf(xml_file, "</value>\n");
+        p_name = (p_name->next != NULL) ? p_name->next->next : NULL;
+    }
+    flv_writer_printf(xml_file, "</body>\n</tag>\n");
+}
+
+void xml_end(flv_writer_t *xml_file)
+{
+    flv_writer_printf(xml_file, "</tags>\n");
+
+    flv_writer_printf(xml_file, "</flv>\n");
+    flv_writer_printf(xml_file, "</fileset>\n");
+}
+
+//write_bin_dump - the tags and script data of the file as a .flvdump, the filter's dropped tags left out
+void write_bin_dump(flv_job_t *job, flv_writer_t *parse_file)
+{
+    char file_name[_MAX_PATH + _MAX_EXT + 16] = { 0 };
+    snprintf(file_name, sizeof(file_name), "%s_%u.%s", job->project_name, job->cur_num, FLV_DUMP_EXT);
+
+    std::vector<flv_dump_script_t> scripts;
+    for (std::list<flv_script_data_t>::const_iterator iter = job->flv_file.script_data_lst.begin();
+        iter != job->flv_file.script_data_lst.end(); ++iter)
+    {
+        flv_dump_script_t script;
+        script.tag_num = iter->tag_num;
+        script.body = iter->body;
+        script.body_len = iter->body_len;
+        scripts.push_back(script);
+    }
+    if (flv_dump_write(file_name, job->project_name, &job->flv_file.flv_hdr, &job->flv_file.tag_index, &job->filter, scripts) == 0)
+    {
+        flv_writer_printf(parse_file, "Wrote binary dump %s\n", file_name);
+    }
+    else
+    {
+        flv_writer_printf(parse_file, "Failed to write binary dump %s\n", file_name);
+    }
+}
+
+//undump_file - a binary dump back as the XML dump, or as the log's tag lines, on stdout
+int undump_file(const char *dump_name, bool text)
+{
+    flv_dump_t *dump = flv_dump_open(dump_name);
+    if (NULL == dump)
+    {
+        fprintf(stderr, "%s is not a binary dump this version can read\n", dump_name);
+        return -1;
+    }
+    flv_writer_t *out = flv_writer_open(FLV_IO_STDOUT_NAME);
+    if (NULL == out)
+    {
+        flv_dump_close(dump);
+        return -1;
+    }
+    const flv_dump_hdr_t *hdr = dump->hdr;
+    flv_hdr_t flv_hdr;
+    memcpy(&flv_hdr, hdr->flv_hdr, sizeof(flv_hdr));
+    if (text)
+    {
+        flv_writer_printf(out, "================= flv.header(: %lu) =====================\n", sizeof(flv_hdr_t));
+        flv_writer_printf(out, "flv.header.signature[3] = '%c' '%c' '%c'\n", flv_hdr.signature[0], flv_hdr.signature[1], flv_hdr.signature[2]);
+        flv_writer_printf(out, "flv.header.version = 0x%X\n", flv_hdr.version);
+        flv_writer_printf(out, "flv.header.flags = 0x%X\n", flv_hdr.flags);
+        flv_writer_printf(out, "flv.header.flags.has_audio = %d\n", (flv_hdr.flags & 0x04) != 0);
+        flv_writer_printf(out, "flv.header.flags.has_video = %d\n", (flv_hdr.flags & 0x01) != 0);
+        flv_writer_printf(out, "flv.header.dataoffset = %u\n", flv_get_be32((const uint8_t *)&flv_hdr.data_offset));
+        flv_writer_printf(out, "\n================= flv.tag =====================\n");
+    }
+    else
+    {
+        xml_begin(out, hdr->name, flv_hdr, hdr->tag_count);
+    }
+
+    //the records are formatted on the log's thread, script data is decoded here in between
+    flv_log_t log;
+    flv_log_init(&log, out, text ? format_log : format_xml);
+    flv_log_start(&log);
+    flv_arena_t arena;
+    flv_arena_init(&arena);
+    uint32_t blob = 0;
+    for (uint32_t n = 0; n < hdr->tag_count; ++n)
+    {
+        const flv_dump_rec_t &tag = dump->recs[n];
+        bool has_values = blob < hdr->blob_count && dump->blobs[blob].tag == n;
+        flv_log_rec_t rec;
+        rec.tag_type = tag.tag_type;
+        rec.av_hdr = tag.av_hdr;
+        rec.timestampex = (uint8_t)(tag.timestamp >> 24);
+        rec.data_size = tag.data_size;
+        rec.timestamp = tag.timestamp & 0x00FFFFFF;
+        rec.pre_tag_size = tag.pre_tag_size;
+        if (text)
+        {
+            //the tag lines of a --split log
+            rec.kind = LOG_TAG_HEAD;
+            flv_log_push(&log, &rec);
+            rec.kind = (tag.tag_type == TAG_TYPE_AUDIO) ? LOG_AUDIO_HEADER : ((tag.tag_type == TAG_TYPE_VIDEO) ? LOG_VIDEO_HEADER : LOG_META_HEADER);
+            flv_log_push(&log, &rec);
+            if (tag.tag_type == TAG_TYPE_VIDEO)
+            {
+                rec.kind = LOG_VIDEO_FRAME;
+                flv_log_push(&log, &rec);
+            }
+        }
+        else
+        {
+            rec.kind = has_values ? LOG_XML_TAG_OPEN : LOG_XML_TAG;
+            flv_log_push(&log, &rec);
+        }
+        if (!has_values)
+        {
+            continue;
+        }
+
+        amf_script_data_list_t amf_script_data_lst = amf_script_data_list_t();
+        const flv_dump_blob_t *p_blob = &dump->blobs[blob++];
+        amf_decode_script(flv_dump_blob_body(dump, p_blob), p_blob->size, &arena, &amf_script_data_lst);
+        flv_writer_t *values_file = flv_log_sync(&log);
+        if (text)
+        {
+            const amf_data_value_t *p_name = amf_script_data_lst.first;
+            for (const amf_data_value_t *p_value = (p_name != NULL) ? p_name->next : NULL; p_value != NULL; p_value = p_value->next)
+            {
+                amf_log_data(values_file, p_value);
+            }
+        }
+        else
+        {
+            xml_values(values_file, amf_script_data_lst);
+        }
+        flv_arena_reset(&arena);
+    }
+    flv_log_stop(&log);
+    flv_arena_free(&arena);
+
+    if (!text)
+    {
+        xml_end(out);
+    }
+    int ret = flv_writer_close(out);
+    flv_dump_close(dump);
+    return ret;
+}
+
+void dump_meta_data(amf_data_value_t *p_data_value, flv_writer_t *xml_file)
+{
+    if (NULL == p_data_value)
+    {
+        return;
+    }
+    //flv_writer_printf(xml_file, "<type>%d</type>\n", p_data_value->type);
+    switch (p_data_value->type)
+    {
+    case AMF_TYPE_NUMBER:
+        {
+            flv_writer_printf(xml_file, "<number value=\"%.2f\"/>\n", p_data_value->data_value.number);
+        }
+        break;
+    case AMF_TYPE_BOOLEAN:
+        {
+            flv_writer_printf(xml_file, "<boolean value=\"%d\"/>\n", p_data_value->data_value.boolean_vaule);
+        }
+        break;
+    case AMF_TYPE_STRING:
+        {
+            const amf_string_t &value = p_data_value->data_value.string_value;
+            flv_writer_printf(xml_file, "<string value=\"%.*s\"/>\n", (int)value.size, value.data);
+        }
+        break;
+    case AMF_TYPE_OBJECT:
+        {
+            amf_object_t *p_amf_obj = p_data_value->data_value.p_object;
+            if (NULL == p_amf_obj)
+            {
+                break;
+            }
+            flv_writer_printf(xml_file, "<object>\n");
+            for (const amf_object_property_t *p_property = p_amf_obj->object_property_lst.first;
+                p_property != NULL; p_property = p_property->next)
+            {
+                const amf_string_t &name = p_property->property_name;
+                flv_writer_printf(xml_file, "<name value=\"%.*s\">\n", (int)name.size, name.data);
+                dump_meta_data(p_property->p_data_value, xml_file);
+                flv_writer_printf(xml_file, "</name>\n");
+            }
+            flv_writer_printf(xml_file, "</object>\n");
+        }
+        break;
+    case AMF_TYPE_REFERENCE:
+        {
+        }
+        break;
+    case AMF_TYPE_ECMA_ARRAY:
+        {
+            amf_emca_array_t *p_emca_array = p_data_value->data_value.p_emca_array;
+            if (NULL == p_emca_array)
+            {
+                break;
+            }
+            flv_writer_printf(xml_file, "<ecma_array>\n");
+            for (const amf_object_property_t *p_property = p_emca_array->object_property_lst.first;
+                p_property != NULL; p_property = p_property->next)
+            {
+                const amf_string_t &name = p_property->property_name;
+                flv_writer_printf(xml_file, "<name value=\"%.*s\">\n", (int)name.size, name.data);
+                dump_meta_data(p_property->p_data_value, xml_file);
+                flv_writer_printf(xml_file, "</name>\n");
+            }
+            flv_writer_printf(xml_file, "</ecma_array>\n");
+        }
+        break;
+    case AMF_TYPE_OBJECT_END:
+        {
+            flv_writer_printf(xml_file, "<obj_end>%d</obj_end>\n", AMF_TYPE_OBJECT_END);
+        }
+        break;
+    case AMF_TYPE_STRICT_ARRAY:
+        {
+            amf_strict_array_t *p_strict_arr = p_data_value->data_value.p_strict_array;
+            if (NULL == p_strict_arr)
+            {
+                break;
+            }
+            flv_writer_printf(xml_file, "<strict_array>\n");
+            for (amf_data_value_t *p_item = p_strict_arr->amf_data_value_lst.first; p_item != NULL; p_item = p_item->next)
+            {
+                dump_meta_data(p_item, xml_file);
+            }
+            flv_writer_printf(xml_file, "</strict_array>\n");
+        }
+        break;
+    case AMF_TYPE_LONG_STRING:
+        {
+            const amf_long_string_t &value = p_data_value->data_value.long_string_value;
+            flv_writer_printf(xml_file, "<str>%.*s</str>\n", (int)value.size, value.data);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+//load_sidecar - index the input with a header-only pass, save the sidecar and map it, kept in memory when it can't be saved
+flv_sidecar_t *load_sidecar(flv_job_t *job, char *idx_name, uint32_t data_offset, flv_writer_t *parse_file) {
+
+    char *in_file = job->in_file;
+
+    flv_reader_t *reader = flv_reader_open(in_file, (job->flags & FLAG_MMAP_INPUT) ? FLV_IO_MODE_MMAP : FLV_IO_MODE_BUFFERED);
+    if (reader == NULL) {
+        return NULL;
+    }
+    flv_iter_t iter;
+    flv_tag_index_t index;
+    if (flv_iter_init(&iter, reader, 0) != 0) {
+        flv_reader_close(reader);
+        return NULL;
+    }
+    flv_index_scan(&iter, &index);
+    flv_reader_close(reader);
+
+    flv_sidecar_t *sidecar = NULL;
+    if (flv_sidecar_write(idx_name, in_file, data_offset, &index) == 0) {
+        sidecar = flv_sidecar_open(idx_name, in_file);
+    }
+    if (sidecar == NULL) {
+        flv_writer_printf(parse_file, "Failed to write seek index %s, keeping it in memory\n", idx_name);
+        sidecar = flv_sidecar_build(in_file, data_offset, &index);
+    }
+    return sidecar;
+}
+
+//snap_cues - the key frame offset every cue point moves to (UINT64_MAX for none), terminated by UINT64_MAX
+void snap_cues(flv_job_t *job, const flv_sidecar_t *sidecar, const uint32_t *cue, uint32_t cue_count,
+    std::vector<uint64_t> *cut_offset, flv_writer_t *parse_file) {
+
+    const flv_sidecar_entry_t *first = NULL, *last = NULL;
+    if (sidecar != NULL && sidecar->hdr->entry_count > 0) {
+        first = sidecar->entries;
+        last = first + sidecar->hdr->entry_count;
+    }
+    cut_offset->clear();
+    for (uint32_t i = 0; i < cue_count; ++i) {
+        const flv_sidecar_entry_t *entry = (first != NULL) ? flv_sidecar_find(sidecar, cue[i]) : NULL;
+        if (job->flags & FLAG_KEYFRAME_PREV) {
+            entry = (entry != NULL) ? entry : first;
+        }
+        else {
+            entry = (entry != NULL) ? entry + 1 : first;
+            entry = (entry != last) ? entry : NULL;
+        }
+        cut_offset->push_back((entry != NULL) ? entry->offset : UINT64_MAX);
+        if (entry != NULL) {
+            flv_writer_printf(parse_file, "Cue %u snapped to the key frame at %u\n", cue[i], entry->timestamp);
+        }
+    }
+    cut_offset->push_back(UINT64_MAX);
+}
+
+//This function handles iterative file naming and opening   
+flv_writer_t* open_output_file(flv_job_t *job, uint8_t tag) {   
+
+    //instantiate two buffers   
+    char file_name[_MAX_PATH + _MAX_EXT + 16] = { 0 }, ext[_MAX_EXT] = { 0 };
+    switch (tag)
+    {
+    case DUMP_TYPE_DEFAULT:
+        //determine the file extension   
+        strcpy(ext, "txt\0");
+        break;
+    case DUMP_TYPE_XML:
+        //determine the file extension   
+        strcpy(ext, "xml\0");
+        break;
+    case TAG_TYPE_AUDIO:
+        //determine the file extension   
+        strcpy(ext, "mp3\0");
+        break;
+    case DUMP_TYPE_AAC:
+        //determine the file extension   
+        strcpy(ext, "aac\0");
+        break;
+    case DUMP_TYPE_H264:
+        //determine the file extension   
+        strcpy(ext, "h264\0");
+        break;
+    case DUMP_TYPE_MP4:
+        //determine the file extension   
+        strcpy(ext, "mp4\0");
+        break;
+    case TAG_TYPE_VIDEO:
+        //determine the file extension   
+        strcpy(ext, "flv\0");
+        break;
+    default:
+        //determine the file extension   
+        strcpy(ext, "txt\0");
+        break;
+    }
+
+    //build the file name   
+    snprintf(file_name, sizeof(file_name), "%s_%u.%s", job->project_name, job->cur_num, ext);   
+
+    //return the buffered writer   
+    return flv_writer_open(file_name);   
+}   
+
+//add_segment - list the slice being closed (fh is its file) in the playlist, a live one is republished right away
+void add_segment(flv_job_t *job, flv_writer_t *parse_file, std::vector<flv_segment_entry_t> *segments,
+    flv_writer_t *fh, uint32_t start, uint32_t end, bool live) {
+    flv_segment_entry_t entry;
+    flv_writer_flush(fh);
+    entry.num = job->cur_num;
+    entry.start = start;
+    entry.duration = (end > start) ? end - start : 0;
+    entry.bytes = fh->bytes_written;
+    segments->push_back(entry);
+    flv_writer_printf(parse_file, "Segment %u: start %u ms, duration %u ms, %llu bytes\n", entry.num, entry.start,
+        entry.duration, (unsigned long long)entry.bytes);
+    if (live) {
+        write_playlist(job, parse_file, *segments, false);
+    }
+}
+
+//write_playlist - <project>.m3u8 next to the segments, which it names without their directory;
+//split slices are listed by their video file (.h264 with --h264), by the audio one when there is no video
+void write_playlist(flv_job_t *job, flv_writer_t *parse_file, const std::vector<flv_segment_entry_t> &segments, bool complete) {
+    const char *ext = (job->video_dump == DUMP_TYPE_H264) ? "h264" : (job->video_dump == DUMP_TYPE_MP4) ? "mp4" : "flv";
+    if ((job->flags & FLAG_SEPARATE_AV) && !(job->flv_file.flv_hdr.flags & 0x01)) {
+        ext = (job->audio_dump == DUMP_TYPE_AAC) ? "aac" : "mp3";
+    }
+    char file_name[_MAX_PATH + _MAX_EXT];
+    snprintf(file_name, sizeof(file_name), "%s.%s", job->project_name, FLV_SEGMENT_PLAYLIST_EXT);
+    const char *prefix = job->project_name;
+    for (const char *p = job->project_name; *p != '\0'; ++p) {
+        if (*p == '/' || *p == '\\') {
+            prefix = p + 1;
+        }
+    }
+    if (flv_segment_write_playlist(file_name, prefix, ext, job->segment, segments, complete) != 0) {
+        flv_writer_printf(parse_file, "Failed to write playlist %s\n", file_name);
+    }
+    else if (complete) {
+        flv_writer_printf(parse_file, "Wrote playlist %s, %u segments\n", file_name, (uint32_t)segments.size());
+    }
+}
+
+//read in the cue points from file in a list format   
+uint32_t * read_cue_file(char *fn) {   
+    FILE * cfh;   
+    uint32_t ms, n, count = 0;   
+    char sLine[13];   
+    unsigned int ts[5];   
+    float ts_f = 0;   
+
+    //instantiate the heap pointer   
+    uint32_t * p = (uint32_t *) malloc((uint32_t) 4);    
+
+    //try opening the cue file   
+    if ( (cfh = fopen(fn, "r")) != NULL) {   
+
+        //grab the first string   
+        n = fscanf(cfh, "%12s", sLine);   
+
+        //loop until there are no more strings   
+        while (n==1) {     
+
+            //reset milliseconds   
+            ms = 0;   
+
+            //check to see if in timestamp format   
+            if ((sLine[2]==':') && (sLine[5]==':') && (sLine[8]==':')) {   
+
+                //replace the colons with tabs   
+                sLine[2]='\t'; sLine[5]='\t'; sLine[8]='\t';   
+
+                //extract the timestamp values
+				sscanf(sLine, "%u %u %u %u", &ts[0], &ts[1], &ts[2], &ts[3]);
+
+                //calculate the timestamp as milliseconds   
+                ms = (ts[0]*3600 + ts[1]*60 + ts[2])*1000 + ts[3];   
+
+            } else {   
+
+                //just see if there is a decimal notation of milliseconds   
+                sscanf(sLine, "%f", &ts_f);   
+                ms = (uint32_t) ts_f * 1000;   
+
+            }   
+
+            //if a cuepoint was found on this line   
+            if (ms > 0) {   
+
+                //dynamically reallocate memory space as necessary   
+                if (count % CUE_BLOCK_SIZE == 0)   
+                    p = (uint32_t *) realloc(p, (uint32_t) ((count + CUE_BLOCK_SIZE)*sizeof(int)));   
+
+                //set the cue value   
+                *(p + count++) = ms;   
+
+            }   
+
+            //grab the next string   
+            n = fscanf(cfh, "%12s", sLine);   
+        }   
+        fclose(cfh);
+    }   
+
+    //set the last cue point to max int   
+    *(p+count) = 0xFFFFFFFF;   
+
+    //return the pointer to the heap allocation   
+    return p;   
+}
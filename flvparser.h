@@ -0,0 +1,37 @@
+// flvparser.h : public interface of libflvparser.
+//
+// Embedders include this one header and link libflvparser.a or
+// libflvparser.so. The usual entry point is the tag iterator:
+//
+//     flv_reader_t *reader = flv_reader_open("in.flv", FLV_IO_MODE_MMAP);
+//     flv_iter_t iter;
+//     flv_tag_view_t tag;
+//     if (flv_iter_init(&iter, reader, FLV_ITER_BODY) == 0)
+//         while (flv_iter_next(&iter, &tag))
+//             consume(tag.tag_type, tag.timestamp, tag.body, tag.body_len);
+//     flv_reader_close(reader);
+//
+// The rest (index, sidecar, slicer, segmenter, pool, AMF decoding) is what the
+// flvparser command line tool is built from.
+
+#pragma once
+
+#include "stdafx.h"
+#include "flv_format.h"
+#include "flv_io.h"
+#include "flv_iter.h"
+#include "flv_scan.h"
+#include "flv_arena.h"
+#include "flv_amf.h"
+#include "flv_index.h"
+#include "flv_sidecar.h"
+#include "flv_slicer.h"
+#include "flv_segment.h"
+#include "flv_es.h"
+#include "flv_mp4.h"
+#include "flv_filter.h"
+#include "flv_probe.h"
+#include "flv_stats.h"
+#include "flv_log.h"
+#include "flv_dump.h"
+#include "flv_pool.h"